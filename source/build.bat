@@ -2,14 +2,18 @@
 
 set OptimOrDebugFlags=-MT -O2 -fp:fast -Oi
 set WarningsHandlingFlags=-WX -W4 -wd4201 -wd4100 -wd4189 -wd4505
-set CommonCompilerFlags=-nologo -arch:AVX2 -EHa- -EHsc -FC -Gm- -GR- -Z7 %OptimOrDebugFlags% %WarningsHandlingFlags%
+set CommonCompilerFlags=-nologo -EHa- -EHsc -FC -Gm- -GR- -Z7 %OptimOrDebugFlags% %WarningsHandlingFlags%
 set CommonCompilerDefines=-DSABLUJO_INTERNAL -DSABLUJO_SLOW -DSABLUJO_WIN32
 REM set CommonCompilerDefines=-DSABLUJO_WIN32
 set CommonLinkerFlags=-incremental:no -opt:ref
 
-set GameSourceFiles=..\source\sablujo.cpp ..\source\sablujo_maths.cpp ..\source\sablujo_geometry.cpp
+set GameSourceFiles=..\source\sablujo.cpp ..\source\sablujo_maths.cpp ..\source\sablujo_geometry.cpp ..\source\sablujo_render.cpp ..\source\sablujo_tiff.cpp
+REM NOTE: The raster kernels are built once per instruction set tier, the game picks one at runtime
+set RasterSourceFile=..\source\sablujo_raster.cpp
+set RasterCompilerFlags=-c %CommonCompilerFlags% %CommonCompilerDefines%
+set RasterObjectFiles=sablujo_raster_avx512.obj sablujo_raster_avx2.obj sablujo_raster_sse4.obj sablujo_raster_scalar.obj
 set GameCompilerFlags=-LD -Fmsablujo.map %CommonCompilerFlags% %CommonCompilerDefines%
-set GameLinkerFlags=-PDB:sablujo_%random%.pdb -EXPORT:GameUpdateAndRender %CommonLinkerFlags%
+set GameLinkerFlags=-PDB:sablujo_%random%.pdb -EXPORT:GameUpdateAndRender -EXPORT:GameRenderOffline %CommonLinkerFlags%
 
 set PlatformSourceFiles=..\source\win32_sablujo.cpp ..\source\dx12_renderer.cpp
 set PlatformCompilerFlags=-Fmwin32_sablujo.map %CommonCompilerFlags% %CommonCompilerDefines%
@@ -25,6 +29,10 @@ pushd ..\build
 
 REM 64-bit build
 del *.pdb > NUL 2> NUL
-cl %GameCompilerFlags% %GameSourceFiles% /link %GameLinkerFlags% 
+cl %RasterCompilerFlags% -arch:AVX512 -DLANE_WIDTH=16 -Fosablujo_raster_avx512.obj %RasterSourceFile%
+cl %RasterCompilerFlags% -arch:AVX2 -DLANE_WIDTH=8 -Fosablujo_raster_avx2.obj %RasterSourceFile%
+cl %RasterCompilerFlags% -DLANE_WIDTH=4 -Fosablujo_raster_sse4.obj %RasterSourceFile%
+cl %RasterCompilerFlags% -DLANE_WIDTH=1 -Fosablujo_raster_scalar.obj %RasterSourceFile%
+cl %GameCompilerFlags% %GameSourceFiles% %RasterObjectFiles% /link %GameLinkerFlags% 
 cl %PlatformCompilerFlags% %PlatformSourceFiles% /link %PlatformLinkerFlags%
 popd
\ No newline at end of file
@@ -1,6 +1,15 @@
 #include "sablujo.h"
 #include "sablujo_geometry.h"
-#include "sablujo_sse.h"
+#include "sablujo_render.h"
+#include "sablujo_tiff.h"
+
+// NOTE: Offline renders go through memory this many pixels squared at a time, it must be
+// a multiple of both the raster tile and the TIFF tile sizes
+#define OFFLINE_CHUNK_SIZE 2048
+
+// NOTE: Foveated shading rings, as fractions of the distance from the center to a corner
+#define FOVEATED_FULL_RATE_RADIUS 0.4f
+#define FOVEATED_HALF_RATE_RADIUS 0.7f
 
 // internal void
 // RenderWeirdGradient(game_offscreen_buffer* Buffer, int32_t XOffset, int32_t YOffset)
@@ -17,43 +26,6 @@
 //     }
 // }
 
-using color = vector3;
-
-internal inline uint32_t 
-ColorToUInt32(color Color)
-{
-    return (uint32_t)(uint8_t(Color.X * 255) << 16 | uint8_t(Color.Y * 255) << 8 | uint8_t(Color.Z * 255));
-}
-
-internal void 
-ClearBuffer(game_offscreen_buffer* Buffer)
-{
-    Assert(Buffer->Height * Buffer->Width % 2 == 0);
-    
-    uint64_t* DoublePixel = (uint64_t*)Buffer->Memory;
-    uint64_t* EndPointer = &DoublePixel[Buffer->Height * Buffer->Width / 2];
-    while(DoublePixel != EndPointer)
-    {
-        *DoublePixel++ = 0;
-    }
-}
-
-internal void 
-RenderRectangle(game_offscreen_buffer* Buffer, 
-                vector2u Min, vector2u Max,
-                color Color)
-{
-    for(uint32_t Y = Min.Y; Y < Max.Y; ++Y)
-    {
-        // uint32_t* Pixel = (uint32_t*)(&((uint8_t*)Buffer->Memory)[Y * Buffer->Pitch + Min.X]);
-        for(uint32_t X = Min.X; X < Max.X; ++X)
-        {
-            ((uint32_t*)Buffer->Memory)[Y * Buffer->Width + X] = ColorToUInt32(Color);
-            // *Pixel++ = ColorToUInt32(Color);
-        }
-    }
-}
-
 internal void 
 InitializeCamera(camera* Camera, int32_t ImageWidth, int32_t ImageHeight)
 {
@@ -96,323 +68,63 @@ InitializeCamera(camera* Camera, int32_t ImageWidth, int32_t ImageHeight)
     Camera->IsInitialized = true;
 }
 
-internal void 
-VertexStage(game_state* GameState, mesh* Mesh,
-            int32_t ScreenWidth, int32_t ScreenHeight, 
-            vector2i* OutputVertices, vector3* OutputPositions, vector3* OutputNormals)
-{
-    for (uint32_t j = 0; j < Mesh->IndicesCount; j++) 
-    {
-        Assert(Mesh->Indices[j] < Mesh->VerticesCount);
-        vector4 Vertex = vector4(Mesh->Vertices[Mesh->Indices[j]], 1.0f);
-        vector4 ModelVertex       = MultPointMatrix(&Mesh->Transform, &Vertex);
-        vector4 CameraSpaceVertex = MultPointMatrix(&GameState->Camera.View, &ModelVertex);
-        vector4 ProjectedVertex   = MultVecMatrix(&GameState->Camera.Projection, &CameraSpaceVertex);
-        
-        vector3 TransformedNormal = MultPointMatrix(&Mesh->InverseTransform, &Mesh->Normals[Mesh->Indices[j]]);
-        
-        // convert to raster space and mark the position of the vertex in the image with a simple dot
-        int32_t x = MIN(ScreenWidth - 1, (int32_t)((ProjectedVertex.X + 1) * 0.5f * ScreenWidth));
-        int32_t y = MIN(ScreenHeight - 1, (int32_t)((1 - (ProjectedVertex.Y + 1) * 0.5f) * ScreenHeight));
-        
-        OutputVertices[j]  = {x, y};
-        OutputPositions[j] = vector3{ModelVertex.X, ModelVertex.Y, ModelVertex.Z};
-        OutputNormals[j]   = TransformedNormal;
-#if SABLUJO_INTERNAL
-        ++GameState->RenderStats.VerticesCount;
-#endif
-    }
-}
-
-internal lane_v3 
-FragmentStage(lane_v3 Position, lane_v3 Normal)
-{
-    lane_v3 LightPos = InitLaneV3(-3.0f, -8.0f, 0.0f);
-    lane_v3 CamPos = {};                
-    
-    lane_v3 LightDir = LightPos - Position;
-    lane_v3 CamDir = CamPos - Position;
-    
-    LightDir = Normalize(LightDir);
-    CamDir = Normalize(CamDir);
-    
-    lane_v3 HalfAngles = CamDir + LightDir;
-    HalfAngles = Normalize(HalfAngles);
-    
-    lane_f32 NdotL = DotProduct(Normal, LightDir);
-    NdotL = Clamp(NdotL, LaneZeroF32, LaneOneF32);
-    
-    lane_f32 NdotH = DotProduct(Normal, HalfAngles);
-    NdotH = Clamp(NdotH, LaneZeroF32, LaneOneF32);
-    
-    lane_f32 SpecularHighlight = Pow(NdotH, 32u);
-    
-    lane_v3 DiffuseCol = InitLaneV3(1.0f, 0.0f, 0.0f);
-    lane_f32 LightIntensity = InitLaneF32(40.0f);
-    
-    lane_v3 Diffuse = DiffuseCol * NdotL * LightIntensity;
-    
-    lane_v3 SpecularColor = InitLaneV3(1.0f, 1.0f, 1.0f);
-    lane_f32 SpecularIntensity = InitLaneF32(8.0f);
-    
-    lane_v3 Specular = SpecularColor * SpecularHighlight * SpecularIntensity;
-    
-    lane_v3 AmbientCol = InitLaneV3(0.1f, 0.0f, 0.0f);
-    lane_v3 FinalColor = AmbientCol + Diffuse + Specular;
-    
-    FinalColor.X = LinearToSRGB(FinalColor.X);
-    FinalColor.Y = LinearToSRGB(FinalColor.Y);
-    FinalColor.Z = LinearToSRGB(FinalColor.Z);
-    
-    FinalColor.X = Min(FinalColor.X, LaneOneF32);
-    FinalColor.Y = Min(FinalColor.Y, LaneOneF32);
-    FinalColor.Z = Min(FinalColor.Z, LaneOneF32);
-    return FinalColor;
-}
-
-vector3 LightPosition = {-3.0f, -8.0f, 0.0f};
-const color LightColor = {0.3f, 1.0f, 0.4f};
-const float LightPower = 40.0;
-const float SpecularCoefficient = 8.0;
-
-const vector3 CamPosition = {0.0f, 0.0f, 0.0f};
-
-const float Shininess = 32.0;
-
-const color AmbientColor = {0.1f, 0.0f, 0.0f};
-const color DiffuseColor = {1.0f, 0.0f, 0.0f};
-const color SpecColor = {1.0f, 1.0f, 1.0f};
-
-const float ScreenGamma = 2.2f;
-const float InvScreenGamma = 1.0f / ScreenGamma;
-
-inline float srgb_to_linear(float x) 
-{
-    return (x <= 0.04045f) ? x / 12.92f : powf((x + 0.055f) / 1.055f, 2.4f);
-}
-
-inline float linear_to_srgb(float x) 
-{
-    return (x <= 0.0031308f) ? x * 12.92f : 1.055f * powf(x, 1.0f / 2.4f);
-}
-
-struct edge 
-{
-    // Dimensions of our pixel group
-    static const int StepXSize = LANE_WIDTH > 1 ? LANE_WIDTH / 2 : 1;
-    static const int StepYSize = LANE_WIDTH > 1 ? LANE_WIDTH / StepXSize : 1;
-    
-    //static const int StepXSize = LANE_WIDTH;
-    //static const int StepYSize = 1;
-    
-    lane_i32 OneStepX;
-    lane_i32 OneStepY;
-};
+global_variable mesh_handle CubeVertexBuffer;
 
-internal lane_i32
-InitEdge(edge* Edge, const vector2i& V0, const vector2i&V1, const vector2i& Origin)
+// NOTE: The key light reaches everything, the local lights are spread over a cylinder around
+// the meshes with the golden angle and turn with them. Their hue goes round the color wheel.
+internal void
+PlaceSceneLights(scene_lights* Lights, uint32_t LocalLightCount, float YRot)
 {
-    // Edge setup
-    int32_t A = V0.Y - V1.Y;
-    int32_t B = V1.X - V0.X;
-    int32_t C = V0.X * V1.Y - V0.Y * V1.X;
-    
-    // Step deltas
-    Edge->OneStepX = InitLaneI32(A * edge::StepXSize);
-    Edge->OneStepY = InitLaneI32(B * edge::StepYSize);
-    
-    // x/y values for initial pixel block
-    int32_t XValues[LANE_WIDTH];
-    int32_t YValues[LANE_WIDTH];
-    int32_t LaneCounter = 0;
-    for(int32_t YOffset = 0; YOffset < edge::StepYSize; ++YOffset)
+    LocalLightCount = MIN(LocalLightCount, MAX_SCENE_LIGHT_COUNT - 1);
+    Lights->Count = LocalLightCount + 1;
+    Lights->PositionsX[0] = -3.0f;
+    Lights->PositionsY[0] = -8.0f;
+    Lights->PositionsZ[0] = 0.0f;
+    Lights->ColorsX[0] = 1.0f;
+    Lights->ColorsY[0] = 1.0f;
+    Lights->ColorsZ[0] = 1.0f;
+    Lights->Radii[0] = 0.0f;
+    
+    float GoldenAngle = PI_FLOAT * (3.0f - SquareRoot(5.0f));
+    float Turn = YRot * PI_FLOAT / 180.0f;
+    for(uint32_t Index = 0; Index < LocalLightCount; ++Index)
     {
-        for(int32_t XOffset = 0; XOffset < edge::StepXSize; ++XOffset)
-        {
-            XValues[LaneCounter] = Origin.X + XOffset;
-            YValues[LaneCounter] = Origin.Y + YOffset;
-            ++LaneCounter;
-        }
-    }
-    
-    
-    
-    lane_i32 x = LoadLaneI32(XValues);
-    lane_i32 y = LoadLaneI32(YValues);
-    
-    // Edge function values at origin
-    return A * x + B * y + InitLaneI32(C);
-}
-
-
-internal int32_t 
-EdgeFunction(vector2i A, vector2i B, vector2i C)
-{
-    return (B.X - A.X) * (C.Y - A.Y) - (B.Y - A.Y) * (C.X - A.X);
-}
-
-internal float 
-EdgeFunction(vector2 A, vector2 B, vector2 C)
-{
-    return (B.X - A.X) * (C.Y - A.Y) - (B.Y - A.Y) * (C.X - A.X);
-}
-
-internal void 
-RasterizeRegion(game_state* GameState,
-                game_offscreen_buffer* Buffer, 
-                int32_t StartWidth, int32_t StartHeight,
-                int32_t EndWidth, int32_t EndHeight,
-                uint32_t IndexOffset,
-                vector2i* ScreenPositions,
-                vector3* Positions,
-                vector3* Normals)
-{
-    
-    vector2i V0 = ScreenPositions[IndexOffset + 0];
-    vector2i V1 = ScreenPositions[IndexOffset + 1];
-    vector2i V2 = ScreenPositions[IndexOffset + 2];
-    vector2i P = { StartWidth, StartHeight };
-    
-    float Area = (float)EdgeFunction(V0, V1, V2);
-    
-    edge E01, E12, E20;
-    
-    lane_i32 W0Row = InitEdge(&E12, V1, V2, P);
-    lane_i32 W1Row = InitEdge(&E20, V2, V0, P);
-    lane_i32 W2Row = InitEdge(&E01, V0, V1, P);
-    
-    for (int32_t j = StartHeight; j <= EndHeight; j += edge::StepYSize) 
-    { 
-        // Barycentric coordinates at start of row
-        lane_i32 W0 = W0Row;
-        lane_i32 W1 = W1Row;
-        lane_i32 W2 = W2Row;
-        for (int32_t i = StartWidth; i <= EndWidth; i += edge::StepXSize) 
-        {
-            lane_i32 Mask = LaneZeroI32 < (W0 | W1 | W2);
-            if (!IsAllZeros(Mask)) 
-            {
-                lane_i32 MaskedW0;
-                lane_i32 MaskedW1;
-                lane_i32 MaskedW2;
-                ConditionalAssign(W0, &MaskedW0, Mask);
-                ConditionalAssign(W1, &MaskedW1, Mask);
-                ConditionalAssign(W2, &MaskedW2, Mask);
-                lane_f32 W0ratio = ConvertLaneI32ToF32(MaskedW0);
-                lane_f32 W1ratio = ConvertLaneI32ToF32(MaskedW1);
-                lane_f32 W2ratio = ConvertLaneI32ToF32(MaskedW2);
-                
-                lane_f32 AreaVec = InitLaneF32(Area);
-                W0ratio = W0ratio / AreaVec;
-                W1ratio = W1ratio / AreaVec;
-                W2ratio = W2ratio / AreaVec;
-                
-                vector3 PositionsWide[LANE_WIDTH];
-                vector3 NormalsWide[LANE_WIDTH];
-                for(uint32_t k = 0; k < LANE_WIDTH; ++k)
-                {
-                    PositionsWide[k] = GetLane(W0ratio, k) * Positions[IndexOffset] + GetLane(W1ratio, k) * Positions[IndexOffset + 1] + GetLane(W2ratio, k) * Positions[IndexOffset + 2];
-                    
-                    NormalsWide[k] = GetLane(W0ratio, k) * Normals[IndexOffset] + GetLane(W1ratio, k) * Normals[IndexOffset + 1]   + GetLane(W2ratio, k) * Normals[IndexOffset + 2];
-                }
-                
-                lane_v3 LanePositions = LoadLaneV3(PositionsWide);
-                lane_v3 LaneNormals = LoadLaneV3(NormalsWide);
-                LaneNormals = Normalize(LaneNormals);
-                
-                lane_v3 FragmentColor = FragmentStage(LanePositions, LaneNormals);
-                
-                int32_t LaneCount = 0;
-#if SABLUJO_INTERNAL
-                GameState->RenderStats.PixelsComputed += LANE_WIDTH;
-                int32_t Waste = LANE_WIDTH;
-#endif
-                for(int32_t YOffset = 0; YOffset < edge::StepYSize; ++YOffset)
-                {
-                    for(int32_t XOffset = 0; XOffset < edge::StepXSize; ++XOffset)
-                    {
-                        if(GetLane(Mask, LaneCount))
-                        {
-                            ((uint32_t*)Buffer->Memory)[(j + YOffset) * Buffer->Width + i + XOffset] = ColorToUInt32({GetLane(FragmentColor.X, LaneCount), GetLane(FragmentColor.Y, LaneCount), GetLane(FragmentColor.Z, LaneCount)});
-#if SABLUJO_INTERNAL
-                            --Waste;
-#endif
-                        }
-                        ++LaneCount;
-                    }
-                }
-#if SABLUJO_INTERNAL
-                GameState->RenderStats.PixelsWasted += Waste;
-#endif
-            }
-#if SABLUJO_INTERNAL
-            else
-            {
-                GameState->RenderStats.PixelsSkipped += edge::StepYSize * edge::StepXSize;
-            }
-#endif
-            // One step to the right
-            W0 += E12.OneStepX;
-            W1 += E20.OneStepX;
-            W2 += E01.OneStepX;       
-        }
+        uint32_t Light = Index + 1;
+        float T = ((float)Index + 0.5f) / (float)LocalLightCount;
+        float Angle = GoldenAngle * (float)Index + Turn;
+        Lights->PositionsX[Light] = 2.0f * Cosine(Angle);
+        Lights->PositionsY[Light] = 3.0f * T - 1.5f;
+        Lights->PositionsZ[Light] = 2.0f + 2.0f * Sine(Angle);
         
-        // One row step
-        W0Row += E12.OneStepY;
-        W1Row += E20.OneStepY;
-        W2Row += E01.OneStepY;
+        float Hue = 2.0f * PI_FLOAT * T;
+        Lights->ColorsX[Light] = 0.02f * (1.0f + Cosine(Hue));
+        Lights->ColorsY[Light] = 0.02f * (1.0f + Cosine(Hue - 2.0f * PI_FLOAT / 3.0f));
+        Lights->ColorsZ[Light] = 0.02f * (1.0f + Cosine(Hue + 2.0f * PI_FLOAT / 3.0f));
+        Lights->Radii[Light] = 1.5f;
     }
-}
-
-internal void 
-RasterizeMesh(game_state* GameState,
-              game_memory* Memory, 
-              game_offscreen_buffer* Buffer, 
-              mesh* Mesh)
-{
-    Assert((sizeof(vector2i) + sizeof(vector3) * 2) * Mesh->IndicesCount <= Memory->TransientStorageSize);
-    void* AssignPointer = Memory->TransientStorage;
-    vector2i* TriangleVertices = (vector2i*)AssignPointer;
-    AssignPointer = (vector2i*)AssignPointer + Mesh->IndicesCount;    
-    
-    vector3* TrianglePositions = (vector3*)AssignPointer;
-    AssignPointer = (vector3*)AssignPointer + Mesh->IndicesCount;    
     
-    vector3* TriangleNormals = (vector3*)AssignPointer;
-    AssignPointer = (vector3*)AssignPointer + Mesh->IndicesCount;
-    //    vector3 TrianglePositions[Mesh->IndicesCount];
-    //    vector3 TriangleNormals[Mesh->IndicesCount];
-    
-    VertexStage(GameState, Mesh, 
-                Buffer->Width, Buffer->Height, 
-                TriangleVertices, TrianglePositions, TriangleNormals);
-    
-    for (uint32_t i = 0; i < Mesh->IndicesCount; i+=3) 
+    // NOTE: Sky from above, warm bounce from the ground and a cool fill from the camera side,
+    // up is -Y
+    float DistantLights[][6] = 
     {
-        vector2i V0 = TriangleVertices[i+0];
-        vector2i V1 = TriangleVertices[i+1];
-        vector2i V2 = TriangleVertices[i+2];
-#if SABLUJO_INTERNAL
-        ++GameState->RenderStats.TrianglesCount;
-#endif
-        
-        int32_t MinX = MIN(V0.X, MIN(V1.X, V2.X));
-        int32_t MinY = MIN(V0.Y, MIN(V1.Y, V2.Y));
-        int32_t MaxX = MAX(V0.X, MAX(V1.X, V2.X));
-        int32_t MaxY = MAX(V0.Y, MAX(V1.Y, V2.Y));
-        
-        // Clip against screen bounds
-        MinX = MAX(MinX, 0);
-        MinY = MAX(MinY, 0);
-        MaxX = MIN(MaxX, Buffer->Width - 1);
-        MaxY = MIN(MaxY, Buffer->Height - 1);
-        RasterizeRegion(GameState, Buffer, MinX, MinY, MaxX, MaxY, i, TriangleVertices, TrianglePositions, TriangleNormals);
+        { 0.0f, -1.0f,  0.0f, 1.0f, 1.0f, 1.1f},
+        { 0.0f,  1.0f,  0.0f, 0.6f, 0.5f, 0.4f},
+        { 0.0f,  0.0f, -1.0f, 0.3f, 0.35f, 0.45f},
+    };
+    Lights->DistantCount = ArrayCount(DistantLights);
+    for(uint32_t Light = 0; Light < Lights->DistantCount; ++Light)
+    {
+        Lights->DistantDirectionsX[Light] = DistantLights[Light][0];
+        Lights->DistantDirectionsY[Light] = DistantLights[Light][1];
+        Lights->DistantDirectionsZ[Light] = DistantLights[Light][2];
+        Lights->DistantColorsX[Light] = DistantLights[Light][3];
+        Lights->DistantColorsY[Light] = DistantLights[Light][4];
+        Lights->DistantColorsZ[Light] = DistantLights[Light][5];
     }
 }
 
-global_variable mesh_handle CubeVertexBuffer;
-
-extern "C" void GameUpdateAndRender(game_memory* Memory, game_offscreen_buffer* Buffer)
+internal game_state*
+UpdateScene(game_memory* Memory, int32_t ImageWidth, int32_t ImageHeight)
 {
     Assert(sizeof(game_state) <= Memory->PermanentStorageSize);
     game_state *GameState = (game_state *)Memory->PermanentStorage;
@@ -420,16 +132,42 @@ extern "C" void GameUpdateAndRender(game_memory* Memory, game_offscreen_buffer*
     GameState->RenderStats = {};
 #endif
     camera* Camera = &GameState->Camera;
+    material* Red = &GameState->Materials[0];
+    Red->DiffuseColor = {1.0f, 0.0f, 0.0f};
+    Red->DiffuseIntensity = 40.0f;
+    Red->SpecularColor = {1.0f, 1.0f, 1.0f};
+    Red->SpecularIntensity = 8.0f;
+    Red->AmbientColor = {0.1f, 0.0f, 0.0f};
+    Red->DiffuseTexture = 0;
+    material* Checker = &GameState->Materials[1];
+    Checker->DiffuseColor = {1.0f, 1.0f, 1.0f};
+    Checker->DiffuseIntensity = 10.0f;
+    Checker->SpecularColor = {1.0f, 1.0f, 1.0f};
+    Checker->SpecularIntensity = 8.0f;
+    Checker->AmbientColor = {0.1f, 0.1f, 0.1f};
+    Checker->DiffuseTexture = &GameState->Textures[Memory->SceneTextureFormat];
+    material* Gray = &GameState->Materials[2];
+    Gray->DiffuseColor = {0.8f, 0.8f, 0.8f};
+    Gray->DiffuseIntensity = 1.0f;
+    Gray->SpecularColor = {0.2f, 0.2f, 0.2f};
+    Gray->SpecularIntensity = 2.0f;
+    Gray->AmbientColor = {0.1f, 0.1f, 0.1f};
+    Gray->DiffuseTexture = 0;
+    
     GameState->Meshes[0] = {};
     GameState->Meshes[1] = {};
+    GameState->Meshes[2] = {};
     mesh* Cube = &GameState->Meshes[0];
     mesh* Sphere = &GameState->Meshes[1];
+    mesh* Floor = &GameState->Meshes[2];
     
     Cube->Vertices = CubeVertices;
     Cube->Normals = CubeNormals;
     Cube->Indices = CubeIndices;
     Cube->VerticesCount = CubeVerticesCount;
     Cube->IndicesCount = CubeIndicesCount;
+    Cube->ShadingMode = Memory->SceneShadingMode;
+    Cube->Shader = Memory->SceneShader;
     
     if(Memory->Renderer.CreateVertexBuffer != nullptr && CubeVertexBuffer == INVALID_HANDLE)
     {
@@ -439,29 +177,80 @@ extern "C" void GameUpdateAndRender(game_memory* Memory, game_offscreen_buffer*
     vector3* SphereVertices = (vector3*)((uint8_t*)Memory->PermanentStorage + sizeof(game_state));
     vector3* SphereNormals = (vector3*)(SphereVertices + sizeof(vector4) * SPHERE_VERTEX_COUNT);
     uint32_t* SphereIndices = (uint32_t*)(SphereNormals + sizeof(vector3) * SPHERE_VERTEX_COUNT);
-    Assert((uintptr_t)(SphereIndices + SPHERE_INDEX_COUNT) <= (uintptr_t)Memory->PermanentStorage + Memory->PermanentStorageSize);
+    vector2* SphereTexCoords = (vector2*)(SphereIndices + SPHERE_INDEX_COUNT);
+    uint32_t* SceneTexels = (uint32_t*)(((uintptr_t)(SphereTexCoords + SPHERE_VERTEX_COUNT) + 63) & ~(uintptr_t)63);
+    // NOTE: The compressed copies of the texture follow its texels, one format after the other
+    uint8_t* SceneBlocks = (uint8_t*)(SceneTexels + GetTextureTexelCount(SCENE_TEXTURE_LOG_SIZE));
+    uint8_t* SceneBlocksEnd = SceneBlocks;
+    for(uint32_t Format = TextureFormat_RGBA8 + 1; Format < TextureFormat_Count; ++Format)
+    {
+        SceneBlocksEnd += GetCompressedTextureSize((texture_format)Format, SCENE_TEXTURE_LOG_SIZE);
+    }
+    Assert((uintptr_t)SceneBlocksEnd <= (uintptr_t)Memory->PermanentStorage + Memory->PermanentStorageSize);
     
     Sphere->Vertices = SphereVertices;
     Sphere->Normals = SphereNormals;
+    Sphere->TexCoords = SphereTexCoords;
     Sphere->Indices = SphereIndices;
     Sphere->VerticesCount = SPHERE_VERTEX_COUNT;
     Sphere->IndicesCount = SPHERE_INDEX_COUNT;
+    Sphere->ShadingMode = Memory->SceneShadingMode;
+    Sphere->ShadingFrequency = Memory->SphereShadingFrequency;
+    Sphere->Shader = Memory->SceneShader;
+    Sphere->MaterialIndex = Memory->SceneTextures ? 1 : 0;
+    
+    // NOTE: Left out entirely without shadows
+    Floor->Vertices = FloorVertices;
+    Floor->Normals = FloorNormals;
+    Floor->Indices = FloorIndices;
+    Floor->VerticesCount = FloorVerticesCount;
+    Floor->IndicesCount = Memory->SceneShadows != ShadowMode_Off ? FloorIndicesCount : 0;
+    Floor->ShadingMode = Memory->SceneShadingMode;
+    Floor->Shader = Memory->SceneShader;
+    Floor->MaterialIndex = 2;
+    
+    texture* SceneTexture = &GameState->Textures[TextureFormat_RGBA8];
+    SceneTexture->Format = TextureFormat_RGBA8;
+    SceneTexture->LogSize = SCENE_TEXTURE_LOG_SIZE;
+    SceneTexture->Texels = SceneTexels;
     
     if(!Camera->IsInitialized)
     {
-        InitializeCamera(Camera, Buffer->Width, Buffer->Height);
+        InitializeCamera(Camera, ImageWidth, ImageHeight);
+        LoadBlockShapeThresholds(Memory, &GameState->BlockShapeThresholds);
+        GameState->BlockShapeCalibration = {};
+        if(Memory->CalibrateBlockShapes)
+        {
+            GameState->BlockShapeCalibration.FramesRemaining = BLOCK_SHAPE_CALIBRATION_FRAMES;
+        }
         CreateSphere(SPHERE_SUBDIV, SPHERE_SUBDIV, 
-                     Sphere->Vertices, Sphere->Normals, Sphere->Indices, 
+                     Sphere->Vertices, Sphere->Normals, Sphere->TexCoords, Sphere->Indices, 
                      SPHERE_VERTEX_COUNT, SPHERE_INDEX_COUNT);
+        
+        // NOTE: 8x8 squares of white and light blue
+        uint32_t TextureSize = 1 << SCENE_TEXTURE_LOG_SIZE;
+        for(uint32_t Y = 0; Y < TextureSize; ++Y)
+        {
+            for(uint32_t X = 0; X < TextureSize; ++X)
+            {
+                bool IsWhite = (((X ^ Y) >> (SCENE_TEXTURE_LOG_SIZE - 3)) & 1) != 0;
+                *GetTextureTexel(SceneTexture, 0, X, Y) = IsWhite ? 0xFFFFFFFF : 0xFF90B8E8;
+            }
+        }
+        BuildTextureMips(SceneTexture);
+        for(uint32_t Format = TextureFormat_RGBA8 + 1; Format < TextureFormat_Count; ++Format)
+        {
+            CompressTexture(SceneTexture, (texture_format)Format, SceneBlocks, &GameState->Textures[Format]);
+            SceneBlocks += GetCompressedTextureSize((texture_format)Format, SCENE_TEXTURE_LOG_SIZE);
+        }
     }
     
-    ClearBuffer(Buffer);
-    
     float AngleRad = 0.0f + GameState->YRot * PI_FLOAT / 180.0f;
     matrix4 YRotMatrix = GetYRotationMatrix(AngleRad);
     AngleRad = 0.0f * PI_FLOAT / 180.0f;
     matrix4 XRotMatrix = GetXRotationMatrix(AngleRad);
     matrix4 Rotation = MultMatrixMatrix(&YRotMatrix,&XRotMatrix);;
+    PlaceSceneLights(&GameState->Lights, Memory->SceneLocalLightCount, GameState->YRot);
     GameState->YRot += .5f;
     
     matrix4 Translation = {};
@@ -485,23 +274,141 @@ extern "C" void GameUpdateAndRender(game_memory* Memory, game_offscreen_buffer*
     Cube->InverseTransform = InverseMatrix(&Cube->Transform);
     Cube->InverseTransform = TransposeMatrix(&Cube->InverseTransform);
     
+    // NOTE: Doesn't turn, the bottom of the sphere rests on it
+    Translation.val[3][0] = 0.0f;
+    Translation.val[3][1] = 1.0f;
+    Translation.val[3][2] = 4.0f;
+    Floor->Transform = Translation;
+    Floor->InverseTransform = InverseMatrix(&Floor->Transform);
+    Floor->InverseTransform = TransposeMatrix(&Floor->InverseTransform);
+    
+    return GameState;
+}
+
+internal render_frame*
+BeginSceneFrame(memory_arena* Arena, game_memory* Memory, game_state* GameState,
+                camera* Camera, int32_t ImageWidth, int32_t ImageHeight, bool AllowCalibration)
+{
+    uint32_t IndicesCount = 0;
     for(uint32_t i = 0; i < ArrayCount(GameState->Meshes); ++i)
     {
-        RasterizeMesh(GameState, Memory, Buffer, &GameState->Meshes[i]);
+        IndicesCount += GameState->Meshes[i].IndicesCount;
     }
     
-#if SABLUJO_INTERNAL
-    uint32_t PixelsComputed = GameState->RenderStats.PixelsComputed;
-    uint32_t PixelsWasted = GameState->RenderStats.PixelsWasted;
-    char StatsMessage [256];
-    
-    Memory->Platform.DEBUGFormatString(StatsMessage,
-                                       256,
-                                       "Fragments (%dx%d)\nPixels Skipped: %d\nPixels Computed: %d\nPixels Computation Wasted: %d(%.3f%%)\n" , edge::StepXSize, edge::StepYSize, 
-                                       GameState->RenderStats.PixelsSkipped, 
-                                       PixelsComputed, 
-                                       PixelsWasted,
-                                       100.0f * (float)PixelsWasted / (float)PixelsComputed);
-    Memory->Platform.DEBUGPrintLine(StatsMessage);
-#endif
-}
\ No newline at end of file
+    render_frame* Frame = BeginRenderFrame(Arena, Memory, GameState, Camera, ImageWidth, ImageHeight,
+                                           IndicesCount, AllowCalibration);
+    mesh* Draws[ArrayCount(GameState->Meshes)];
+    for(uint32_t i = 0; i < ArrayCount(GameState->Meshes); ++i)
+    {
+        Draws[i] = &GameState->Meshes[i];
+    }
+    SortMeshDraws(Arena, Frame, GameState, Draws, ArrayCount(Draws));
+    if(Memory->SceneShadows != ShadowMode_Off)
+    {
+        // NOTE: The floor only receives, the map is fitted around the two objects
+        mesh* Casters[] = {&GameState->Meshes[0], &GameState->Meshes[1]};
+        RenderShadowMap(Arena, Memory, Frame, Casters, ArrayCount(Casters),
+                        Memory->SceneShadows == ShadowMode_Filtered);
+    }
+    for(uint32_t i = 0; i < ArrayCount(Draws); ++i)
+    {
+        PushMesh(Arena, Frame, GameState, Draws[i]);
+    }
+    
+    if(Memory->ShadingRateMode == ShadingRateMode_Foveated)
+    {
+        int32_t TileCountX = (ImageWidth + SHADING_RATE_TILE_SIZE - 1) / SHADING_RATE_TILE_SIZE;
+        int32_t TileCountY = (ImageHeight + SHADING_RATE_TILE_SIZE - 1) / SHADING_RATE_TILE_SIZE;
+        uint8_t* Rates = PushArray(Arena, TileCountX * TileCountY, uint8_t);
+        float HalfWidth = 0.5f * (float)ImageWidth;
+        float HalfHeight = 0.5f * (float)ImageHeight;
+        float CornerDistanceSq = HalfWidth * HalfWidth + HalfHeight * HalfHeight;
+        for(int32_t TileY = 0; TileY < TileCountY; ++TileY)
+        {
+            for(int32_t TileX = 0; TileX < TileCountX; ++TileX)
+            {
+                float X = ((float)TileX + 0.5f) * SHADING_RATE_TILE_SIZE - HalfWidth;
+                float Y = ((float)TileY + 0.5f) * SHADING_RATE_TILE_SIZE - HalfHeight;
+                float DistanceSq = (X * X + Y * Y) / CornerDistanceSq;
+                shading_rate Rate = ShadingRate_4x4;
+                if(DistanceSq < FOVEATED_FULL_RATE_RADIUS * FOVEATED_FULL_RATE_RADIUS)
+                {
+                    Rate = ShadingRate_1x1;
+                }
+                else if(DistanceSq < FOVEATED_HALF_RATE_RADIUS * FOVEATED_HALF_RATE_RADIUS)
+                {
+                    Rate = ShadingRate_2x2;
+                }
+                Rates[TileY * TileCountX + TileX] = (uint8_t)Rate;
+            }
+        }
+        SetShadingRateImage(Frame, Rates, TileCountX, TileCountY);
+    }
+    return Frame;
+}
+
+extern "C" void GameUpdateAndRender(game_memory* Memory, game_offscreen_buffer* Buffer)
+{
+    game_state* GameState = UpdateScene(Memory, Buffer->Width, Buffer->Height);
+    
+    memory_arena FrameArena;
+    InitializeArena(&FrameArena, Memory->TransientStorageSize, Memory->TransientStorage);
+    
+    render_frame* Frame = BeginSceneFrame(&FrameArena, Memory, GameState, &GameState->Camera,
+                                          Buffer->Width, Buffer->Height, true);
+    RenderFrame(&FrameArena, Memory, GameState, Frame, Buffer, 0, 0);
+    EndRenderFrame(Memory, GameState, Frame);
+}
+
+extern "C" bool GameRenderOffline(game_memory* Memory, int32_t ImageWidth, int32_t ImageHeight, char* FileName)
+{
+    game_state* GameState = UpdateScene(Memory, ImageWidth, ImageHeight);
+    // NOTE: The poster keeps its own aspect ratio whatever the window was, without touching
+    // the interactive camera
+    camera PosterCamera;
+    InitializeCamera(&PosterCamera, ImageWidth, ImageHeight);
+    
+    memory_arena FrameArena;
+    InitializeArena(&FrameArena, Memory->TransientStorageSize, Memory->TransientStorage);
+    
+    // Vertex work and coarse binning happen once, every chunk reuses them. The block shape
+    // calibration stays with the interactive frames, the poster would rasterize every chunk
+    // once per shape and count a frame down at a resolution it never sees again
+    render_frame* Frame = BeginSceneFrame(&FrameArena, Memory, GameState, &PosterCamera,
+                                          ImageWidth, ImageHeight, false);
+    triangle_bins* Chunks = BinFrameTriangles(&FrameArena, Frame, OFFLINE_CHUNK_SIZE);
+    
+    tiff_writer Writer;
+    if(!BeginTIFF(&Writer, &Memory->Platform, &FrameArena, FileName, ImageWidth, ImageHeight))
+    {
+        EndTIFF(&Writer);
+        return false;
+    }
+    
+    game_offscreen_buffer Buffer = {};
+    Buffer.Pitch = OFFLINE_CHUNK_SIZE * sizeof(uint32_t);
+    Buffer.Memory = PushArray(&FrameArena, OFFLINE_CHUNK_SIZE * OFFLINE_CHUNK_SIZE, uint32_t);
+    for(int32_t ChunkY = 0; ChunkY < Chunks->TileCountY; ++ChunkY)
+    {
+        for(int32_t ChunkX = 0; ChunkX < Chunks->TileCountX; ++ChunkX)
+        {
+            Buffer.OriginX = ChunkX * OFFLINE_CHUNK_SIZE;
+            Buffer.OriginY = ChunkY * OFFLINE_CHUNK_SIZE;
+            Buffer.Width = MIN(OFFLINE_CHUNK_SIZE, ImageWidth - Buffer.OriginX);
+            Buffer.Height = MIN(OFFLINE_CHUNK_SIZE, ImageHeight - Buffer.OriginY);
+            
+            uint32_t ChunkIndex = ChunkY * Chunks->TileCountX + ChunkX;
+            uint32_t* ChunkTriangles = Chunks->Triangles + Chunks->TriangleOffsets[ChunkIndex];
+            uint32_t ChunkTrianglesCount = Chunks->TriangleOffsets[ChunkIndex + 1] - Chunks->TriangleOffsets[ChunkIndex];
+            
+            temporary_memory ChunkMemory = BeginTemporaryMemory(&FrameArena);
+            RenderFrame(&FrameArena, Memory, GameState, Frame, &Buffer, ChunkTriangles, ChunkTrianglesCount);
+            EndTemporaryMemory(ChunkMemory);
+            
+            WriteTIFFTiles(&Writer, &Buffer);
+        }
+    }
+    
+    EndRenderFrame(Memory, GameState, Frame);
+    return EndTIFF(&Writer);
+}
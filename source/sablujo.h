@@ -1,9 +1,125 @@
 #if !defined(SABLUJO_H)
 
 #include <stdint.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
 #include "sablujo_defines.h"
 #include "sablujo_maths.h"
 
+/////////////////////////
+// Atomics
+/////////////////////////
+inline uint32_t
+AtomicIncrementUInt32(uint32_t volatile* Value)
+{
+#if defined(_MSC_VER)
+    return (uint32_t)_InterlockedIncrement((long volatile*)Value);
+#else
+    return __sync_add_and_fetch(Value, 1);
+#endif
+}
+
+inline uint64_t
+AtomicCompareExchangeUInt64(uint64_t volatile* Value, uint64_t New, uint64_t Expected)
+{
+#if defined(_MSC_VER)
+    return (uint64_t)_InterlockedCompareExchange64((__int64 volatile*)Value, (__int64)New, (__int64)Expected);
+#else
+    return __sync_val_compare_and_swap(Value, Expected, New);
+#endif
+}
+
+/////////////////////////
+// CPU features
+/////////////////////////
+inline void
+GetCPUID(int32_t Leaf, int32_t SubLeaf, int32_t* Info)
+{
+#if defined(_MSC_VER)
+    __cpuidex(Info, Leaf, SubLeaf);
+#else
+    __cpuid_count(Leaf, SubLeaf, Info[0], Info[1], Info[2], Info[3]);
+#endif
+}
+
+// NOTE: Register states the OS saves on context switches, only valid when cpuid reports OSXSAVE
+inline uint64_t
+GetEnabledRegisterStates(void)
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t Low, High;
+    __asm__ volatile("xgetbv" : "=a"(Low), "=d"(High) : "c"(0));
+    return ((uint64_t)High << 32) | Low;
+#endif
+}
+
+/////////////////////////
+// Memory arena
+/////////////////////////
+struct memory_arena
+{
+    size_t Size;
+    uint8_t* Base;
+    size_t Used;
+};
+
+inline void
+InitializeArena(memory_arena* Arena, size_t Size, void* Base)
+{
+    Arena->Size = Size;
+    Arena->Base = (uint8_t*)Base;
+    Arena->Used = 0;
+}
+
+inline void*
+PushSize_(memory_arena* Arena, size_t Size, size_t Alignment = 16)
+{
+    size_t AlignmentOffset = 0;
+    size_t ResultPointer = (size_t)Arena->Base + Arena->Used;
+    size_t AlignmentMask = Alignment - 1;
+    if(ResultPointer & AlignmentMask)
+    {
+        AlignmentOffset = Alignment - (ResultPointer & AlignmentMask);
+    }
+    Size += AlignmentOffset;
+    
+    Assert(Arena->Used + Size <= Arena->Size);
+    void* Result = (void*)(ResultPointer + AlignmentOffset);
+    Arena->Used += Size;
+    return Result;
+}
+
+#define PushStruct(Arena, type) (type*)PushSize_(Arena, sizeof(type))
+#define PushArray(Arena, Count, type) (type*)PushSize_(Arena, (Count) * sizeof(type))
+
+struct temporary_memory
+{
+    memory_arena* Arena;
+    size_t Used;
+};
+
+inline temporary_memory
+BeginTemporaryMemory(memory_arena* Arena)
+{
+    temporary_memory Result;
+    Result.Arena = Arena;
+    Result.Used = Arena->Used;
+    return Result;
+}
+
+inline void
+EndTemporaryMemory(temporary_memory TempMemory)
+{
+    Assert(TempMemory.Arena->Used >= TempMemory.Used);
+    TempMemory.Arena->Used = TempMemory.Used;
+}
+
 /////////////////////////
 // Platform abstraction
 /////////////////////////
@@ -13,8 +129,36 @@ typedef int32_t debug_platform_format_string(char* Buffer,
                                              ...);
 typedef void debug_platform_print_line(char* String);
 
+struct platform_work_queue;
+// NOTE: ThreadIndex is 0 for the main thread and unique for each worker thread
+typedef void platform_work_queue_callback(platform_work_queue* Queue, uint32_t ThreadIndex, void* Data);
+
+typedef void platform_add_entry(platform_work_queue* Queue, platform_work_queue_callback* Callback, void* Data);
+typedef void platform_complete_all_work(platform_work_queue* Queue);
+
+// NOTE: Any failure clears NoErrors, following writes on the handle do nothing
+struct platform_file_handle
+{
+    bool NoErrors;
+    void* Platform;
+};
+
+typedef platform_file_handle platform_open_file_for_reading(char* FileName);
+typedef platform_file_handle platform_open_file_for_writing(char* FileName);
+// NOTE: Reading past the end of the file is an error
+typedef void platform_read_file_at(platform_file_handle* Handle, uint64_t Offset, uint64_t Size, void* Dest);
+typedef void platform_write_file_at(platform_file_handle* Handle, uint64_t Offset, uint64_t Size, void* Source);
+typedef void platform_close_file(platform_file_handle* Handle);
+
 struct platform_calls
 {
+    platform_add_entry* AddEntry;
+    platform_complete_all_work* CompleteAllWork;
+    platform_open_file_for_reading* OpenFileForReading;
+    platform_open_file_for_writing* OpenFileForWriting;
+    platform_read_file_at* ReadFileAt;
+    platform_write_file_at* WriteFileAt;
+    platform_close_file* CloseFile;
 #if SABLUJO_INTERNAL
     debug_platform_format_string* DEBUGFormatString;
     debug_platform_print_line* DEBUGPrintLine;
@@ -54,6 +198,98 @@ struct renderer_calls
     create_vertex_buffer* CreateVertexBuffer;
 };
 
+#define MAX_RENDER_THREAD_COUNT 64
+
+// NOTE: Instruction sets the raster kernels are built for, ordered from the narrowest
+enum raster_tier
+{
+    RasterTier_Auto,
+    RasterTier_Scalar,
+    RasterTier_SSE4,
+    RasterTier_AVX2,
+    RasterTier_AVX512,
+    
+    RasterTier_Count
+};
+
+// NOTE: Fixed16 shades in 16-bit fixed point, 16 pixels at a time in 4x4 blocks whatever the
+// block shape. It's meant for previews, tiers without it fall back to the float shading.
+enum shading_mode
+{
+    ShadingMode_Float,
+    ShadingMode_Fixed16,
+};
+
+// NOTE: Vertex lights each vertex once in the vertex stage and only interpolates the colors over
+// the triangles, cheap for dense meshes far away. Forward mode only, the others light per pixel.
+enum shading_frequency
+{
+    ShadingFrequency_Pixel,
+    ShadingFrequency_Vertex,
+};
+
+// NOTE: Forward mode only, the other modes shade every mesh with Phong and its texture. Gouraud
+// and Textured aren't set on meshes, the vertex shading frequency turns Phong into Gouraud and
+// a textured material turns it into Textured.
+enum shader_type
+{
+    Shader_Phong,
+    Shader_Gouraud,
+    Shader_Normals,
+    Shader_Textured,
+    
+    Shader_Count,
+};
+
+// NOTE: The block compressed formats keep 4x4 texel blocks of 8 or 16 bytes in memory, the
+// sampler decodes the blocks it touches. Every format holds sRGB values.
+enum texture_format
+{
+    TextureFormat_RGBA8,
+    // NOTE: Two RGB565 endpoints and a 2 bit index per texel, 4 bits per texel
+    TextureFormat_BC1,
+    // NOTE: One channel, two 8 bit endpoints and a 3 bit index per texel, sampled as gray
+    TextureFormat_BC4,
+    // NOTE: Two BC4 blocks, red then green, sampled with no blue
+    TextureFormat_BC5,
+    
+    TextureFormat_Count,
+};
+
+// NOTE: VisibilityBuffer rasterizes depth and a triangle id per pixel first, then shades
+// every visible pixel once. Deferred rasterizes the shading inputs of the whole frame to a
+// G-buffer, then lights it in a second pass. Checkerboard is the visibility buffer shading
+// half of the pixels, alternating each frame, and rebuilding the others from their
+// neighbours and the previous frame. DepthPrepass is the forward mode rasterizing every
+// triangle depth only first, then shading only where each one kept its depth: overdraw costs
+// a second rasterization instead of shading. Fixed16 meshes are shaded in float in all of them.
+enum render_mode
+{
+    RenderMode_Forward,
+    RenderMode_VisibilityBuffer,
+    RenderMode_Deferred,
+    RenderMode_Checkerboard,
+    RenderMode_DepthPrepass,
+};
+
+// NOTE: Auto picks the rate of each screen tile from the color contrast it had last frame,
+// Foveated has the game shade coarser away from the center of the image. Forward mode only.
+enum shading_rate_mode
+{
+    ShadingRateMode_Full,
+    ShadingRateMode_Auto,
+    ShadingRateMode_Foveated,
+};
+
+// NOTE: Shadows of the key light, from a shadow map rendered every frame. Filtered blends the
+// 2x2 texels around each sample instead of taking the nearest one.
+enum shadow_mode
+{
+    ShadowMode_Off,
+    ShadowMode_Hard,
+    ShadowMode_Filtered,
+};
+
 struct game_memory
 {
     uint64_t PermanentStorageSize;
@@ -63,6 +299,34 @@ struct game_memory
     
     platform_calls Platform;
     renderer_calls Renderer;
+    
+    // NOTE: Thread count includes the main thread, which helps while completing work
+    platform_work_queue* RenderQueue;
+    uint32_t RenderThreadCount;
+    // NOTE: Threads pinned under the same last level cache share a domain, tiles rendered
+    // in the same domain are kept next to each other
+    uint32_t RenderThreadCacheDomains[MAX_RENDER_THREAD_COUNT];
+    // NOTE: Auto picks the widest tier the CPU supports, a forced tier is lowered to it too
+    raster_tier ForcedRasterTier;
+    // NOTE: Shading of the scene meshes, see shading_mode
+    shading_mode SceneShadingMode;
+    // NOTE: Lighting frequency of the sphere, the cube keeps per pixel lighting since its
+    // vertices are too far apart to carry the highlights
+    shading_frequency SphereShadingFrequency;
+    shader_type SceneShader;
+    // NOTE: Local lights circling the scene on top of the key light, capped to
+    // MAX_SCENE_LIGHT_COUNT - 1
+    uint32_t SceneLocalLightCount;
+    // NOTE: Puts a checker texture on the sphere, in the given format
+    bool SceneTextures;
+    texture_format SceneTextureFormat;
+    render_mode RenderMode;
+    shading_rate_mode ShadingRateMode;
+    // NOTE: A floor goes under the scene to catch the shadows
+    shadow_mode SceneShadows;
+    // NOTE: Measures the block shape thresholds over the first frames and saves them for the
+    // next launches, see LoadBlockShapeThresholds
+    bool CalibrateBlockShapes;
 };
 
 struct game_offscreen_buffer
@@ -71,9 +335,15 @@ struct game_offscreen_buffer
     int32_t Width;
     int32_t Height;
     int32_t Pitch;
+    // NOTE: Position of the first pixel in the whole image, non zero when the buffer is
+    // a window into an image too large to fit in memory
+    int32_t OriginX;
+    int32_t OriginY;
 };
 
 typedef void game_update_and_render(game_memory* Memory, game_offscreen_buffer* Buffer);
+// NOTE: Renders a single image of any size to a tiled file, a chunk at a time
+typedef bool game_render_offline(game_memory* Memory, int32_t ImageWidth, int32_t ImageHeight, char* FileName);
 
 
 //////////////////
@@ -88,38 +358,221 @@ struct camera
     bool IsInitialized;
 };
 
+// NOTE: Square and a power of two on the side, 0xAARRGGBB texels in sRGB like the frame buffer.
+// Each level is in Morton order, so the 2x2 texels of a bilinear tap are in one or two cache
+// lines whichever way the surface runs across the screen. The levels are stored from the 1x1
+// one up, the one of side S starts at texel (S^2 - 1) / 3. Block compressed textures order
+// the blocks of each level the same way, levels under 4x4 repeat across one block.
+struct texture
+{
+    texture_format Format;
+    uint32_t LogSize;
+    // NOTE: RGBA8 only
+    uint32_t* Texels;
+    // NOTE: Block compressed formats only, the first block of each level from level 0
+    uint8_t* Blocks;
+    uint32_t BlockLevelOffsets[16];
+};
+
+// NOTE: Linear colors scaled by the intensities, the specular exponent belongs to the shader.
+// The ambient color reflects the irradiance of the ambient probe. The diffuse texture scales
+// both the diffuse and ambient colors, it is ignored on meshes without texture coordinates.
+struct material
+{
+    vector3 DiffuseColor;
+    vector3 SpecularColor;
+    vector3 AmbientColor;
+    float DiffuseIntensity;
+    float SpecularIntensity;
+    texture* DiffuseTexture;
+};
+
+// NOTE: Per tile light lists index the lights with 16 bits
+#define MAX_SCENE_LIGHT_COUNT 256
+#define MAX_DISTANT_LIGHT_COUNT 16
+
+// NOTE: Point lights in world space, one array per attribute so culling and shading only
+// touch what they read. Colors are linear and scale the material. A light with a radius
+// of 0 reaches everything unattenuated, otherwise it fades out smoothly at the radius.
+struct scene_lights
+{
+    uint32_t Count;
+    float PositionsX[MAX_SCENE_LIGHT_COUNT];
+    float PositionsY[MAX_SCENE_LIGHT_COUNT];
+    float PositionsZ[MAX_SCENE_LIGHT_COUNT];
+    float ColorsX[MAX_SCENE_LIGHT_COUNT];
+    float ColorsY[MAX_SCENE_LIGHT_COUNT];
+    float ColorsZ[MAX_SCENE_LIGHT_COUNT];
+    float Radii[MAX_SCENE_LIGHT_COUNT];
+    
+    // NOTE: Distant lights only reach the shading through the ambient probe, projected once
+    // per frame. Directions point towards the light and are normalized.
+    uint32_t DistantCount;
+    float DistantDirectionsX[MAX_DISTANT_LIGHT_COUNT];
+    float DistantDirectionsY[MAX_DISTANT_LIGHT_COUNT];
+    float DistantDirectionsZ[MAX_DISTANT_LIGHT_COUNT];
+    float DistantColorsX[MAX_DISTANT_LIGHT_COUNT];
+    float DistantColorsY[MAX_DISTANT_LIGHT_COUNT];
+    float DistantColorsZ[MAX_DISTANT_LIGHT_COUNT];
+};
+
 struct mesh
 {
     vector3* Vertices;
     vector3* Normals;
+    // NOTE: Null when the mesh isn't textured, the textures wrap around outside 0..1
+    vector2* TexCoords;
     uint32_t* Indices;
     uint32_t VerticesCount;
     uint32_t IndicesCount;
     matrix4 Transform;
     matrix4 InverseTransform;
+    shading_mode ShadingMode;
+    shading_frequency ShadingFrequency;
+    shader_type Shader;
+    uint32_t MaterialIndex;
 };
 
 #define SPHERE_SUBDIV 28 
 #define SPHERE_VERTEX_COUNT (SPHERE_SUBDIV * SPHERE_SUBDIV + 2)
 #define SPHERE_INDEX_COUNT (SPHERE_SUBDIV * 3 * 2 + (SPHERE_SUBDIV - 1) * (SPHERE_SUBDIV - 1) * 6)
+#define SCENE_TEXTURE_LOG_SIZE 8
+
+// NOTE: Must be a power of 2 and a multiple of every block shape dimension
+#define RASTER_TILE_SIZE 64
+
+// NOTE: Side of the coarse pixels is 1 << Rate, FragmentStage runs once per coarse pixel while
+// coverage stays per pixel. Rates are picked per screen tile, which must divide the job size.
+enum shading_rate
+{
+    ShadingRate_1x1,
+    ShadingRate_2x2,
+    ShadingRate_4x4,
+};
+
+#define SHADING_RATE_TILE_SIZE 16
+
+enum block_shape_type
+{
+    BlockShape_Wide,
+    BlockShape_Square,
+    BlockShape_Tall,
+    
+    BlockShape_Count
+};
+
+// NOTE: Aspect ratios are bounding box Width / Height
+struct block_shape_thresholds
+{
+    float WideAspect; // Triangles at least this wide use the wide block
+    float TallAspect; // Triangles at most this wide use the tall block
+    bool IsCalibrated;
+};
+
+// Aspect buckets are spaced by half powers of 2, from 1/16 to 16
+#define BLOCK_SHAPE_ASPECT_BUCKET_COUNT 17
+#define BLOCK_SHAPE_CALIBRATION_FRAMES 120
+// NOTE: Next to the executable's working directory, written when a calibration ends
+#define BLOCK_SHAPE_THRESHOLDS_FILE_NAME "sablujo_block_shapes.bin"
+
+struct block_shape_calibration
+{
+    uint32_t FramesRemaining;
+    uint32_t TrianglesCount[BLOCK_SHAPE_ASPECT_BUCKET_COUNT];
+    uint64_t Cycles[BlockShape_Count][BLOCK_SHAPE_ASPECT_BUCKET_COUNT];
+#if SABLUJO_INTERNAL
+    uint64_t PixelsWasted[BlockShape_Count][BLOCK_SHAPE_ASPECT_BUCKET_COUNT];
+#endif
+};
 
 #if SABLUJO_INTERNAL
 struct render_stats
 {
     uint32_t VerticesCount;
     uint32_t TrianglesCount;
+    uint32_t TrianglesPerShape[BlockShape_Count];
     uint32_t PixelsSkipped;
     uint32_t PixelsComputed;
     uint32_t PixelsWasted;
+    uint32_t JobsCount;
+    uint32_t JobsStolen;
+    // NOTE: Summed over the jobs, each counts the lights left after culling
+    uint32_t JobLightsCount;
+    // NOTE: Compressed blocks looked up in the decoded block caches, and those decoded
+    uint32_t TextureBlockLookups;
+    uint32_t TextureBlocksDecoded;
+    // NOTE: Triangles rasterized to the shadow map and their fragments
+    uint32_t ShadowTrianglesCount;
+    uint32_t ShadowFragmentsCount;
+    // NOTE: Depth prepass mode, fragments of the depth pass and its cycles, then the fragments
+    // of the shading pass tested against it and those left to shade
+    uint32_t PrepassDepthFragments;
+    uint64_t PrepassCycles;
+    uint32_t PrepassFragmentsTested;
+    uint32_t PrepassFragmentsShaded;
 };
 #endif
+
+// NOTE: Enough for a 8192x8192 render target
+#define MAX_RENDER_TILE_COUNT (128 * 128)
+
+// NOTE: Measured while rendering the tile last frame, drives next frame scheduling
+struct render_tile_cost
+{
+    uint64_t Cycles;
+    uint32_t FragmentsCount;
+    uint32_t TrianglesCount;
+};
+
+struct render_tile_history
+{
+    int32_t OriginX;
+    int32_t OriginY;
+    int32_t TileCountX;
+    int32_t TileCountY;
+    float CyclesPerFragment;
+    render_tile_cost Tiles[MAX_RENDER_TILE_COUNT];
+};
+
+#define MAX_SHADING_RATE_TILE_COUNT (MAX_RENDER_TILE_COUNT * (RASTER_TILE_SIZE / SHADING_RATE_TILE_SIZE) * (RASTER_TILE_SIZE / SHADING_RATE_TILE_SIZE))
+
+// NOTE: Largest color step between neighbouring pixels of each screen tile last frame,
+// the rates of the next frame are picked from them
+struct shading_rate_history
+{
+    int32_t TileCountX;
+    int32_t TileCountY;
+    uint8_t Contrasts[MAX_SHADING_RATE_TILE_COUNT];
+    uint8_t Rates[MAX_SHADING_RATE_TILE_COUNT];
+};
+
+// NOTE: The buffer the last checkerboard frame went to, its pixels are the previous frame
+// where this one isn't shaded
+struct checkerboard_history
+{
+    void* Memory;
+    int32_t Width;
+    int32_t Height;
+    uint32_t Parity;
+    bool IsValid;
+};
+
 struct game_state
 {
 #if SABLUJO_INTERNAL
     render_stats RenderStats;
 #endif
+    block_shape_thresholds BlockShapeThresholds;
+    block_shape_calibration BlockShapeCalibration;
+    render_tile_history TileHistory;
+    shading_rate_history ShadingRateHistory;
+    checkerboard_history CheckerboardHistory;
     camera Camera;
-    mesh Meshes[2];
+    material Materials[3];
+    // NOTE: One per format, the compressed ones are encoded from the RGBA8 one
+    texture Textures[TextureFormat_Count];
+    scene_lights Lights;
+    mesh Meshes[3];
     float YRot;
 };
 
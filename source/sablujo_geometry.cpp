@@ -1,8 +1,8 @@
 #include "sablujo_geometry.h"
 
 void CreateSphere(uint32_t LatitudeCount, uint32_t LongitudeCount, 
-                  vector3* OutputVertices, vector3* OutputNormals, uint32_t* OutputIndices,
-                  uint32_t OutVerticesSize, uint32_t OutIndicesSize)
+                  vector3* OutputVertices, vector3* OutputNormals, vector2* OutputTexCoords,
+                  uint32_t* OutputIndices, uint32_t OutVerticesSize, uint32_t OutIndicesSize)
 {
     Assert(OutVerticesSize >= LatitudeCount * LongitudeCount);
     Assert(OutIndicesSize >= LongitudeCount * 3 * 2 + (LatitudeCount - 1) * (LongitudeCount - 1) * 6);
@@ -13,6 +13,10 @@ void CreateSphere(uint32_t LatitudeCount, uint32_t LongitudeCount,
     //North Cap
     OutputVertices[OutputOffset] = {0.0f, Radius, 0.0f};
     OutputNormals[OutputOffset] = {0.0f, 1.0f, 0.0f};
+    if(OutputTexCoords)
+    {
+        OutputTexCoords[OutputOffset] = {0.5f, 0.0f};
+    }
     ++OutputOffset;
     
     for (uint32_t Latitude = 0; Latitude < LatitudeCount; Latitude++)
@@ -33,12 +37,21 @@ void CreateSphere(uint32_t LatitudeCount, uint32_t LongitudeCount,
             
             OutputVertices[OutputOffset] = {X * Radius, (float)CosTheta * Radius, Z * Radius};
             OutputNormals[OutputOffset] = {X, (float)CosTheta, Z, 0.0f};
+            if(OutputTexCoords)
+            {
+                float U = 1.0f - fabsf(1.0f - 2.0f * (float)Longitude / (float)LongitudeCount);
+                OutputTexCoords[OutputOffset] = {U, (float)(Theta / PI)};
+            }
             ++OutputOffset;
         }
     }
     //South Cap
     OutputVertices[OutputOffset] = {0.0f, -Radius, 0.0f};
     OutputNormals[OutputOffset] = {0.0f, -1.0f, 0.0f};
+    if(OutputTexCoords)
+    {
+        OutputTexCoords[OutputOffset] = {0.5f, 1.0f};
+    }
     
     OutputOffset = 0;
     for (uint32_t Latitude = 0; Latitude < LatitudeCount; Latitude++)
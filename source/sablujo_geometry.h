@@ -2,9 +2,11 @@
 
 #include "sablujo_maths.h"
 
+// NOTE: OutputTexCoords can be null. U runs around the equator and back so the texture has no
+// seam, V from the north pole to the south one.
 void CreateSphere(uint32_t LatitudeCount, uint32_t LongitudeCount, 
-                  vector3* OutputVertices, vector3* OutputNormals, uint32_t* OutputIndices,
-                  uint32_t OutVerticesSize, uint32_t OutIndicesSize);
+                  vector3* OutputVertices, vector3* OutputNormals, vector2* OutputTexCoords,
+                  uint32_t* OutputIndices, uint32_t OutVerticesSize, uint32_t OutIndicesSize);
 
 const uint32_t CubeVerticesCount = 8;
 /*
@@ -93,5 +95,30 @@ global_variable uint32_t CubeIndices[CubeIndicesCount] =
     6,7,3
 };
 
+// NOTE: Flat ground catching the shadows, wider at the back to fill the view. Up is -Y.
+const uint32_t FloorVerticesCount = 4;
+global_variable vector3 FloorVertices[FloorVerticesCount] = 
+{
+    { -1.5f,  0.0f, -2.4f },
+    {  1.5f,  0.0f, -2.4f },
+    {  5.0f,  0.0f,  2.0f },
+    { -5.0f,  0.0f,  2.0f }
+};
+
+global_variable vector3 FloorNormals[FloorVerticesCount] = 
+{
+    { 0.0f, -1.0f, 0.0f },
+    { 0.0f, -1.0f, 0.0f },
+    { 0.0f, -1.0f, 0.0f },
+    { 0.0f, -1.0f, 0.0f }
+};
+
+const uint32_t FloorIndicesCount = 6;
+global_variable uint32_t FloorIndices[FloorIndicesCount] =
+{
+    0,1,2,
+    2,3,0
+};
+
 #define GEOMETRY_H
 #endif
\ No newline at end of file
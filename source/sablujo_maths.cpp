@@ -68,37 +68,6 @@ matrix4 MultMatrixMatrix(matrix4* A, matrix4* B)
     return Result;
 }
 
-matrix4 MultMatrixMatrixIntrinsics(matrix4* A, matrix4* B)
-{
-    matrix4 Result;
-    __m256 vec_multi_res = _mm256_setzero_ps(); //Initialize vector to zero
-    __m256 vec_mat1 = _mm256_setzero_ps(); //Initialize vector to zero
-    __m256 vec_mat2 = _mm256_setzero_ps(); //Initialize vector to zero
-    
-    int32_t i, j, k;
-    for (i = 0; i < 4; i++)
-    {
-        for (j = 0; j < 4; ++j)
-        {
-            //Stores one element in mat1 and use it in all computations needed before proceeding
-            //Stores as vector to increase computations per cycle
-            vec_mat1 = _mm256_set1_ps(A->val[i][j]);
-            
-            for (k = 0; k < 4; k += 8)
-            {
-                vec_mat2 = _mm256_loadu_ps(&B->val[j][k]); //Stores row of second matrix (eight in each iteration)
-                vec_multi_res = _mm256_loadu_ps(&B->val[i][k]); //Loads the result matrix row as a vector
-                vec_multi_res = _mm256_add_ps(vec_multi_res ,_mm256_mul_ps(vec_mat1, vec_mat2));//Multiplies the vectors and adds to th the result vector
-                
-                _mm256_storeu_ps(&Result.val[i][k], vec_multi_res); //Stores the result vector into the result array
-            }
-        }
-    }
-    return Result;
-}
-
-
-
 #define MakeShuffleMask(x,y,z,w)           (x | (y<<2) | (z<<4) | (w<<6))
 
 // vec(0, 1, 2, 3) -> (vec[x], vec[y], vec[z], vec[w])
@@ -231,4 +200,66 @@ matrix4 TransposeMatrix(matrix4* Matrix)
     Result.vecs[2] = _mm_movelh_ps(A1, A3);
     Result.vecs[3] = _mm_movehl_ps(A3, A1);
     return Result;
-}
\ No newline at end of file
+}
+
+uint16_t ConvertF32ToHalf(float Value)
+{
+    f32_bits Bits = {Value};
+    uint32_t Sign = Bits.U32 & 0x80000000u;
+    Bits.U32 ^= Sign;
+    
+    uint16_t Result;
+    if(Bits.U32 >= (143u << 23))
+    {
+        // NOTE: Too large for a half, NaNs stay NaNs
+        Result = Bits.U32 > (255u << 23) ? 0x7E00 : 0x7C00;
+    }
+    else if(Bits.U32 < (113u << 23))
+    {
+        // NOTE: Denormal half, the float addition does the shift and the rounding
+        f32_bits DenormalMagic = {0};
+        DenormalMagic.U32 = 126u << 23;
+        Bits.F32 += DenormalMagic.F32;
+        Result = (uint16_t)(Bits.U32 - DenormalMagic.U32);
+    }
+    else
+    {
+        uint32_t MantissaOdd = (Bits.U32 >> 13) & 1;
+        Bits.U32 += ((uint32_t)(15 - 127) << 23) + 0xFFF + MantissaOdd;
+        Result = (uint16_t)(Bits.U32 >> 13);
+    }
+    return (uint16_t)(Result | (Sign >> 16));
+}
+
+float ConvertHalfToF32(uint16_t Value)
+{
+    f32_bits Bits;
+    Bits.U32 = (uint32_t)(Value & 0x7FFF) << 13;
+    uint32_t Exponent = Bits.U32 & (0x7C00u << 13);
+    Bits.U32 += (127u - 15u) << 23;
+    if(Exponent == (0x7C00u << 13))
+    {
+        // Infinity and NaN
+        Bits.U32 += (128u - 16u) << 23;
+    }
+    else if(Exponent == 0)
+    {
+        // Denormal, renormalized by the float subtraction
+        f32_bits Magic;
+        Magic.U32 = 113u << 23;
+        Bits.U32 += 1u << 23;
+        Bits.F32 -= Magic.F32;
+    }
+    Bits.U32 |= (uint32_t)(Value & 0x8000) << 16;
+    return Bits.F32;
+}
+
+vector3h ConvertToHalf(vector3 Vector)
+{
+    vector3h Result;
+    Result.X = ConvertF32ToHalf(Vector.X);
+    Result.Y = ConvertF32ToHalf(Vector.Y);
+    Result.Z = ConvertF32ToHalf(Vector.Z);
+    Result.Padding = 0;
+    return Result;
+}
@@ -11,6 +11,10 @@
 #define MIN(a,b)            (((a) < (b)) ? (a) : (b))
 #endif
 
+#ifndef ABS
+#define ABS(a)              (((a) < 0) ? -(a) : (a))
+#endif
+
 #include <immintrin.h>
 #include <stdint.h>
 //TODO: Replace call to math.h
@@ -100,9 +104,26 @@ struct vector2i
     int32_t Y;
 };
 
+// NOTE: Half precision storage for the intermediate attribute streams, padded to 8 bytes so
+// all four halves convert with one F16C instruction
+struct vector3h
+{
+    uint16_t X;
+    uint16_t Y;
+    uint16_t Z;
+    uint16_t Padding;
+};
+
+// NOTE: Reads the bits of a float without breaking strict aliasing
+union f32_bits
+{
+    float F32;
+    uint32_t U32;
+};
+
 inline float SquareRoot(float Value)
 {
-    return _mm_sqrt_ps(_mm_set_ps1(Value)).m128_f32[0];
+    return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(Value)));
 }
 
 inline float Cosine(float Value)
@@ -123,6 +144,23 @@ inline float Tangent(float Value)
     return Result;
 }
 
+inline float Log2(float Value)
+{
+    float Result = log2f(Value);
+    return Result;
+}
+
+inline float Exp2(float Value)
+{
+    float Result = exp2f(Value);
+    return Result;
+}
+
+// NOTE: Round to nearest even, for the code that can't assume F16C
+uint16_t ConvertF32ToHalf(float Value);
+float ConvertHalfToF32(uint16_t Value);
+vector3h ConvertToHalf(vector3 Vector);
+
 // IMPORTANT: Only use for affine transformation where points are sure to be set to w = 1 
 vector3 MultPointMatrix(matrix4* Matrix, vector3* Vector);
 vector4 MultPointMatrix(matrix4* Matrix, vector4* Vector);
@@ -130,7 +168,6 @@ vector4 MultPointMatrix(matrix4* Matrix, vector4* Vector);
 vector4 MultVecMatrix(matrix4* Matrix, vector4* Vector);
 
 matrix4 MultMatrixMatrix(matrix4* A, matrix4* B);
-matrix4 MultMatrixMatrixIntrinsics(matrix4* A, matrix4* B);
 
 matrix4 InverseMatrix(matrix4* Matrix);
 matrix4 TransposeMatrix(matrix4* Matrix);
@@ -192,6 +229,14 @@ operator+(vector3 lhs, vector3 rhs)
     return Result;
 }
 
+inline vector3
+operator-(vector3 lhs, vector3 rhs)
+{
+    vector3 Result;
+    Result.vec = _mm_sub_ps(lhs.vec, rhs.vec);
+    return Result;
+}
+
 inline vector3
 operator*(float lhs, vector3 rhs)
 {
@@ -200,6 +245,23 @@ operator*(float lhs, vector3 rhs)
     return Result;
 }
 
+inline float
+DotProduct(vector3 A, vector3 B)
+{
+    return A.X * B.X + A.Y * B.Y + A.Z * B.Z;
+}
+
+inline vector3
+CrossProduct(vector3 A, vector3 B)
+{
+    vector3 Result;
+    Result.X = A.Y * B.Z - A.Z * B.Y;
+    Result.Y = A.Z * B.X - A.X * B.Z;
+    Result.Z = A.X * B.Y - A.Y * B.X;
+    Result.Padding = 0.0f;
+    return Result;
+}
+
 // Vector 4
 
 // ADD
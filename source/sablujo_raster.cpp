@@ -0,0 +1,2103 @@
+#include "sablujo_render.h"
+#include "sablujo_sse.h"
+
+// NOTE: Built once per instruction set tier, see build.bat, sablujo_render.cpp picks one at
+// runtime. Only code in the tier namespace or internal to this file may be called from here:
+// an inline function shared with the other files could be emitted with the widest tier
+// instructions and picked by the linker for everyone.
+namespace LANE_NAMESPACE
+{
+
+// NOTE: The uniforms of a draw, broadcast once per triangle or block of lanes
+struct material_lanes
+{
+    lane_v3 DiffuseColor;
+    lane_v3 SpecularColor;
+    lane_v3 AmbientColor;
+    lane_f32 DiffuseIntensity;
+    lane_f32 SpecularIntensity;
+    // NOTE: Sampled by the caller into the colors above, see ApplyAlbedo
+    texture* DiffuseTexture;
+    // NOTE: The sampler state of the thread, set by the rasterizer
+    texture_cache* TextureCache;
+};
+
+// NOTE: Scalar reads only, the vector3 operators are shared inline functions
+internal material_lanes
+InitMaterialLanes(material* Material)
+{
+    material_lanes Result;
+    Result.DiffuseColor = InitLaneV3(Material->DiffuseColor.X, Material->DiffuseColor.Y, Material->DiffuseColor.Z);
+    Result.SpecularColor = InitLaneV3(Material->SpecularColor.X, Material->SpecularColor.Y, Material->SpecularColor.Z);
+    Result.AmbientColor = InitLaneV3(Material->AmbientColor.X, Material->AmbientColor.Y, Material->AmbientColor.Z);
+    Result.DiffuseIntensity = InitLaneF32(Material->DiffuseIntensity);
+    Result.SpecularIntensity = InitLaneF32(Material->SpecularIntensity);
+    Result.DiffuseTexture = Material->DiffuseTexture;
+    Result.TextureCache = 0;
+    return Result;
+}
+
+internal void
+ConditionalAssign(lane_v3 Source, lane_v3* Dest, lane_mask Mask)
+{
+    lane_i32 X = CastLaneF32ToI32(Dest->X);
+    lane_i32 Y = CastLaneF32ToI32(Dest->Y);
+    lane_i32 Z = CastLaneF32ToI32(Dest->Z);
+    ConditionalAssign(CastLaneF32ToI32(Source.X), &X, Mask);
+    ConditionalAssign(CastLaneF32ToI32(Source.Y), &Y, Mask);
+    ConditionalAssign(CastLaneF32ToI32(Source.Z), &Z, Mask);
+    Dest->X = CastLaneI32ToF32(X);
+    Dest->Y = CastLaneI32ToF32(Y);
+    Dest->Z = CastLaneI32ToF32(Z);
+}
+
+// NOTE: The lanes of a block nearly always share one mesh, its material is broadcast and the
+// others are only blended in when the block straddles meshes. Lanes with a mesh index past
+// MAX_FRAME_MESH_COUNT are empty and keep whichever material. Textures don't blend, the
+// result has none and the callers sample them per triangle.
+internal material_lanes
+GatherMaterialLanes(material* Materials, lane_i32 Meshes)
+{
+    int32_t LaneMeshes[LANE_WIDTH];
+    StoreLaneI32(LaneMeshes, Meshes);
+    
+    material_lanes Result = InitMaterialLanes(Materials);
+    bool IsFirst = true;
+    uint32_t LanesDone = 0;
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        uint32_t Mesh = (uint32_t)LaneMeshes[Lane];
+        if(Mesh >= MAX_FRAME_MESH_COUNT || (LanesDone & (1 << Lane)))
+        {
+            continue;
+        }
+        for(int32_t OtherLane = Lane; OtherLane < LANE_WIDTH; ++OtherLane)
+        {
+            LanesDone |= ((uint32_t)LaneMeshes[OtherLane] == Mesh) << OtherLane;
+        }
+        
+        material_lanes Material = InitMaterialLanes(Materials + Mesh);
+        if(IsFirst)
+        {
+            Result = Material;
+            IsFirst = false;
+        }
+        else
+        {
+            lane_mask Same = Meshes == InitLaneI32((int32_t)Mesh);
+            ConditionalAssign(Material.DiffuseColor, &Result.DiffuseColor, Same);
+            ConditionalAssign(Material.SpecularColor, &Result.SpecularColor, Same);
+            ConditionalAssign(Material.AmbientColor, &Result.AmbientColor, Same);
+            lane_i32 DiffuseIntensity = CastLaneF32ToI32(Result.DiffuseIntensity);
+            lane_i32 SpecularIntensity = CastLaneF32ToI32(Result.SpecularIntensity);
+            ConditionalAssign(CastLaneF32ToI32(Material.DiffuseIntensity), &DiffuseIntensity, Same);
+            ConditionalAssign(CastLaneF32ToI32(Material.SpecularIntensity), &SpecularIntensity, Same);
+            Result.DiffuseIntensity = CastLaneI32ToF32(DiffuseIntensity);
+            Result.SpecularIntensity = CastLaneI32ToF32(SpecularIntensity);
+        }
+    }
+    Result.DiffuseTexture = 0;
+    return Result;
+}
+
+// NOTE: Spreads the low 16 bits of the lanes over the even bits, the Morton order of the texels
+internal lane_i32
+SpreadBits(lane_i32 Value)
+{
+    Value = (Value | (Value << 8)) & InitLaneI32(0x00FF00FF);
+    Value = (Value | (Value << 4)) & InitLaneI32(0x0F0F0F0F);
+    Value = (Value | (Value << 2)) & InitLaneI32(0x33333333);
+    Value = (Value | (Value << 1)) & InitLaneI32(0x55555555);
+    return Value;
+}
+
+// NOTE: One 8 bit channel of the four texels around the sample, blended in sRGB
+template<int32_t Shift>
+internal lane_f32
+FilterTexelChannel(lane_i32* Texels, lane_f32 FracX, lane_f32 FracY)
+{
+    lane_i32 ByteMask = InitLaneI32(0xFF);
+    lane_f32 C00 = ConvertLaneI32ToF32((Texels[0] >> Shift) & ByteMask);
+    lane_f32 C10 = ConvertLaneI32ToF32((Texels[1] >> Shift) & ByteMask);
+    lane_f32 C01 = ConvertLaneI32ToF32((Texels[2] >> Shift) & ByteMask);
+    lane_f32 C11 = ConvertLaneI32ToF32((Texels[3] >> Shift) & ByteMask);
+    lane_f32 Top = MultiplyAdd(C10 - C00, FracX, C00);
+    lane_f32 Bottom = MultiplyAdd(C11 - C01, FracX, C01);
+    return MultiplyAdd(Bottom - Top, FracY, Top) * InitLaneF32(1.0f / 255.0f);
+}
+
+// NOTE: Perspective correct texture coordinates from the interpolated U / z, V / z and 1 / z
+// and their steps to the next pixel along X and Y. From d(U / z) = dU / z + U d(1 / z) the
+// step of U is z (d(U / z) - U d(1 / z)). Returns the squared footprint of the pixel, the
+// longer of its two steps, in texture coordinates.
+internal lane_f32
+ResolveTexCoords(lane_v3 TexCoord, lane_v3 DDX, lane_v3 DDY, lane_f32* U, lane_f32* V)
+{
+    lane_f32 Z = LaneOneF32 / TexCoord.Z;
+    *U = TexCoord.X * Z;
+    *V = TexCoord.Y * Z;
+    lane_f32 DUDX = (DDX.X - *U * DDX.Z) * Z;
+    lane_f32 DVDX = (DDX.Y - *V * DDX.Z) * Z;
+    lane_f32 DUDY = (DDY.X - *U * DDY.Z) * Z;
+    lane_f32 DVDY = (DDY.Y - *V * DDY.Z) * Z;
+    return Max(DUDX * DUDX + DVDX * DVDX, DUDY * DUDY + DVDY * DVDY);
+}
+
+// NOTE: Lane i decodes texel Offset + i of a block. The index of texel t is at bit 2t for BC1
+// and 3t for BC4, moved to the top bits by a multiply since there are no variable shifts below
+// AVX2. BC4 indices come in two 24 bit halves of 8 texels.
+global_variable int32_t BC1IndexScales[16] =
+{
+    1 << 30, 1 << 28, 1 << 26, 1 << 24, 1 << 22, 1 << 20, 1 << 18, 1 << 16,
+    1 << 14, 1 << 12, 1 << 10, 1 << 8, 1 << 6, 1 << 4, 1 << 2, 1 << 0,
+};
+
+global_variable int32_t BC4IndexScales[16] =
+{
+    1 << 29, 1 << 26, 1 << 23, 1 << 20, 1 << 17, 1 << 14, 1 << 11, 1 << 8,
+    1 << 29, 1 << 26, 1 << 23, 1 << 20, 1 << 17, 1 << 14, 1 << 11, 1 << 8,
+};
+
+internal uint32_t
+GetBlockBytes(texture_format Format)
+{
+    return Format == TextureFormat_BC5 ? 16 : 8;
+}
+
+// NOTE: Weight of the second endpoint, index 0 and 1 are the endpoints themselves and the
+// following ones step from the first endpoint by Step
+internal lane_f32
+GetPaletteWeights(lane_i32 Index, float Step)
+{
+    lane_i32 Weights = CastLaneF32ToI32(ConvertLaneI32ToF32(Index - LaneOneI32) * InitLaneF32(Step));
+    ConditionalAssign(LaneZeroI32, &Weights, Index == LaneZeroI32);
+    ConditionalAssign(CastLaneF32ToI32(LaneOneF32), &Weights, Index == LaneOneI32);
+    return CastLaneI32ToF32(Weights);
+}
+
+internal lane_i32
+DecodeBC4Channel(uint8_t* Block, int32_t Offset)
+{
+    int32_t LowIndices = Block[2] | (Block[3] << 8) | (Block[4] << 16);
+    int32_t HighIndices = Block[5] | (Block[6] << 8) | (Block[7] << 16);
+    lane_i32 Bits = InitLaneI32(LowIndices);
+    ConditionalAssign(InitLaneI32(HighIndices), &Bits, InitLaneI32(7) < InitIncrementalLaneI32(Offset));
+    lane_i32 Index = (Bits * LoadLaneI32(BC4IndexScales + Offset)) >> 29;
+    
+    // NOTE: Eight values between the endpoints, or six and then 0 and 255
+    bool IsEightValues = Block[0] > Block[1];
+    lane_f32 Value0 = InitLaneF32((float)Block[0]);
+    lane_f32 Weights = GetPaletteWeights(Index, IsEightValues ? 1.0f / 7.0f : 1.0f / 5.0f);
+    lane_i32 Result = ConvertLaneF32ToI32(MultiplyAdd(InitLaneF32((float)Block[1]) - Value0, Weights, Value0));
+    if(!IsEightValues)
+    {
+        ConditionalAssign(LaneZeroI32, &Result, Index == InitLaneI32(6));
+        ConditionalAssign(InitLaneI32(255), &Result, Index == InitLaneI32(7));
+    }
+    return Result;
+}
+
+internal lane_i32
+DecodeBC1(uint8_t* Block, int32_t Offset)
+{
+    int32_t Color0 = Block[0] | (Block[1] << 8);
+    int32_t Color1 = Block[2] | (Block[3] << 8);
+    int32_t Indices = Block[4] | (Block[5] << 8) | (Block[6] << 16) | (Block[7] << 24);
+    lane_i32 Index = (InitLaneI32(Indices) * LoadLaneI32(BC1IndexScales + Offset)) >> 30;
+    
+    // NOTE: Four colors, or three and transparent black
+    bool IsFourColors = Color0 > Color1;
+    lane_f32 Weights = GetPaletteWeights(Index, IsFourColors ? 1.0f / 3.0f : 0.5f);
+    lane_i32 Result = InitLaneI32((int32_t)0xFF000000);
+    int32_t Shifts[3] = { 11, 5, 0 };
+    int32_t Bits[3] = { 5, 6, 5 };
+    for(int32_t Channel = 0; Channel < 3; ++Channel)
+    {
+        // NOTE: The top bits repeat below to reach the 8 bit range
+        int32_t Mask = (1 << Bits[Channel]) - 1;
+        int32_t Value0 = (Color0 >> Shifts[Channel]) & Mask;
+        int32_t Value1 = (Color1 >> Shifts[Channel]) & Mask;
+        Value0 = (Value0 << (8 - Bits[Channel])) | (Value0 >> (2 * Bits[Channel] - 8));
+        Value1 = (Value1 << (8 - Bits[Channel])) | (Value1 >> (2 * Bits[Channel] - 8));
+        lane_f32 Value0Lanes = InitLaneF32((float)Value0);
+        lane_i32 Value = ConvertLaneF32ToI32(MultiplyAdd(InitLaneF32((float)Value1) - Value0Lanes, Weights, Value0Lanes));
+        Result = Result | (Value << (16 - 8 * Channel));
+    }
+    if(!IsFourColors)
+    {
+        ConditionalAssign(LaneZeroI32, &Result, Index == InitLaneI32(3));
+    }
+    return Result;
+}
+
+// NOTE: All 16 texels of a block in lanes, packed like RGBA8 texels
+internal void
+DecodeTextureBlock(texture_format Format, uint8_t* Block, uint32_t* Texels)
+{
+    lane_i32 Alpha = InitLaneI32((int32_t)0xFF000000);
+    for(int32_t Offset = 0; Offset < 16; Offset += LANE_WIDTH)
+    {
+        lane_i32 Result;
+        switch(Format)
+        {
+            case TextureFormat_BC1:
+            {
+                Result = DecodeBC1(Block, Offset);
+            } break;
+            
+            case TextureFormat_BC4:
+            {
+                lane_i32 Gray = DecodeBC4Channel(Block, Offset);
+                Result = Alpha | (Gray << 16) | (Gray << 8) | Gray;
+            } break;
+            
+            case TextureFormat_BC5:
+            {
+                lane_i32 Red = DecodeBC4Channel(Block, Offset);
+                lane_i32 Green = DecodeBC4Channel(Block + 8, Offset);
+                Result = Alpha | (Red << 16) | (Green << 8);
+            } break;
+            
+            default:
+            {
+                Assert(!"Not a block compressed format");
+                Result = Alpha;
+            } break;
+        }
+        StoreLaneI32((int32_t*)Texels + Offset, Result);
+    }
+}
+
+// NOTE: Slot of the decoded block in the cache, see texture_cache
+internal int32_t
+LookupTextureBlock(texture_cache* Cache, texture* Texture, uint32_t Block, int32_t Lane)
+{
+    uint32_t BlockBytes = GetBlockBytes(Texture->Format);
+    uint8_t* Data = Texture->Blocks + Block * BlockBytes;
+    int32_t Slot = (int32_t)(((uintptr_t)Data / BlockBytes) & (TEXTURE_CACHE_SIZE - 1));
+#if SABLUJO_INTERNAL
+    ++Cache->Lookups;
+#endif
+    if(Cache->Tags[Slot] != Data)
+    {
+        if(Cache->Stamps[Slot] == Cache->Stamp)
+        {
+            Slot = TEXTURE_CACHE_SIZE + Lane;
+        }
+        else
+        {
+            Cache->Tags[Slot] = Data;
+        }
+        DecodeTextureBlock(Texture->Format, Data, Cache->Texels[Slot]);
+#if SABLUJO_INTERNAL
+        ++Cache->Decodes;
+#endif
+    }
+    if(Slot < TEXTURE_CACHE_SIZE)
+    {
+        Cache->Stamps[Slot] = Cache->Stamp;
+    }
+    return Slot;
+}
+
+// NOTE: The texels of the four bilinear taps, from the wrapped texel coordinates of the left
+// and right columns and the top and bottom rows. Neighbouring lanes nearly always share their
+// block, a lane only looks the cache up when its block changes.
+internal void
+FetchBlockTexels(texture_cache* Cache, texture* Texture, lane_i32 Level, lane_i32* TexelX, lane_i32* TexelY, lane_i32* Corners)
+{
+    lane_i32 LevelBlock = GatherLaneI32((int32_t*)Texture->BlockLevelOffsets, Level);
+    lane_i32 Three = InitLaneI32(3);
+    lane_i32 BlockX[2];
+    lane_i32 BlockY[2];
+    for(int32_t Side = 0; Side < 2; ++Side)
+    {
+        BlockX[Side] = SpreadBits(TexelX[Side] >> 2);
+        BlockY[Side] = SpreadBits(TexelY[Side] >> 2) << 1;
+    }
+    
+    for(int32_t Corner = 0; Corner < 4; ++Corner)
+    {
+        int32_t Column = Corner & 1;
+        int32_t Row = Corner >> 1;
+        int32_t LaneBlocks[LANE_WIDTH];
+        int32_t LaneSlots[LANE_WIDTH];
+        StoreLaneI32(LaneBlocks, LevelBlock + BlockY[Row] + BlockX[Column]);
+        
+        ++Cache->Stamp;
+        int32_t PreviousBlock = -1;
+        int32_t Slot = 0;
+        for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+        {
+            if(LaneBlocks[Lane] != PreviousBlock)
+            {
+                PreviousBlock = LaneBlocks[Lane];
+                Slot = LookupTextureBlock(Cache, Texture, (uint32_t)PreviousBlock, Lane);
+            }
+            LaneSlots[Lane] = Slot;
+        }
+        
+        lane_i32 TexelInBlock = ((TexelY[Row] & Three) << 2) + (TexelX[Column] & Three);
+        Corners[Corner] = GatherLaneI32((int32_t*)Cache->Texels, (LoadLaneI32(LaneSlots) << 4) + TexelInBlock);
+    }
+}
+
+// NOTE: Bilinear on the mip level nearest to the footprint, see texture for the layout. The
+// four texels are filtered before the sRGB decode, one decode per channel instead of four.
+// Coordinates wrap, any float including NaN lands on a texel of the level. Compressed
+// textures go through the decoded blocks of Cache.
+internal lane_v3
+SampleTexture(texture_cache* Cache, texture* Texture, lane_f32 U, lane_f32 V, lane_f32 FootprintSq)
+{
+    // NOTE: log2 of the footprint in level 0 texels is half the exponent of its square, the
+    // factor 2 rounds it to nearest. A zero footprint has exponent -127 and clamps to level 0.
+    float LevelZeroSize = (float)(1 << Texture->LogSize);
+    lane_f32 Scaled = FootprintSq * InitLaneF32(2.0f * LevelZeroSize * LevelZeroSize);
+    lane_i32 Exponent = (CastLaneF32ToI32(Scaled) >> 23) - InitLaneI32(127);
+    lane_f32 Level = Clamp(ConvertLaneI32ToF32(Exponent) * LaneZeroPointFive, LaneZeroF32, InitLaneF32((float)Texture->LogSize));
+    
+    // NOTE: The size of the level is built in the float exponent, below AVX2 there are no
+    // variable shifts
+    lane_i32 LevelIndex = TruncateLaneF32ToI32(Level);
+    lane_i32 LogSize = InitLaneI32((int32_t)Texture->LogSize) - LevelIndex;
+    lane_f32 Size = CastLaneI32ToF32((LogSize + InitLaneI32(127)) << 23);
+    lane_i32 SizeMask = ConvertLaneF32ToI32(Size) - LaneOneI32;
+    
+    lane_f32 X = MultiplyAdd(U, Size, InitLaneF32(-0.5f));
+    lane_f32 Y = MultiplyAdd(V, Size, InitLaneF32(-0.5f));
+    lane_f32 X0 = Floor(X);
+    lane_f32 Y0 = Floor(Y);
+    lane_i32 TexelX0 = TruncateLaneF32ToI32(X0) & SizeMask;
+    lane_i32 TexelY0 = TruncateLaneF32ToI32(Y0) & SizeMask;
+    
+    lane_i32 Corners[4];
+    if(Texture->Format == TextureFormat_RGBA8)
+    {
+        // NOTE: The spread of Size - 1 masks the X bits of a level and also counts the texels
+        // of the smaller levels, where it starts
+        lane_i32 SpreadMaskX = SpreadBits(SizeMask);
+        lane_i32 SpreadMaskY = SpreadMaskX << 1;
+        lane_i32 LevelOffset = SpreadMaskX;
+        
+        lane_i32 SpreadX0 = SpreadBits(TexelX0);
+        lane_i32 SpreadY0 = SpreadBits(TexelY0) << 1;
+        // NOTE: Subtracting the mask fills the gaps between the bits so the carry of the
+        // increment runs through them, masking wraps it at the edge of the level
+        lane_i32 SpreadX1 = (SpreadX0 - SpreadMaskX) & SpreadMaskX;
+        lane_i32 SpreadY1 = (SpreadY0 - SpreadMaskY) & SpreadMaskY;
+        
+        int32_t* Texels = (int32_t*)Texture->Texels;
+        lane_i32 Row0 = LevelOffset + SpreadY0;
+        lane_i32 Row1 = LevelOffset + SpreadY1;
+        Corners[0] = GatherLaneI32(Texels, Row0 + SpreadX0);
+        Corners[1] = GatherLaneI32(Texels, Row0 + SpreadX1);
+        Corners[2] = GatherLaneI32(Texels, Row1 + SpreadX0);
+        Corners[3] = GatherLaneI32(Texels, Row1 + SpreadX1);
+    }
+    else
+    {
+        lane_i32 TexelX[2] = { TexelX0, (TexelX0 + LaneOneI32) & SizeMask };
+        lane_i32 TexelY[2] = { TexelY0, (TexelY0 + LaneOneI32) & SizeMask };
+        FetchBlockTexels(Cache, Texture, LevelIndex, TexelX, TexelY, Corners);
+    }
+    
+    lane_f32 FracX = X - X0;
+    lane_f32 FracY = Y - Y0;
+    lane_v3 Result;
+    Result.X = SRGBToLinear<MathPrecision_Fast>(FilterTexelChannel<16>(Corners, FracX, FracY));
+    Result.Y = SRGBToLinear<MathPrecision_Fast>(FilterTexelChannel<8>(Corners, FracX, FracY));
+    Result.Z = SRGBToLinear<MathPrecision_Fast>(FilterTexelChannel<0>(Corners, FracX, FracY));
+    return Result;
+}
+
+// NOTE: The texture color scales the light the surface scatters, the highlights keep theirs
+internal void
+ApplyAlbedo(material_lanes* Material, lane_v3 Albedo)
+{
+    Material->DiffuseColor = Hadamard(Material->DiffuseColor, Albedo);
+    Material->AmbientColor = Hadamard(Material->AmbientColor, Albedo);
+}
+
+// NOTE: The barycentrics are affine on screen, their steps to the next pixel are constant over
+// the triangle: the edge function coefficients of InitEdge times the inverse area
+internal void
+GetBarycentricSteps(vector2i V0, vector2i V1, vector2i V2, float InvArea, lane_f32* StepsX, lane_f32* StepsY)
+{
+    StepsX[0] = InitLaneF32((float)(V1.Y - V2.Y) * InvArea);
+    StepsX[1] = InitLaneF32((float)(V2.Y - V0.Y) * InvArea);
+    StepsX[2] = InitLaneF32((float)(V0.Y - V1.Y) * InvArea);
+    StepsY[0] = InitLaneF32((float)(V2.X - V1.X) * InvArea);
+    StepsY[1] = InitLaneF32((float)(V0.X - V2.X) * InvArea);
+    StepsY[2] = InitLaneF32((float)(V1.X - V0.X) * InvArea);
+}
+
+// NOTE: See sh_probe, the basis products are shared by the three channels
+internal lane_v3
+EvaluateProbe(sh_probe* Probe, lane_v3 Normal)
+{
+    lane_f32 Basis[SH_COEFFICIENT_COUNT];
+    Basis[0] = LaneOneF32;
+    Basis[1] = Normal.Y;
+    Basis[2] = Normal.Z;
+    Basis[3] = Normal.X;
+    Basis[4] = Normal.X * Normal.Y;
+    Basis[5] = Normal.Y * Normal.Z;
+    Basis[6] = InitLaneF32(3.0f) * Normal.Z * Normal.Z - LaneOneF32;
+    Basis[7] = Normal.X * Normal.Z;
+    Basis[8] = Normal.X * Normal.X - Normal.Y * Normal.Y;
+    
+    lane_v3 Result = InitLaneV3(Probe->CoefficientsX[0], Probe->CoefficientsY[0], Probe->CoefficientsZ[0]);
+    for(int32_t Index = 1; Index < SH_COEFFICIENT_COUNT; ++Index)
+    {
+        Result.X = MultiplyAdd(InitLaneF32(Probe->CoefficientsX[Index]), Basis[Index], Result.X);
+        Result.Y = MultiplyAdd(InitLaneF32(Probe->CoefficientsY[Index]), Basis[Index], Result.Y);
+        Result.Z = MultiplyAdd(InitLaneF32(Probe->CoefficientsZ[Index]), Basis[Index], Result.Z);
+    }
+    
+    // NOTE: The truncated series rings below zero facing away from a lone light
+    Result.X = Max(Result.X, LaneZeroF32);
+    Result.Y = Max(Result.Y, LaneZeroF32);
+    Result.Z = Max(Result.Z, LaneZeroF32);
+    return Result;
+}
+
+// NOTE: 1 where texel (X, Y) of the map doesn't hide the receiver, 0 where it does. Lanes in
+// Inside only, the others are lit and read a clamped texel, NaN included.
+internal lane_f32
+GetShadowTap(shadow_map* Shadow, lane_f32 X, lane_f32 Y, lane_f32 Inside, lane_f32 Receiver)
+{
+    lane_f32 MaxTexel = InitLaneF32((float)(SHADOW_MAP_SIZE - 1));
+    Inside = Inside & (LaneZeroF32 <= X) & (X <= MaxTexel) & (LaneZeroF32 <= Y) & (Y <= MaxTexel);
+    lane_i32 TexelX = TruncateLaneF32ToI32(Clamp(X, LaneZeroF32, MaxTexel));
+    lane_i32 TexelY = TruncateLaneF32ToI32(Clamp(Y, LaneZeroF32, MaxTexel));
+    lane_f32 Occluder = CastLaneI32ToF32(GatherLaneI32((int32_t*)Shadow->Depths, TexelY * SHADOW_MAP_SIZE + TexelX));
+    return AndNot(Inside & (Occluder > Receiver), LaneOneF32);
+}
+
+// NOTE: Share of the shadowing light reaching the lanes, see shadow_map. Positions behind the
+// light or outside of the map are lit.
+internal lane_f32
+SampleShadowMap(shadow_map* Shadow, lane_v3 Position)
+{
+    lane_v3 Offset = Position - InitLaneV3(Shadow->Origin.X, Shadow->Origin.Y, Shadow->Origin.Z);
+    lane_f32 Depth = DotProduct(Offset, InitLaneV3(Shadow->AxisZ.X, Shadow->AxisZ.Y, Shadow->AxisZ.Z));
+    lane_f32 InvDepth = LaneOneF32 / Depth;
+    lane_f32 Center = InitLaneF32(Shadow->Center);
+    lane_f32 X = MultiplyAdd(DotProduct(Offset, InitLaneV3(Shadow->AxisX.X, Shadow->AxisX.Y, Shadow->AxisX.Z)), InvDepth, Center);
+    lane_f32 Y = MultiplyAdd(DotProduct(Offset, InitLaneV3(Shadow->AxisY.X, Shadow->AxisY.Y, Shadow->AxisY.Z)), InvDepth, Center);
+    lane_f32 Inside = LaneZeroF32 < Depth;
+    lane_f32 Receiver = InvDepth * InitLaneF32(1.0f + SHADOW_DEPTH_BIAS);
+    
+    if(!Shadow->IsFiltered)
+    {
+        return GetShadowTap(Shadow, X, Y, Inside, Receiver);
+    }
+    
+    // NOTE: Percentage closer filtering, the depth tests are blended like bilinear texels
+    lane_f32 Half = InitLaneF32(0.5f);
+    X = X - Half;
+    Y = Y - Half;
+    lane_f32 X0 = Floor(X);
+    lane_f32 Y0 = Floor(Y);
+    lane_f32 FracX = X - X0;
+    lane_f32 FracY = Y - Y0;
+    lane_f32 X1 = X0 + LaneOneF32;
+    lane_f32 Y1 = Y0 + LaneOneF32;
+    lane_f32 Top = GetShadowTap(Shadow, X0, Y0, Inside, Receiver);
+    Top = MultiplyAdd(GetShadowTap(Shadow, X1, Y0, Inside, Receiver) - Top, FracX, Top);
+    lane_f32 Bottom = GetShadowTap(Shadow, X0, Y1, Inside, Receiver);
+    Bottom = MultiplyAdd(GetShadowTap(Shadow, X1, Y1, Inside, Receiver) - Bottom, FracX, Bottom);
+    return MultiplyAdd(Bottom - Top, FracY, Top);
+}
+
+// NOTE: Linear color, the normal must be normalized. The lights are broadcast one at a time,
+// every lane of the batch goes through the whole list.
+internal lane_v3
+ComputeLighting(lane_v3 Position, lane_v3 Normal, material_lanes* Material, light_list* Lights)
+{
+    lane_v3 CamPos = {};                
+    lane_v3 CamDir = CamPos - Position;
+    CamDir = Normalize<MathPrecision_Fast>(CamDir);
+    
+    scene_lights* SceneLights = Lights->Lights;
+    lane_v3 FinalColor = Hadamard(Material->AmbientColor, EvaluateProbe(Lights->Probe, Normal));
+    for(uint32_t ListIndex = 0; ListIndex < Lights->Count; ++ListIndex)
+    {
+        uint32_t Light = Lights->Indices[ListIndex];
+        lane_v3 LightPos = InitLaneV3(SceneLights->PositionsX[Light], SceneLights->PositionsY[Light], SceneLights->PositionsZ[Light]);
+        lane_v3 LightColor = InitLaneV3(SceneLights->ColorsX[Light], SceneLights->ColorsY[Light], SceneLights->ColorsZ[Light]);
+        float Radius = SceneLights->Radii[Light];
+        
+        lane_v3 LightDir = LightPos - Position;
+        lane_f32 DistanceSq = MagnitudeSq(LightDir);
+        LightDir = Normalize<MathPrecision_Fast>(LightDir);
+        
+        lane_v3 HalfAngles = CamDir + LightDir;
+        HalfAngles = Normalize<MathPrecision_Fast>(HalfAngles);
+        
+        lane_f32 NdotL = DotProduct(Normal, LightDir);
+        NdotL = Clamp(NdotL, LaneZeroF32, LaneOneF32);
+        
+        lane_f32 NdotH = DotProduct(Normal, HalfAngles);
+        NdotH = Clamp(NdotH, LaneZeroF32, LaneOneF32);
+        
+        lane_f32 SpecularHighlight = Pow<32>(NdotH);
+        
+        if(Radius > 0.0f)
+        {
+            // NOTE: (1 - d^2 / r^2)^2, reaches 0 at the radius with a flat tangent
+            lane_f32 Falloff = LaneOneF32 - DistanceSq * InitLaneF32(1.0f / (Radius * Radius));
+            Falloff = Clamp(Falloff, LaneZeroF32, LaneOneF32);
+            Falloff = Falloff * Falloff;
+            NdotL = NdotL * Falloff;
+            SpecularHighlight = SpecularHighlight * Falloff;
+        }
+        
+        if(Lights->Shadow && Light == Lights->Shadow->Light)
+        {
+            lane_f32 Lit = SampleShadowMap(Lights->Shadow, Position);
+            NdotL = NdotL * Lit;
+            SpecularHighlight = SpecularHighlight * Lit;
+        }
+        
+        lane_v3 Diffuse = Hadamard(Material->DiffuseColor, LightColor) * NdotL * Material->DiffuseIntensity;
+        lane_v3 Specular = Hadamard(Material->SpecularColor, LightColor) * SpecularHighlight * Material->SpecularIntensity;
+        
+        FinalColor = FinalColor + Diffuse;
+        FinalColor = FinalColor + Specular;
+    }
+    return FinalColor;
+}
+
+internal lane_i32 
+FragmentStage(lane_v3 Position, lane_v3 Normal, material_lanes* Material, light_list* Lights)
+{
+    return EncodeSRGB8(ComputeLighting(Position, Normal, Material, Lights));
+}
+
+internal void
+LightVertices(vector3* Positions, vector3* Normals, uint32_t Count,
+              material* Material, light_list* Lights,
+              uint16_t* ColorsX, uint16_t* ColorsY, uint16_t* ColorsZ)
+{
+    Assert(Count % LANE_WIDTH == 0);
+    material_lanes MaterialLanes = InitMaterialLanes(Material);
+    for(uint32_t Vertex = 0; Vertex < Count; Vertex += LANE_WIDTH)
+    {
+        lane_v3 Normal = Normalize<MathPrecision_Fast>(LoadLaneV3(Normals + Vertex));
+        lane_v3 Color = ComputeLighting(LoadLaneV3(Positions + Vertex), Normal, &MaterialLanes, Lights);
+        // NOTE: Clamped before interpolating, an overexposed vertex would bleed over its triangles
+        Color.X = Min(Color.X, LaneOneF32);
+        Color.Y = Min(Color.Y, LaneOneF32);
+        Color.Z = Min(Color.Z, LaneOneF32);
+        StoreLaneF16(ColorsX + Vertex, Color.X);
+        StoreLaneF16(ColorsY + Vertex, Color.Y);
+        StoreLaneF16(ColorsZ + Vertex, Color.Z);
+    }
+}
+
+internal void
+PackHalves(vector3* Source, vector3h* Dest, uint32_t Count)
+{
+    for(uint32_t Index = 0; Index < Count; ++Index)
+    {
+#if LANE_F16C
+        _mm_storel_epi64((__m128i*)(Dest + Index), _mm_cvtps_ph(Source[Index].vec, _MM_FROUND_TO_NEAREST_INT));
+#else
+        Dest[Index] = ConvertToHalf(Source[Index]);
+#endif
+    }
+}
+
+template<int32_t X, int32_t Y>
+struct block_shape
+{
+    // Dimensions of our pixel group
+    static const int32_t StepXSize = X;
+    static const int32_t StepYSize = Y;
+};
+
+#if LANE_WIDTH > 1
+using block_shape_wide   = block_shape<LANE_WIDTH, 1>;
+using block_shape_square = block_shape<LANE_WIDTH / 2, 2>;
+using block_shape_tall   = block_shape<2, LANE_WIDTH / 2>;
+#else
+using block_shape_wide   = block_shape<1, 1>;
+using block_shape_square = block_shape<1, 1>;
+using block_shape_tall   = block_shape<1, 1>;
+#endif
+
+struct edge 
+{
+    lane_i32 OneStepX;
+    lane_i32 OneStepY;
+    
+    // NOTE: The 32-bit lanes are relative to a value clamped at the raster tile corner,
+    // this brings them back to the exact edge value when computing barycentrics
+    lane_f32 OriginCorrection;
+};
+
+// NOTE: Edge values stepped inside a region stay well within 32 bits as long as
+// the region is tile sized and starts in the tile, so the value at the tile corner
+// can be clamped to this without ever flipping the sign of a lane
+#define EDGE_ORIGIN_CLAMP (1 << 30)
+
+// NOTE: Scale spaces the lanes that many pixels apart, for blocks of coarse pixels
+template<typename shape, int32_t Scale = 1>
+internal lane_i32
+InitEdge(edge* Edge, const vector2i& V0, const vector2i&V1, const vector2i& Origin)
+{
+    // Edge setup
+    int32_t A = V0.Y - V1.Y;
+    int32_t B = V1.X - V0.X;
+    
+    // Step deltas
+    Edge->OneStepX = InitLaneI32(A * shape::StepXSize * Scale);
+    Edge->OneStepY = InitLaneI32(B * shape::StepYSize * Scale);
+    
+    // Edge function value at origin, rebased on V0 and computed in 64-bit 
+    // since absolute coordinates products overflow on large render targets
+    int64_t OriginValue = (int64_t)A * (Origin.X - V0.X) + (int64_t)B * (Origin.Y - V0.Y);
+    
+    // NOTE: Clamped at the corner of the raster tile holding the origin rather than at the
+    // origin itself. The block alignment moves the origin by less than a tile, every kernel
+    // gets the same lanes and correction for a pixel whatever its block shape.
+    int32_t CornerX = Origin.X & ~(RASTER_TILE_SIZE - 1);
+    int32_t CornerY = Origin.Y & ~(RASTER_TILE_SIZE - 1);
+    int64_t CornerValue = (int64_t)A * (CornerX - V0.X) + (int64_t)B * (CornerY - V0.Y);
+    int64_t Correction = CornerValue - MAX(-EDGE_ORIGIN_CLAMP, MIN(EDGE_ORIGIN_CLAMP, CornerValue));
+    Edge->OriginCorrection = InitLaneF32((float)Correction);
+    
+    // x/y offsets for initial pixel block
+    int32_t XValues[LANE_WIDTH];
+    int32_t YValues[LANE_WIDTH];
+    int32_t LaneCounter = 0;
+    for(int32_t YOffset = 0; YOffset < shape::StepYSize; ++YOffset)
+    {
+        for(int32_t XOffset = 0; XOffset < shape::StepXSize; ++XOffset)
+        {
+            XValues[LaneCounter] = XOffset * Scale;
+            YValues[LaneCounter] = YOffset * Scale;
+            ++LaneCounter;
+        }
+    }
+    
+    lane_i32 x = LoadLaneI32(XValues);
+    lane_i32 y = LoadLaneI32(YValues);
+    
+    // Edge function values for the initial block, relative to the origin
+    return A * x + B * y + InitLaneI32((int32_t)(OriginValue - Correction));
+}
+
+// NOTE: Inverse depth of the lanes from their edge values, Z are the corner inverse depths
+// over the area. The depth equal test after a prepass relies on every caller getting the
+// same bits for the same pixel, whatever the block shape: InitEdge clamps at the tile corner
+// so the lane values and corrections of a pixel don't depend on the block alignment.
+internal lane_f32
+InterpolateDepth(lane_i32 W0, lane_i32 W1, lane_i32 W2, edge* E12, edge* E20, edge* E01,
+                 lane_f32 Z0, lane_f32 Z1, lane_f32 Z2)
+{
+    lane_f32 Depth = (ConvertLaneI32ToF32(W2) + E01->OriginCorrection) * Z2;
+    Depth = MultiplyAdd(ConvertLaneI32ToF32(W1) + E20->OriginCorrection, Z1, Depth);
+    Depth = MultiplyAdd(ConvertLaneI32ToF32(W0) + E12->OriginCorrection, Z0, Depth);
+    return Depth;
+}
+
+// NOTE: A shader is a type providing
+//   - varyings, a struct of lane_f32 and lane_v3 only. The rasterizer interpolates it as an
+//     array of lanes, each varying left out is work saved on every fragment.
+//   - Vertex, the varyings of a triangle corner read from the vertex streams, in every lane
+//   - Fragment, the packed sRGB8 color of the lanes from their interpolated varyings, the
+//     steps of the varyings to the next pixel along X and Y, constant over the triangle, and
+//     the uniforms, the material of the draw and the lights of the job
+// RasterizeRegion is instantiated per shader so both inline into the loop.
+struct phong_shader
+{
+    struct varyings
+    {
+        lane_v3 Position;
+        lane_v3 Normal;
+    };
+    
+    static varyings
+    Vertex(vertex_streams* Streams, uint32_t Index)
+    {
+        varyings Result;
+        Result.Position = InitLaneV3(Streams->Positions[Index]);
+        Result.Normal = InitLaneV3(Streams->Normals[Index]);
+        return Result;
+    }
+    
+    static lane_i32
+    Fragment(varyings Varyings, varyings* DDX, varyings* DDY, material_lanes* Material, light_list* Lights)
+    {
+        return FragmentStage(Varyings.Position, Normalize<MathPrecision_Fast>(Varyings.Normal), Material, Lights);
+    }
+};
+
+// NOTE: Phong under the diffuse texture of the material. The texture coordinates come
+// divided by z, they interpolate affinely on screen and ResolveTexCoords undoes it.
+struct textured_shader
+{
+    struct varyings
+    {
+        lane_v3 Position;
+        lane_v3 Normal;
+        lane_v3 TexCoord;
+    };
+    
+    static varyings
+    Vertex(vertex_streams* Streams, uint32_t Index)
+    {
+        varyings Result;
+        Result.Position = InitLaneV3(Streams->Positions[Index]);
+        Result.Normal = InitLaneV3(Streams->Normals[Index]);
+        vector3 TexCoord = Streams->TexCoords[Index];
+        Result.TexCoord = InitLaneV3(TexCoord.X, TexCoord.Y, TexCoord.Z);
+        return Result;
+    }
+    
+    static lane_i32
+    Fragment(varyings Varyings, varyings* DDX, varyings* DDY, material_lanes* Material, light_list* Lights)
+    {
+        lane_f32 U, V;
+        lane_f32 FootprintSq = ResolveTexCoords(Varyings.TexCoord, DDX->TexCoord, DDY->TexCoord, &U, &V);
+        material_lanes TexturedMaterial = *Material;
+        ApplyAlbedo(&TexturedMaterial, SampleTexture(Material->TextureCache, Material->DiffuseTexture, U, V, FootprintSq));
+        return FragmentStage(Varyings.Position, Normalize<MathPrecision_Fast>(Varyings.Normal), &TexturedMaterial, Lights);
+    }
+};
+
+// NOTE: Lit by LightVertices in the vertex stage
+struct gouraud_shader
+{
+    struct varyings
+    {
+        lane_v3 Color;
+    };
+    
+    static varyings
+    Vertex(vertex_streams* Streams, uint32_t Index)
+    {
+        varyings Result;
+        Result.Color = InitLaneV3(Streams->Colors[Index]);
+        return Result;
+    }
+    
+    static lane_i32
+    Fragment(varyings Varyings, varyings* DDX, varyings* DDY, material_lanes* Material, light_list* Lights)
+    {
+        return EncodeSRGB8(Varyings.Color);
+    }
+};
+
+// NOTE: Debug view of the world space normals, mapped from -1..1 to 0..1
+struct normals_shader
+{
+    struct varyings
+    {
+        lane_v3 Normal;
+    };
+    
+    static varyings
+    Vertex(vertex_streams* Streams, uint32_t Index)
+    {
+        varyings Result;
+        Result.Normal = InitLaneV3(Streams->Normals[Index]);
+        return Result;
+    }
+    
+    static lane_i32
+    Fragment(varyings Varyings, varyings* DDX, varyings* DDY, material_lanes* Material, light_list* Lights)
+    {
+        lane_f32 Half = InitLaneF32(0.5f);
+        lane_v3 Normal = Normalize<MathPrecision_Fast>(Varyings.Normal);
+        lane_v3 Color;
+        Color.X = MultiplyAdd(Normal.X, Half, Half);
+        Color.Y = MultiplyAdd(Normal.Y, Half, Half);
+        Color.Z = MultiplyAdd(Normal.Z, Half, Half);
+        return EncodeSRGB8(Color);
+    }
+};
+
+// NOTE: Unrolled through the template so every varying stays in registers
+template<int32_t Count>
+struct varyings_interpolator
+{
+    static void
+    Interpolate(lane_f32* Result, lane_f32* V0, lane_f32* V1, lane_f32* V2,
+                lane_f32 W0, lane_f32 W1, lane_f32 W2)
+    {
+        Result[0] = V0[0] * W0 + V1[0] * W1 + V2[0] * W2;
+        varyings_interpolator<Count - 1>::Interpolate(Result + 1, V0 + 1, V1 + 1, V2 + 1, W0, W1, W2);
+    }
+};
+
+template<>
+struct varyings_interpolator<0>
+{
+    static void
+    Interpolate(lane_f32* Result, lane_f32* V0, lane_f32* V1, lane_f32* V2,
+                lane_f32 W0, lane_f32 W1, lane_f32 W2)
+    {
+    }
+};
+
+template<typename varyings>
+internal varyings
+InterpolateVaryings(varyings* V0, varyings* V1, varyings* V2,
+                    lane_f32 W0, lane_f32 W1, lane_f32 W2)
+{
+    static_assert(sizeof(varyings) % sizeof(lane_f32) == 0, "Varyings can only hold lanes");
+    varyings Result;
+    varyings_interpolator<sizeof(varyings) / sizeof(lane_f32)>::Interpolate((lane_f32*)&Result, (lane_f32*)V0, (lane_f32*)V1, (lane_f32*)V2,
+                                                                            W0, W1, W2);
+    return Result;
+}
+
+template<typename shape, typename shader>
+internal void 
+RasterizeRegion(render_thread_context* Thread,
+                game_offscreen_buffer* Buffer, 
+                int32_t StartWidth, int32_t StartHeight,
+                int32_t EndWidth, int32_t EndHeight,
+                uint32_t IndexOffset,
+                vector2i* ScreenPositions,
+                vertex_streams* Streams,
+                material* Material,
+                float InvArea)
+{
+    Assert(EndWidth - StartWidth < RASTER_TILE_SIZE && EndHeight - StartHeight < RASTER_TILE_SIZE);
+    
+    // NOTE: Blocks are aligned on the image so they never step over the tile or job boundaries,
+    // the pixels added on the left and top are outside the triangle bounds
+    StartWidth -= StartWidth % shape::StepXSize;
+    StartHeight -= StartHeight % shape::StepYSize;
+    
+    vector2i V0 = ScreenPositions[IndexOffset + 0];
+    vector2i V1 = ScreenPositions[IndexOffset + 1];
+    vector2i V2 = ScreenPositions[IndexOffset + 2];
+    vector2i P = { StartWidth, StartHeight };
+    
+    edge E01, E12, E20;
+    
+    lane_i32 W0Row = InitEdge<shape>(&E12, V1, V2, P);
+    lane_i32 W1Row = InitEdge<shape>(&E20, V2, V0, P);
+    lane_i32 W2Row = InitEdge<shape>(&E01, V0, V1, P);
+    
+    // Vertex attributes broadcast once, interpolated in lanes
+    typename shader::varyings A0 = shader::Vertex(Streams, IndexOffset);
+    typename shader::varyings A1 = shader::Vertex(Streams, IndexOffset + 1);
+    typename shader::varyings A2 = shader::Vertex(Streams, IndexOffset + 2);
+    lane_f32 StepsX[3];
+    lane_f32 StepsY[3];
+    GetBarycentricSteps(V0, V1, V2, InvArea, StepsX, StepsY);
+    typename shader::varyings DDX = InterpolateVaryings(&A0, &A1, &A2, StepsX[0], StepsX[1], StepsX[2]);
+    typename shader::varyings DDY = InterpolateVaryings(&A0, &A1, &A2, StepsY[0], StepsY[1], StepsY[2]);
+    material_lanes MaterialLanes = InitMaterialLanes(Material);
+    MaterialLanes.TextureCache = Thread->TextureCache;
+    
+    int32_t PitchInPixels = Buffer->Pitch / (int32_t)sizeof(uint32_t);
+    
+    // NOTE: After a depth prepass only the lanes still at the depth it kept are shaded
+    depth_plane* Prepass = Thread->DepthPrepass;
+    lane_f32 Z0 = LaneZeroF32;
+    lane_f32 Z1 = LaneZeroF32;
+    lane_f32 Z2 = LaneZeroF32;
+    lane_i32 PlaneOffsets = LaneZeroI32;
+    if(Prepass)
+    {
+        Z0 = InitLaneF32(Streams->Depths[IndexOffset + 0] * InvArea);
+        Z1 = InitLaneF32(Streams->Depths[IndexOffset + 1] * InvArea);
+        Z2 = InitLaneF32(Streams->Depths[IndexOffset + 2] * InvArea);
+        int32_t Offsets[LANE_WIDTH];
+        for(int32_t Lane = 0; Lane < shape::StepXSize * shape::StepYSize; ++Lane)
+        {
+            Offsets[Lane] = (Lane / shape::StepXSize) * Prepass->Pitch + Lane % shape::StepXSize;
+        }
+        PlaneOffsets = LoadLaneI32(Offsets);
+    }
+    
+    for (int32_t j = StartHeight; j <= EndHeight; j += shape::StepYSize) 
+    { 
+        // Barycentric coordinates at start of row
+        lane_i32 W0 = W0Row;
+        lane_i32 W1 = W1Row;
+        lane_i32 W2 = W2Row;
+        for (int32_t i = StartWidth; i <= EndWidth; i += shape::StepXSize) 
+        {
+            lane_mask Mask = LaneZeroI32 < (W0 | W1 | W2);
+            if (Prepass && !IsAllZeros(Mask))
+            {
+                // NOTE: All bits set is never a depth, the lanes outside can't compare equal
+                lane_i32 DepthBits = InitLaneI32(-1);
+                ConditionalAssign(CastLaneF32ToI32(InterpolateDepth(W0, W1, W2, &E12, &E20, &E01, Z0, Z1, Z2)),
+                                  &DepthBits, Mask);
+                int32_t* BlockDepths = (int32_t*)Prepass->Depths + (j - Prepass->OriginY) * Prepass->Pitch + (i - Prepass->OriginX);
+                lane_i32 Depths = (shape::StepYSize == 1) ? LoadLaneI32(BlockDepths) : GatherLaneI32(BlockDepths, PlaneOffsets);
+#if SABLUJO_INTERNAL
+                Thread->Stats.PrepassFragmentsTested += CountSetLanes(Mask);
+#endif
+                Mask = Depths == DepthBits;
+#if SABLUJO_INTERNAL
+                Thread->Stats.PrepassFragmentsShaded += CountSetLanes(Mask);
+#endif
+            }
+            if (!IsAllZeros(Mask)) 
+            {
+                int32_t SetLanes = CountSetLanes(Mask);
+                Thread->FragmentsCount += SetLanes;
+                lane_i32 MaskedW0;
+                lane_i32 MaskedW1;
+                lane_i32 MaskedW2;
+                ConditionalAssign(W0, &MaskedW0, Mask);
+                ConditionalAssign(W1, &MaskedW1, Mask);
+                ConditionalAssign(W2, &MaskedW2, Mask);
+                lane_f32 W0ratio = ConvertLaneI32ToF32(MaskedW0) + E12.OriginCorrection;
+                lane_f32 W1ratio = ConvertLaneI32ToF32(MaskedW1) + E20.OriginCorrection;
+                lane_f32 W2ratio = ConvertLaneI32ToF32(MaskedW2) + E01.OriginCorrection;
+                
+                lane_f32 InvAreaVec = InitLaneF32(InvArea);
+                W0ratio = W0ratio * InvAreaVec;
+                W1ratio = W1ratio * InvAreaVec;
+                W2ratio = W2ratio * InvAreaVec;
+                
+                typename shader::varyings Varyings = InterpolateVaryings(&A0, &A1, &A2, W0ratio, W1ratio, W2ratio);
+                lane_i32 FragmentColor = shader::Fragment(Varyings, &DDX, &DDY, &MaterialLanes, &Thread->Lights);
+                
+                uint32_t* BlockPixels = (uint32_t*)((uint8_t*)Buffer->Memory + (j - Buffer->OriginY) * Buffer->Pitch) + (i - Buffer->OriginX);
+                ConditionalStoreBlock<shape::StepXSize, shape::StepYSize>(BlockPixels, PitchInPixels,
+                                                                          FragmentColor, Mask);
+#if SABLUJO_INTERNAL
+                Thread->Stats.PixelsComputed += LANE_WIDTH;
+                Thread->Stats.PixelsWasted += LANE_WIDTH - SetLanes;
+#endif
+            }
+#if SABLUJO_INTERNAL
+            else
+            {
+                Thread->Stats.PixelsSkipped += shape::StepYSize * shape::StepXSize;
+            }
+#endif
+            // One step to the right
+            W0 += E12.OneStepX;
+            W1 += E20.OneStepX;
+            W2 += E01.OneStepX;       
+        }
+        
+        // One row step
+        W0Row += E12.OneStepY;
+        W1Row += E20.OneStepY;
+        W2Row += E01.OneStepY;
+    }
+}
+
+template<typename shader>
+internal void
+RasterizeTriangleShape(render_thread_context* Thread,
+                       game_offscreen_buffer* Buffer,
+                       block_shape_type Shape,
+                       int32_t StartWidth, int32_t StartHeight,
+                       int32_t EndWidth, int32_t EndHeight,
+                       uint32_t IndexOffset,
+                       vector2i* ScreenPositions,
+                       vertex_streams* Streams,
+                       material* Material,
+                       float InvArea)
+{
+    switch(Shape)
+    {
+        case BlockShape_Wide:
+        {
+            RasterizeRegion<block_shape_wide, shader>(Thread, Buffer, StartWidth, StartHeight, EndWidth, EndHeight, 
+                                                      IndexOffset, ScreenPositions, Streams, Material, InvArea);
+        } break;
+        
+        case BlockShape_Square:
+        {
+            RasterizeRegion<block_shape_square, shader>(Thread, Buffer, StartWidth, StartHeight, EndWidth, EndHeight, 
+                                                        IndexOffset, ScreenPositions, Streams, Material, InvArea);
+        } break;
+        
+        case BlockShape_Tall:
+        {
+            RasterizeRegion<block_shape_tall, shader>(Thread, Buffer, StartWidth, StartHeight, EndWidth, EndHeight, 
+                                                      IndexOffset, ScreenPositions, Streams, Material, InvArea);
+        } break;
+        
+        default:
+        {
+            Assert(!"Invalid block shape");
+        } break;
+    }
+}
+
+internal void
+RasterizeTriangle(render_thread_context* Thread,
+                  game_offscreen_buffer* Buffer,
+                  block_shape_type Shape,
+                  int32_t StartWidth, int32_t StartHeight,
+                  int32_t EndWidth, int32_t EndHeight,
+                  uint32_t IndexOffset,
+                  vector2i* ScreenPositions,
+                  vector3h* Positions,
+                  vector3h* Normals,
+                  material* Material,
+                  float InvArea)
+{
+    vertex_streams Streams = {};
+    Streams.Positions = Positions;
+    Streams.Normals = Normals;
+    RasterizeTriangleShape<phong_shader>(Thread, Buffer, Shape, StartWidth, StartHeight, EndWidth, EndHeight,
+                                         IndexOffset, ScreenPositions, &Streams, Material, InvArea);
+}
+
+internal void
+RasterizeTriangleShaded(render_thread_context* Thread,
+                        game_offscreen_buffer* Buffer,
+                        shader_type Shader,
+                        block_shape_type Shape,
+                        int32_t StartWidth, int32_t StartHeight,
+                        int32_t EndWidth, int32_t EndHeight,
+                        uint32_t IndexOffset,
+                        vector2i* ScreenPositions,
+                        vertex_streams* Streams,
+                        material* Material,
+                        float InvArea)
+{
+    switch(Shader)
+    {
+        case Shader_Phong:
+        {
+            RasterizeTriangleShape<phong_shader>(Thread, Buffer, Shape, StartWidth, StartHeight, EndWidth, EndHeight,
+                                                 IndexOffset, ScreenPositions, Streams, Material, InvArea);
+        } break;
+        
+        case Shader_Textured:
+        {
+            RasterizeTriangleShape<textured_shader>(Thread, Buffer, Shape, StartWidth, StartHeight, EndWidth, EndHeight,
+                                                    IndexOffset, ScreenPositions, Streams, Material, InvArea);
+        } break;
+        
+        case Shader_Gouraud:
+        {
+            RasterizeTriangleShape<gouraud_shader>(Thread, Buffer, Shape, StartWidth, StartHeight, EndWidth, EndHeight,
+                                                   IndexOffset, ScreenPositions, Streams, Material, InvArea);
+        } break;
+        
+        case Shader_Normals:
+        {
+            RasterizeTriangleShape<normals_shader>(Thread, Buffer, Shape, StartWidth, StartHeight, EndWidth, EndHeight,
+                                                   IndexOffset, ScreenPositions, Streams, Material, InvArea);
+        } break;
+        
+        default:
+        {
+            Assert(!"Invalid shader");
+        } break;
+    }
+}
+
+// NOTE: Narrower lanes than a 4x4 coarse pixel row have no coarse kernel
+#if LANE_WIDTH >= 4
+// NOTE: FragmentStage runs once per coarse pixel of Rate x Rate pixels, at its center clamped
+// into the triangle. The lanes are LANE_WIDTH / Rate coarse pixels across and Rate down, so one
+// coarse row spreads over whole wide blocks: coverage is tested per pixel on those and the
+// colors are permuted in place, nothing goes through memory.
+template<int32_t Rate>
+internal void 
+RasterizeRegionCoarse(render_thread_context* Thread,
+                      game_offscreen_buffer* Buffer, 
+                      int32_t StartWidth, int32_t StartHeight,
+                      int32_t EndWidth, int32_t EndHeight,
+                      uint32_t IndexOffset,
+                      vector2i* ScreenPositions,
+                      vector3h* Positions,
+                      vector3h* Normals,
+                      material* Material,
+                      float InvArea)
+{
+    using shape = block_shape<LANE_WIDTH / Rate, Rate>;
+    const int32_t BlockHeight = Rate * Rate;
+    Assert(RENDER_JOB_MIN_SIZE % LANE_WIDTH == 0 && RENDER_JOB_MIN_SIZE % BlockHeight == 0);
+    Assert(EndWidth - StartWidth < RASTER_TILE_SIZE && EndHeight - StartHeight < RASTER_TILE_SIZE);
+    
+    StartWidth -= StartWidth % LANE_WIDTH;
+    StartHeight -= StartHeight % BlockHeight;
+    
+    vector2i V0 = ScreenPositions[IndexOffset + 0];
+    vector2i V1 = ScreenPositions[IndexOffset + 1];
+    vector2i V2 = ScreenPositions[IndexOffset + 2];
+    vector2i P = { StartWidth, StartHeight };
+    
+    // Edges at the first pixel of each coarse pixel, for shading
+    edge C01, C12, C20;
+    lane_i32 C0Row = InitEdge<shape, Rate>(&C12, V1, V2, P);
+    lane_i32 C1Row = InitEdge<shape, Rate>(&C20, V2, V0, P);
+    lane_i32 C2Row = InitEdge<shape, Rate>(&C01, V0, V1, P);
+    
+    // Edges at every pixel of the first wide block, for coverage
+    edge E01, E12, E20;
+    lane_i32 W0Row = InitEdge<block_shape_wide>(&E12, V1, V2, P);
+    lane_i32 W1Row = InitEdge<block_shape_wide>(&E20, V2, V0, P);
+    lane_i32 W2Row = InitEdge<block_shape_wide>(&E01, V0, V1, P);
+    
+    float CenterOffset = 0.5f * (float)(Rate - 1);
+    lane_f32 C0Center = C12.OriginCorrection + InitLaneF32((float)((V1.Y - V2.Y) + (V2.X - V1.X)) * CenterOffset);
+    lane_f32 C1Center = C20.OriginCorrection + InitLaneF32((float)((V2.Y - V0.Y) + (V0.X - V2.X)) * CenterOffset);
+    lane_f32 C2Center = C01.OriginCorrection + InitLaneF32((float)((V0.Y - V1.Y) + (V1.X - V0.X)) * CenterOffset);
+    lane_f32 InvAreaVec = InitLaneF32(InvArea);
+    
+    // Lane i of a wide block in coarse row Y takes the color of coarse lane Y * StepX + i / Rate
+    lane_i32 RowColorLanes[Rate];
+    for(int32_t Y = 0; Y < Rate; ++Y)
+    {
+        int32_t Lanes[LANE_WIDTH];
+        for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+        {
+            Lanes[Lane] = Y * shape::StepXSize + Lane / Rate;
+        }
+        RowColorLanes[Y] = LoadLaneI32(Lanes);
+    }
+    
+    lane_v3 P0 = InitLaneV3(Positions[IndexOffset]);
+    lane_v3 P1 = InitLaneV3(Positions[IndexOffset + 1]);
+    lane_v3 P2 = InitLaneV3(Positions[IndexOffset + 2]);
+    lane_v3 N0 = InitLaneV3(Normals[IndexOffset]);
+    lane_v3 N1 = InitLaneV3(Normals[IndexOffset + 1]);
+    lane_v3 N2 = InitLaneV3(Normals[IndexOffset + 2]);
+    material_lanes MaterialLanes = InitMaterialLanes(Material);
+    
+    int32_t PitchInPixels = Buffer->Pitch / (int32_t)sizeof(uint32_t);
+    
+    for (int32_t j = StartHeight; j <= EndHeight; j += BlockHeight) 
+    { 
+        lane_i32 C0 = C0Row;
+        lane_i32 C1 = C1Row;
+        lane_i32 C2 = C2Row;
+        lane_i32 W0Block = W0Row;
+        lane_i32 W1Block = W1Row;
+        lane_i32 W2Block = W2Row;
+        for (int32_t i = StartWidth; i <= EndWidth; i += LANE_WIDTH) 
+        {
+            lane_mask Masks[BlockHeight];
+            lane_i32 W0 = W0Block;
+            lane_i32 W1 = W1Block;
+            lane_i32 W2 = W2Block;
+            int32_t CoveredCount = 0;
+            for(int32_t Y = 0; Y < BlockHeight; ++Y)
+            {
+                Masks[Y] = LaneZeroI32 < (W0 | W1 | W2);
+                CoveredCount += CountSetLanes(Masks[Y]);
+                W0 += E12.OneStepY;
+                W1 += E20.OneStepY;
+                W2 += E01.OneStepY;
+            }
+            
+            if (CoveredCount) 
+            {
+                Thread->FragmentsCount += CoveredCount;
+                
+                // Clamped so centers outside a thin triangle don't extrapolate far
+                lane_f32 W0ratio = Clamp((ConvertLaneI32ToF32(C0) + C0Center) * InvAreaVec, LaneZeroF32, LaneOneF32);
+                lane_f32 W1ratio = Clamp((ConvertLaneI32ToF32(C1) + C1Center) * InvAreaVec, LaneZeroF32, LaneOneF32);
+                lane_f32 W2ratio = Clamp((ConvertLaneI32ToF32(C2) + C2Center) * InvAreaVec, LaneZeroF32, LaneOneF32);
+                
+                lane_v3 LanePositions = P0 * W0ratio + P1 * W1ratio + P2 * W2ratio;
+                lane_v3 LaneNormals = N0 * W0ratio + N1 * W1ratio + N2 * W2ratio;
+                LaneNormals = Normalize<MathPrecision_Fast>(LaneNormals);
+                
+                lane_i32 FragmentColor = FragmentStage(LanePositions, LaneNormals, &MaterialLanes, &Thread->Lights);
+                
+                uint32_t* BlockPixels = (uint32_t*)((uint8_t*)Buffer->Memory + (j - Buffer->OriginY) * Buffer->Pitch) + (i - Buffer->OriginX);
+                for(int32_t Y = 0; Y < BlockHeight; ++Y)
+                {
+                    lane_i32 RowColor = PermuteLanes(FragmentColor, RowColorLanes[Y / Rate]);
+                    ConditionalStoreBlock<LANE_WIDTH, 1>(BlockPixels + Y * PitchInPixels, PitchInPixels, RowColor, Masks[Y]);
+                }
+#if SABLUJO_INTERNAL
+                // NOTE: Counted as if the covered pixels were packed in as few coarse pixels
+                // as possible, the coverage of each one is never gathered
+                int32_t CoarseCovered = MIN(LANE_WIDTH, (CoveredCount + Rate * Rate - 1) / (Rate * Rate));
+                Thread->Stats.PixelsComputed += LANE_WIDTH;
+                Thread->Stats.PixelsWasted += LANE_WIDTH - CoarseCovered;
+#endif
+            }
+#if SABLUJO_INTERNAL
+            else
+            {
+                Thread->Stats.PixelsSkipped += LANE_WIDTH * BlockHeight;
+            }
+#endif
+            C0 += C12.OneStepX;
+            C1 += C20.OneStepX;
+            C2 += C01.OneStepX;
+            W0Block += E12.OneStepX;
+            W1Block += E20.OneStepX;
+            W2Block += E01.OneStepX;
+        }
+        
+        C0Row += C12.OneStepY;
+        C1Row += C20.OneStepY;
+        C2Row += C01.OneStepY;
+        for(int32_t Y = 0; Y < BlockHeight; ++Y)
+        {
+            W0Row += E12.OneStepY;
+            W1Row += E20.OneStepY;
+            W2Row += E01.OneStepY;
+        }
+    }
+}
+
+internal void
+RasterizeTriangleCoarse(render_thread_context* Thread,
+                        game_offscreen_buffer* Buffer,
+                        shading_rate Rate,
+                        int32_t StartWidth, int32_t StartHeight,
+                        int32_t EndWidth, int32_t EndHeight,
+                        uint32_t IndexOffset,
+                        vector2i* ScreenPositions,
+                        vector3h* Positions,
+                        vector3h* Normals,
+                        material* Material,
+                        float InvArea)
+{
+    switch(Rate)
+    {
+        case ShadingRate_2x2:
+        {
+            RasterizeRegionCoarse<2>(Thread, Buffer, StartWidth, StartHeight, EndWidth, EndHeight, 
+                                     IndexOffset, ScreenPositions, Positions, Normals, Material, InvArea);
+        } break;
+        
+        case ShadingRate_4x4:
+        {
+            RasterizeRegionCoarse<4>(Thread, Buffer, StartWidth, StartHeight, EndWidth, EndHeight, 
+                                     IndexOffset, ScreenPositions, Positions, Normals, Material, InvArea);
+        } break;
+        
+        default:
+        {
+            Assert(!"Invalid coarse shading rate");
+        } break;
+    }
+}
+#endif
+
+// NOTE: Keeps the closest triangle of each pixel, the one with the largest inverse depth. The
+// depth weights have the inverse area folded in.
+internal void
+RasterizeVisibility(render_thread_context* Thread,
+                    visibility_tile* Tile,
+                    int32_t StartWidth, int32_t StartHeight,
+                    int32_t EndWidth, int32_t EndHeight,
+                    uint32_t IndexOffset,
+                    vector2i* ScreenPositions,
+                    float* Depths,
+                    float InvArea,
+                    uint32_t VisibilityId)
+{
+    Assert(EndWidth - StartWidth < RASTER_TILE_SIZE && EndHeight - StartHeight < RASTER_TILE_SIZE);
+    
+    StartWidth -= StartWidth % block_shape_wide::StepXSize;
+    
+    vector2i V0 = ScreenPositions[IndexOffset + 0];
+    vector2i V1 = ScreenPositions[IndexOffset + 1];
+    vector2i V2 = ScreenPositions[IndexOffset + 2];
+    vector2i P = { StartWidth, StartHeight };
+    
+    edge E01, E12, E20;
+    
+    lane_i32 W0Row = InitEdge<block_shape_wide>(&E12, V1, V2, P);
+    lane_i32 W1Row = InitEdge<block_shape_wide>(&E20, V2, V0, P);
+    lane_i32 W2Row = InitEdge<block_shape_wide>(&E01, V0, V1, P);
+    
+    lane_f32 Z0 = InitLaneF32(Depths[IndexOffset + 0] * InvArea);
+    lane_f32 Z1 = InitLaneF32(Depths[IndexOffset + 1] * InvArea);
+    lane_f32 Z2 = InitLaneF32(Depths[IndexOffset + 2] * InvArea);
+    lane_i32 Id = InitLaneI32((int32_t)VisibilityId);
+    // NOTE: Outside lanes get the clear depth, it never passes the test
+    lane_i32 ClearDepth = InitLaneI32(RASTER_CLEAR_DEPTH);
+    
+    for (int32_t j = StartHeight; j <= EndHeight; ++j) 
+    { 
+        lane_i32 W0 = W0Row;
+        lane_i32 W1 = W1Row;
+        lane_i32 W2 = W2Row;
+        int32_t RowOffset = (j - Tile->OriginY) * RASTER_TILE_SIZE - Tile->OriginX;
+        for (int32_t i = StartWidth; i <= EndWidth; i += block_shape_wide::StepXSize) 
+        {
+            lane_mask Mask = LaneZeroI32 < (W0 | W1 | W2);
+            if (!IsAllZeros(Mask)) 
+            {
+                Thread->FragmentsCount += CountSetLanes(Mask);
+                lane_f32 Depth = (ConvertLaneI32ToF32(W2) + E01.OriginCorrection) * Z2;
+                Depth = MultiplyAdd(ConvertLaneI32ToF32(W1) + E20.OriginCorrection, Z1, Depth);
+                Depth = MultiplyAdd(ConvertLaneI32ToF32(W0) + E12.OriginCorrection, Z0, Depth);
+                lane_i32 DepthBits = ClearDepth;
+                ConditionalAssign(CastLaneF32ToI32(Depth), &DepthBits, Mask);
+                
+                uint32_t* BlockDepths = Tile->Depths + RowOffset + i;
+                lane_mask Closer = LoadLaneI32((int32_t*)BlockDepths) < DepthBits;
+                if (!IsAllZeros(Closer))
+                {
+                    ConditionalStoreBlock<block_shape_wide::StepXSize, 1>(BlockDepths, RASTER_TILE_SIZE, DepthBits, Closer);
+                    ConditionalStoreBlock<block_shape_wide::StepXSize, 1>(Tile->Ids + RowOffset + i, RASTER_TILE_SIZE, Id, Closer);
+                }
+            }
+#if SABLUJO_INTERNAL
+            else
+            {
+                Thread->Stats.PixelsSkipped += block_shape_wide::StepXSize;
+            }
+#endif
+            W0 += E12.OneStepX;
+            W1 += E20.OneStepX;
+            W2 += E01.OneStepX;       
+        }
+        
+        W0Row += E12.OneStepY;
+        W1Row += E20.OneStepY;
+        W2Row += E01.OneStepY;
+    }
+}
+
+// NOTE: The interpolation of RasterizeVisibility with nothing but the depth test behind it
+internal void
+RasterizeDepth(render_thread_context* Thread,
+               depth_plane* Plane,
+               int32_t StartWidth, int32_t StartHeight,
+               int32_t EndWidth, int32_t EndHeight,
+               uint32_t IndexOffset,
+               vector2i* ScreenPositions,
+               float* Depths,
+               float InvArea)
+{
+    Assert(EndWidth - StartWidth < RASTER_TILE_SIZE && EndHeight - StartHeight < RASTER_TILE_SIZE);
+    
+    StartWidth -= StartWidth % block_shape_wide::StepXSize;
+    
+    vector2i V0 = ScreenPositions[IndexOffset + 0];
+    vector2i V1 = ScreenPositions[IndexOffset + 1];
+    vector2i V2 = ScreenPositions[IndexOffset + 2];
+    vector2i P = { StartWidth, StartHeight };
+    
+    edge E01, E12, E20;
+    
+    lane_i32 W0Row = InitEdge<block_shape_wide>(&E12, V1, V2, P);
+    lane_i32 W1Row = InitEdge<block_shape_wide>(&E20, V2, V0, P);
+    lane_i32 W2Row = InitEdge<block_shape_wide>(&E01, V0, V1, P);
+    
+    lane_f32 Z0 = InitLaneF32(Depths[IndexOffset + 0] * InvArea);
+    lane_f32 Z1 = InitLaneF32(Depths[IndexOffset + 1] * InvArea);
+    lane_f32 Z2 = InitLaneF32(Depths[IndexOffset + 2] * InvArea);
+    lane_i32 ClearDepth = InitLaneI32(RASTER_CLEAR_DEPTH);
+    
+    for (int32_t j = StartHeight; j <= EndHeight; ++j) 
+    { 
+        lane_i32 W0 = W0Row;
+        lane_i32 W1 = W1Row;
+        lane_i32 W2 = W2Row;
+        uint32_t* Row = Plane->Depths + (j - Plane->OriginY) * Plane->Pitch - Plane->OriginX;
+        for (int32_t i = StartWidth; i <= EndWidth; i += block_shape_wide::StepXSize) 
+        {
+            lane_mask Mask = LaneZeroI32 < (W0 | W1 | W2);
+            if (!IsAllZeros(Mask)) 
+            {
+                Thread->FragmentsCount += CountSetLanes(Mask);
+                lane_f32 Depth = InterpolateDepth(W0, W1, W2, &E12, &E20, &E01, Z0, Z1, Z2);
+                lane_i32 DepthBits = ClearDepth;
+                ConditionalAssign(CastLaneF32ToI32(Depth), &DepthBits, Mask);
+                
+                uint32_t* BlockDepths = Row + i;
+                lane_mask Closer = LoadLaneI32((int32_t*)BlockDepths) < DepthBits;
+                if (!IsAllZeros(Closer))
+                {
+                    ConditionalStoreBlock<block_shape_wide::StepXSize, 1>(BlockDepths, Plane->Pitch, DepthBits, Closer);
+                }
+            }
+            W0 += E12.OneStepX;
+            W1 += E20.OneStepX;
+            W2 += E01.OneStepX;       
+        }
+        
+        W0Row += E12.OneStepY;
+        W1Row += E20.OneStepY;
+        W2Row += E01.OneStepY;
+    }
+}
+
+// NOTE: Every triangle seen in a block is interpolated over the whole block and its lanes
+// picked out, FragmentStage then runs once for all of them. The edges are set up again at
+// each block so the barycentrics are exactly the ones RasterizeRegion would compute. Lanes
+// are Scale pixels apart from X along row Y, LaneIds holds their ids.
+template<int32_t Scale>
+internal lane_i32
+ShadeVisibleLanes(render_frame* Frame, light_list* Lights, texture_cache* TextureCache,
+                  uint32_t* LaneIds, lane_i32 Ids, int32_t X, int32_t Y)
+{
+    uint32_t TriangleMask = (1 << VISIBILITY_TRIANGLE_BITS) - 1;
+    lane_i32 PositionX = LaneZeroI32;
+    lane_i32 PositionY = LaneZeroI32;
+    lane_i32 PositionZ = LaneZeroI32;
+    lane_i32 NormalX = LaneZeroI32;
+    lane_i32 NormalY = LaneZeroI32;
+    lane_i32 NormalZ = LaneZeroI32;
+    lane_v3 Albedo = InitLaneV3(1.0f, 1.0f, 1.0f);
+    bool IsTextured = false;
+    uint32_t LanesDone = 0;
+    for(int32_t Lane = 0; Lane < block_shape_wide::StepXSize; ++Lane)
+    {
+        uint32_t Id = LaneIds[Lane];
+        if(Id == VISIBILITY_EMPTY_ID || (LanesDone & (1 << Lane)))
+        {
+            continue;
+        }
+        for(int32_t OtherLane = Lane; OtherLane < block_shape_wide::StepXSize; ++OtherLane)
+        {
+            LanesDone |= (LaneIds[OtherLane] == Id) << OtherLane;
+        }
+        
+        uint32_t TriangleIndex = Frame->MeshFirstTriangles[Id >> VISIBILITY_TRIANGLE_BITS] + (Id & TriangleMask);
+        uint32_t IndexOffset = TriangleIndex * 3;
+        vector2i V0 = Frame->ScreenPositions[IndexOffset + 0];
+        vector2i V1 = Frame->ScreenPositions[IndexOffset + 1];
+        vector2i V2 = Frame->ScreenPositions[IndexOffset + 2];
+        vector2i P = { X, Y };
+        
+        edge E01, E12, E20;
+        lane_i32 W0 = InitEdge<block_shape_wide, Scale>(&E12, V1, V2, P);
+        lane_i32 W1 = InitEdge<block_shape_wide, Scale>(&E20, V2, V0, P);
+        lane_i32 W2 = InitEdge<block_shape_wide, Scale>(&E01, V0, V1, P);
+        
+        float InvArea = Frame->Triangles[TriangleIndex].InvArea;
+        lane_f32 InvAreaVec = InitLaneF32(InvArea);
+        lane_f32 W0ratio = (ConvertLaneI32ToF32(W0) + E12.OriginCorrection) * InvAreaVec;
+        lane_f32 W1ratio = (ConvertLaneI32ToF32(W1) + E20.OriginCorrection) * InvAreaVec;
+        lane_f32 W2ratio = (ConvertLaneI32ToF32(W2) + E01.OriginCorrection) * InvAreaVec;
+        
+        lane_v3 LanePositions = (InitLaneV3(Frame->Positions[IndexOffset]) * W0ratio + 
+                                 InitLaneV3(Frame->Positions[IndexOffset + 1]) * W1ratio + 
+                                 InitLaneV3(Frame->Positions[IndexOffset + 2]) * W2ratio);
+        lane_v3 LaneNormals = (InitLaneV3(Frame->Normals[IndexOffset]) * W0ratio + 
+                               InitLaneV3(Frame->Normals[IndexOffset + 1]) * W1ratio + 
+                               InitLaneV3(Frame->Normals[IndexOffset + 2]) * W2ratio);
+        
+        lane_mask Same = Ids == InitLaneI32((int32_t)Id);
+        ConditionalAssign(CastLaneF32ToI32(LanePositions.X), &PositionX, Same);
+        ConditionalAssign(CastLaneF32ToI32(LanePositions.Y), &PositionY, Same);
+        ConditionalAssign(CastLaneF32ToI32(LanePositions.Z), &PositionZ, Same);
+        ConditionalAssign(CastLaneF32ToI32(LaneNormals.X), &NormalX, Same);
+        ConditionalAssign(CastLaneF32ToI32(LaneNormals.Y), &NormalY, Same);
+        ConditionalAssign(CastLaneF32ToI32(LaneNormals.Z), &NormalZ, Same);
+        
+        texture* Texture = Frame->Materials[Id >> VISIBILITY_TRIANGLE_BITS].DiffuseTexture;
+        if(Texture)
+        {
+            // NOTE: Steps of one pixel even on the checkerboard, where the lanes are two apart
+            lane_f32 StepsX[3];
+            lane_f32 StepsY[3];
+            GetBarycentricSteps(V0, V1, V2, InvArea, StepsX, StepsY);
+            vector3* TexCoords = Frame->TexCoords + IndexOffset;
+            lane_v3 T0 = InitLaneV3(TexCoords[0].X, TexCoords[0].Y, TexCoords[0].Z);
+            lane_v3 T1 = InitLaneV3(TexCoords[1].X, TexCoords[1].Y, TexCoords[1].Z);
+            lane_v3 T2 = InitLaneV3(TexCoords[2].X, TexCoords[2].Y, TexCoords[2].Z);
+            lane_v3 TexCoord = T0 * W0ratio + T1 * W1ratio + T2 * W2ratio;
+            lane_v3 DDX = T0 * StepsX[0] + T1 * StepsX[1] + T2 * StepsX[2];
+            lane_v3 DDY = T0 * StepsY[0] + T1 * StepsY[1] + T2 * StepsY[2];
+            lane_f32 U, V;
+            lane_f32 FootprintSq = ResolveTexCoords(TexCoord, DDX, DDY, &U, &V);
+            ConditionalAssign(SampleTexture(TextureCache, Texture, U, V, FootprintSq), &Albedo, Same);
+            IsTextured = true;
+        }
+    }
+    
+    lane_v3 LanePositions = { CastLaneI32ToF32(PositionX), CastLaneI32ToF32(PositionY), CastLaneI32ToF32(PositionZ) };
+    lane_v3 LaneNormals = { CastLaneI32ToF32(NormalX), CastLaneI32ToF32(NormalY), CastLaneI32ToF32(NormalZ) };
+    LaneNormals = Normalize<MathPrecision_Fast>(LaneNormals);
+    
+    // NOTE: Empty ids shift to a mesh index past MAX_FRAME_MESH_COUNT
+    material_lanes MaterialLanes = GatherMaterialLanes(Frame->Materials, Ids >> VISIBILITY_TRIANGLE_BITS);
+    if(IsTextured)
+    {
+        ApplyAlbedo(&MaterialLanes, Albedo);
+    }
+    return FragmentStage(LanePositions, LaneNormals, &MaterialLanes, Lights);
+}
+
+internal void
+ShadeVisibility(render_thread_context* Thread,
+                render_frame* Frame,
+                visibility_tile* Tile,
+                int32_t MinX, int32_t MinY,
+                int32_t MaxX, int32_t MaxY)
+{
+    game_offscreen_buffer* Buffer = Frame->Buffer;
+    int32_t PitchInPixels = Buffer->Pitch / (int32_t)sizeof(uint32_t);
+    lane_i32 EmptyId = InitLaneI32((int32_t)VISIBILITY_EMPTY_ID);
+    
+    for (int32_t j = MinY; j <= MaxY; ++j) 
+    { 
+        uint32_t* IdRow = Tile->Ids + (j - Tile->OriginY) * RASTER_TILE_SIZE - Tile->OriginX;
+        for (int32_t i = MinX; i <= MaxX; i += block_shape_wide::StepXSize) 
+        {
+            uint32_t* BlockIds = IdRow + i;
+            lane_i32 Ids = LoadLaneI32((int32_t*)BlockIds);
+            lane_mask Visible = EmptyId < Ids;
+            if (IsAllZeros(Visible)) 
+            {
+                continue;
+            }
+            
+            lane_i32 FragmentColor = ShadeVisibleLanes<1>(Frame, &Thread->Lights, Thread->TextureCache, BlockIds, Ids, i, j);
+            
+            uint32_t* BlockPixels = (uint32_t*)((uint8_t*)Buffer->Memory + (j - Buffer->OriginY) * Buffer->Pitch) + (i - Buffer->OriginX);
+            ConditionalStoreBlock<block_shape_wide::StepXSize, 1>(BlockPixels, PitchInPixels, FragmentColor, Visible);
+#if SABLUJO_INTERNAL
+            int32_t VisibleLanes = CountSetLanes(Visible);
+            Thread->Stats.PixelsComputed += LANE_WIDTH;
+            Thread->Stats.PixelsWasted += LANE_WIDTH - VisibleLanes;
+#endif
+        }
+    }
+}
+
+// NOTE: Only the pixels where X + Y + Parity is even, so a block of lanes spans twice as many
+// pixels. Empty pixels aren't written, ReconstructCheckerboard clears them with the others.
+internal void
+ShadeCheckerboard(render_thread_context* Thread,
+                  render_frame* Frame,
+                  visibility_tile* Tile,
+                  int32_t MinX, int32_t MinY,
+                  int32_t MaxX, int32_t MaxY,
+                  uint32_t Parity)
+{
+    game_offscreen_buffer* Buffer = Frame->Buffer;
+    lane_i32 EmptyId = InitLaneI32((int32_t)VISIBILITY_EMPTY_ID);
+    
+    for (int32_t j = MinY; j <= MaxY; ++j) 
+    { 
+        uint32_t* IdRow = Tile->Ids + (j - Tile->OriginY) * RASTER_TILE_SIZE - Tile->OriginX;
+        uint32_t* PixelRow = (uint32_t*)((uint8_t*)Buffer->Memory + (j - Buffer->OriginY) * Buffer->Pitch) - Buffer->OriginX;
+        int32_t FirstX = MinX + (int32_t)((MinX + j + Parity) & 1);
+        for (int32_t i = FirstX; i <= MaxX; i += 2 * block_shape_wide::StepXSize) 
+        {
+            int32_t LanesCount = MIN(block_shape_wide::StepXSize, (MaxX - i) / 2 + 1);
+            uint32_t LaneIds[block_shape_wide::StepXSize];
+            for(int32_t Lane = 0; Lane < block_shape_wide::StepXSize; ++Lane)
+            {
+                LaneIds[Lane] = (Lane < LanesCount) ? IdRow[i + 2 * Lane] : VISIBILITY_EMPTY_ID;
+            }
+            lane_i32 Ids = LoadLaneI32((int32_t*)LaneIds);
+            lane_mask Visible = EmptyId < Ids;
+            if (IsAllZeros(Visible)) 
+            {
+                continue;
+            }
+            
+            uint32_t Colors[block_shape_wide::StepXSize];
+            StoreLaneI32((int32_t*)Colors, ShadeVisibleLanes<2>(Frame, &Thread->Lights, Thread->TextureCache, LaneIds, Ids, i, j));
+            for(int32_t Lane = 0; Lane < LanesCount; ++Lane)
+            {
+                if(LaneIds[Lane] != VISIBILITY_EMPTY_ID)
+                {
+                    PixelRow[i + 2 * Lane] = Colors[Lane];
+                }
+            }
+#if SABLUJO_INTERNAL
+            int32_t VisibleLanes = CountSetLanes(Visible);
+            Thread->Stats.PixelsComputed += LANE_WIDTH;
+            Thread->Stats.PixelsWasted += LANE_WIDTH - VisibleLanes;
+#endif
+        }
+    }
+}
+
+// NOTE: Same depth test as RasterizeVisibility, the closest fragments write their
+// interpolated position and normal instead of an id, and the texture color when Texture
+// is set. TexCoords are only read then.
+internal void
+RasterizeGBuffer(render_thread_context* Thread,
+                 gbuffer_tile* Tile,
+                 int32_t StartWidth, int32_t StartHeight,
+                 int32_t EndWidth, int32_t EndHeight,
+                 uint32_t IndexOffset,
+                 vector2i* ScreenPositions,
+                 vector3h* Positions,
+                 vector3h* Normals,
+                 vector3* TexCoords,
+                 float* Depths,
+                 float InvArea,
+                 uint32_t MeshIndex,
+                 texture* Texture)
+{
+    Assert(EndWidth - StartWidth < RASTER_TILE_SIZE && EndHeight - StartHeight < RASTER_TILE_SIZE);
+    
+    StartWidth -= StartWidth % block_shape_wide::StepXSize;
+    
+    vector2i V0 = ScreenPositions[IndexOffset + 0];
+    vector2i V1 = ScreenPositions[IndexOffset + 1];
+    vector2i V2 = ScreenPositions[IndexOffset + 2];
+    vector2i P = { StartWidth, StartHeight };
+    
+    edge E01, E12, E20;
+    
+    lane_i32 W0Row = InitEdge<block_shape_wide>(&E12, V1, V2, P);
+    lane_i32 W1Row = InitEdge<block_shape_wide>(&E20, V2, V0, P);
+    lane_i32 W2Row = InitEdge<block_shape_wide>(&E01, V0, V1, P);
+    
+    lane_v3 P0 = InitLaneV3(Positions[IndexOffset]);
+    lane_v3 P1 = InitLaneV3(Positions[IndexOffset + 1]);
+    lane_v3 P2 = InitLaneV3(Positions[IndexOffset + 2]);
+    lane_v3 N0 = InitLaneV3(Normals[IndexOffset]);
+    lane_v3 N1 = InitLaneV3(Normals[IndexOffset + 1]);
+    lane_v3 N2 = InitLaneV3(Normals[IndexOffset + 2]);
+    lane_f32 Z0 = InitLaneF32(Depths[IndexOffset + 0]);
+    lane_f32 Z1 = InitLaneF32(Depths[IndexOffset + 1]);
+    lane_f32 Z2 = InitLaneF32(Depths[IndexOffset + 2]);
+    lane_f32 InvAreaVec = InitLaneF32(InvArea);
+    lane_i32 ClearDepth = InitLaneI32(RASTER_CLEAR_DEPTH);
+    lane_i32 MeshIndexLanes = InitLaneI32((int32_t)MeshIndex);
+    
+    lane_v3 T0 = {};
+    lane_v3 T1 = {};
+    lane_v3 T2 = {};
+    lane_v3 TexCoordDDX = {};
+    lane_v3 TexCoordDDY = {};
+    if(Texture)
+    {
+        lane_f32 StepsX[3];
+        lane_f32 StepsY[3];
+        GetBarycentricSteps(V0, V1, V2, InvArea, StepsX, StepsY);
+        T0 = InitLaneV3(TexCoords[IndexOffset].X, TexCoords[IndexOffset].Y, TexCoords[IndexOffset].Z);
+        T1 = InitLaneV3(TexCoords[IndexOffset + 1].X, TexCoords[IndexOffset + 1].Y, TexCoords[IndexOffset + 1].Z);
+        T2 = InitLaneV3(TexCoords[IndexOffset + 2].X, TexCoords[IndexOffset + 2].Y, TexCoords[IndexOffset + 2].Z);
+        TexCoordDDX = T0 * StepsX[0] + T1 * StepsX[1] + T2 * StepsX[2];
+        TexCoordDDY = T0 * StepsY[0] + T1 * StepsY[1] + T2 * StepsY[2];
+    }
+    
+    for (int32_t j = StartHeight; j <= EndHeight; ++j) 
+    { 
+        lane_i32 W0 = W0Row;
+        lane_i32 W1 = W1Row;
+        lane_i32 W2 = W2Row;
+        int32_t RowOffset = (j - Tile->OriginY) * RASTER_TILE_SIZE - Tile->OriginX;
+        for (int32_t i = StartWidth; i <= EndWidth; i += block_shape_wide::StepXSize) 
+        {
+            lane_mask Mask = LaneZeroI32 < (W0 | W1 | W2);
+            if (!IsAllZeros(Mask)) 
+            {
+                Thread->FragmentsCount += CountSetLanes(Mask);
+                lane_f32 W0ratio = (ConvertLaneI32ToF32(W0) + E12.OriginCorrection) * InvAreaVec;
+                lane_f32 W1ratio = (ConvertLaneI32ToF32(W1) + E20.OriginCorrection) * InvAreaVec;
+                lane_f32 W2ratio = (ConvertLaneI32ToF32(W2) + E01.OriginCorrection) * InvAreaVec;
+                lane_f32 Depth = MultiplyAdd(Z0, W0ratio, MultiplyAdd(Z1, W1ratio, Z2 * W2ratio));
+                lane_i32 DepthBits = ClearDepth;
+                ConditionalAssign(CastLaneF32ToI32(Depth), &DepthBits, Mask);
+                
+                int32_t PlaneOffset = RowOffset + i;
+                lane_mask Closer = LoadLaneI32((int32_t*)Tile->Depths + PlaneOffset) < DepthBits;
+                if (!IsAllZeros(Closer))
+                {
+                    lane_v3 LanePositions = P0 * W0ratio + P1 * W1ratio + P2 * W2ratio;
+                    lane_v3 LaneNormals = N0 * W0ratio + N1 * W1ratio + N2 * W2ratio;
+                    ConditionalStoreBlock<block_shape_wide::StepXSize, 1>(Tile->Depths + PlaneOffset, RASTER_TILE_SIZE, DepthBits, Closer);
+                    ConditionalStoreLaneF16(Tile->PositionsX + PlaneOffset, LanePositions.X, Closer);
+                    ConditionalStoreLaneF16(Tile->PositionsY + PlaneOffset, LanePositions.Y, Closer);
+                    ConditionalStoreLaneF16(Tile->PositionsZ + PlaneOffset, LanePositions.Z, Closer);
+                    ConditionalStoreLaneF16(Tile->NormalsX + PlaneOffset, LaneNormals.X, Closer);
+                    ConditionalStoreLaneF16(Tile->NormalsY + PlaneOffset, LaneNormals.Y, Closer);
+                    ConditionalStoreLaneF16(Tile->NormalsZ + PlaneOffset, LaneNormals.Z, Closer);
+                    ConditionalStoreBlock<block_shape_wide::StepXSize, 1>(Tile->MeshIndices + PlaneOffset, RASTER_TILE_SIZE, MeshIndexLanes, Closer);
+                    
+                    lane_v3 Albedo = InitLaneV3(1.0f, 1.0f, 1.0f);
+                    if(Texture)
+                    {
+                        lane_v3 TexCoord = T0 * W0ratio + T1 * W1ratio + T2 * W2ratio;
+                        lane_f32 U, V;
+                        lane_f32 FootprintSq = ResolveTexCoords(TexCoord, TexCoordDDX, TexCoordDDY, &U, &V);
+                        Albedo = SampleTexture(Thread->TextureCache, Texture, U, V, FootprintSq);
+                    }
+                    ConditionalStoreLaneF16(Tile->AlbedosX + PlaneOffset, Albedo.X, Closer);
+                    ConditionalStoreLaneF16(Tile->AlbedosY + PlaneOffset, Albedo.Y, Closer);
+                    ConditionalStoreLaneF16(Tile->AlbedosZ + PlaneOffset, Albedo.Z, Closer);
+                }
+            }
+#if SABLUJO_INTERNAL
+            else
+            {
+                Thread->Stats.PixelsSkipped += block_shape_wide::StepXSize;
+            }
+#endif
+            W0 += E12.OneStepX;
+            W1 += E20.OneStepX;
+            W2 += E01.OneStepX;       
+        }
+        
+        W0Row += E12.OneStepY;
+        W1Row += E20.OneStepY;
+        W2Row += E01.OneStepY;
+    }
+}
+
+// NOTE: Lights a region of a G-buffer tile, every covered pixel exactly once
+internal void
+ShadeGBuffer(render_thread_context* Thread,
+             game_offscreen_buffer* Buffer,
+             gbuffer_tile* Tile,
+             material* Materials,
+             int32_t MinX, int32_t MinY,
+             int32_t MaxX, int32_t MaxY)
+{
+    int32_t PitchInPixels = Buffer->Pitch / (int32_t)sizeof(uint32_t);
+    for (int32_t j = MinY; j <= MaxY; ++j) 
+    { 
+        int32_t RowOffset = (j - Tile->OriginY) * RASTER_TILE_SIZE - Tile->OriginX;
+        for (int32_t i = MinX; i <= MaxX; i += block_shape_wide::StepXSize) 
+        {
+            int32_t PlaneOffset = RowOffset + i;
+            lane_mask Covered = InitLaneI32(RASTER_CLEAR_DEPTH) < LoadLaneI32((int32_t*)Tile->Depths + PlaneOffset);
+            if (IsAllZeros(Covered)) 
+            {
+                continue;
+            }
+            
+            lane_v3 LanePositions;
+            LanePositions.X = LoadLaneF16(Tile->PositionsX + PlaneOffset);
+            LanePositions.Y = LoadLaneF16(Tile->PositionsY + PlaneOffset);
+            LanePositions.Z = LoadLaneF16(Tile->PositionsZ + PlaneOffset);
+            lane_v3 LaneNormals;
+            LaneNormals.X = LoadLaneF16(Tile->NormalsX + PlaneOffset);
+            LaneNormals.Y = LoadLaneF16(Tile->NormalsY + PlaneOffset);
+            LaneNormals.Z = LoadLaneF16(Tile->NormalsZ + PlaneOffset);
+            LaneNormals = Normalize<MathPrecision_Fast>(LaneNormals);
+            
+            // NOTE: Uncovered lanes were never written, their mesh index is garbage
+            lane_i32 Meshes = InitLaneI32(MAX_FRAME_MESH_COUNT);
+            ConditionalAssign(LoadLaneI32((int32_t*)Tile->MeshIndices + PlaneOffset), &Meshes, Covered);
+            material_lanes MaterialLanes = GatherMaterialLanes(Materials, Meshes);
+            lane_v3 Albedo;
+            Albedo.X = LoadLaneF16(Tile->AlbedosX + PlaneOffset);
+            Albedo.Y = LoadLaneF16(Tile->AlbedosY + PlaneOffset);
+            Albedo.Z = LoadLaneF16(Tile->AlbedosZ + PlaneOffset);
+            ApplyAlbedo(&MaterialLanes, Albedo);
+            
+            lane_i32 FragmentColor = FragmentStage(LanePositions, LaneNormals, &MaterialLanes, &Thread->Lights);
+            
+            uint32_t* BlockPixels = (uint32_t*)((uint8_t*)Buffer->Memory + (j - Buffer->OriginY) * Buffer->Pitch) + (i - Buffer->OriginX);
+            ConditionalStoreBlock<block_shape_wide::StepXSize, 1>(BlockPixels, PitchInPixels, FragmentColor, Covered);
+#if SABLUJO_INTERNAL
+            int32_t CoveredLanes = CountSetLanes(Covered);
+            Thread->Stats.PixelsComputed += LANE_WIDTH;
+            Thread->Stats.PixelsWasted += LANE_WIDTH - CoveredLanes;
+#endif
+        }
+    }
+}
+
+#if LANE_FIXED16
+// NOTE: Linear Q15 intensity >> 2 to the truncated 8-bit sRGB value, padded so the 32-bit
+// gather of the last entry stays in the table
+#define SRGB8_TABLE_SIZE (1 << 13)
+global_variable uint8_t SRGB8Table[SRGB8_TABLE_SIZE + 3];
+
+internal void
+InitSRGB8Table()
+{
+    for(int32_t Index = 0; Index < SRGB8_TABLE_SIZE; ++Index)
+    {
+        // NOTE: Same curve as LinearToSRGB, saturated Q15 reads as 1
+        float Linear = (float)Index / (float)(SRGB8_TABLE_SIZE - 1);
+        float SRGB = Linear < 0.0031308f ? Linear * 12.92f : 1.055f * powf(Linear, 1.0f / 2.4f);
+        SRGB8Table[Index] = (uint8_t)(MIN(SRGB, 1.0f) * 255.0f);
+    }
+}
+
+internal lane_i32
+LookupSRGB8(lane_i32 Linear)
+{
+    lane_i32 Result = _mm256_i32gather_epi32((const int*)SRGB8Table, Linear >> 2, 1);
+    return Result & InitLaneI32(0xFF);
+}
+
+// NOTE: Scalar on purpose, the vector3 operators are shared inline functions
+internal lane_v3_i16
+InitLaneV3Q14(float X, float Y, float Z)
+{
+    float Scale = (float)Q14_ONE / sqrtf(X * X + Y * Y + Z * Z);
+    return InitLaneV3I16((int16_t)(X * Scale), (int16_t)(Y * Scale), (int16_t)(Z * Scale));
+}
+
+internal lane_i16
+BarycentricQ15(lane_i32 UpperW, lane_i32 LowerW, lane_f32 OriginCorrection, lane_f32 InvArea)
+{
+    lane_f32 Scale = InvArea * InitLaneF32((float)Q15_MAX);
+    lane_i32 Upper = ConvertLaneF32ToI32((ConvertLaneI32ToF32(UpperW) + OriginCorrection) * Scale);
+    lane_i32 Lower = ConvertLaneF32ToI32((ConvertLaneI32ToF32(LowerW) + OriginCorrection) * Scale);
+    return PackLaneI32ToI16(Upper, Lower);
+}
+
+// NOTE: A weight of a Q15 term, split into integer and Q15 fraction multipliers and
+// applied to the term clamped below the product overflow
+struct fixed16_weight
+{
+    lane_i16 Limit;
+    int16_t Integer;
+    lane_i16 Fraction;
+};
+
+internal fixed16_weight
+InitFixed16Weight(float Weight)
+{
+    fixed16_weight Result = {};
+    Result.Limit = InitLaneI16(0);
+    Result.Fraction = InitLaneI16(0);
+    if(Weight > 0.0f)
+    {
+        Weight = MIN(Weight, (float)Q15_MAX);
+        Result.Integer = (int16_t)Weight;
+        Result.Limit = InitLaneI16(Weight > 1.0f ? (int16_t)((float)Q15_MAX / Weight) : Q15_MAX);
+        Result.Fraction = InitLaneI16((int16_t)MIN((Weight - (float)Result.Integer) * (float)Q15_MAX, (float)Q15_MAX));
+    }
+    return Result;
+}
+
+internal lane_i16
+ApplyFixed16Weight(lane_i16 Value, fixed16_weight* Weight)
+{
+    lane_i16 Clamped = Min(Value, Weight->Limit);
+    return Clamped * Weight->Integer + MultiplyFixed(Clamped, Weight->Fraction);
+}
+
+internal lane_i32
+LookupChannelSRGB8(lane_i16 Channel, lane_i16 Zero, int32_t Shift, lane_i32* Lower)
+{
+    lane_i32 Upper;
+    UnpackLaneI16(Channel, Zero, &Upper, Lower);
+    *Lower = LookupSRGB8(*Lower) << Shift;
+    return LookupSRGB8(Upper) << Shift;
+}
+
+// NOTE: FragmentStage in 16-bit fixed point, 16 pixels per register on 4x4 blocks. The light
+// and half vectors are normalized per vertex and interpolated like the normals instead of
+// being derived from the interpolated position, the SH ambient is evaluated per vertex and
+// interpolated, and the sRGB encode is a table lookup. The material and light color fold into
+// one diffuse and one specular weight per channel. Only the first light of the list is shaded,
+// without falloff or shadows, and untextured, see CanShadeFixed16 for the dispatch.
+// Against the float path on the test scene at 1280x720: 58% of the covered pixels match,
+// 3% are more than 16 steps off with 56 at worst, 36 dB PSNR over the covered pixels, the per
+// vertex ambient accounts for most of it. About 4x faster than the AVX2 float kernel.
+internal void
+RasterizeTriangleFixed16(render_thread_context* Thread,
+                         game_offscreen_buffer* Buffer,
+                         block_shape_type Shape,
+                         int32_t StartWidth, int32_t StartHeight,
+                         int32_t EndWidth, int32_t EndHeight,
+                         uint32_t IndexOffset,
+                         vector2i* ScreenPositions,
+                         vector3h* Positions,
+                         vector3h* Normals,
+                         material* Material,
+                         float InvArea)
+{
+    Assert(EndWidth - StartWidth < RASTER_TILE_SIZE && EndHeight - StartHeight < RASTER_TILE_SIZE);
+    
+    // NOTE: Each 4x4 block is two square 4x2 halves of 32-bit edge lanes packed together
+    StartWidth -= StartWidth % 4;
+    StartHeight -= StartHeight % 4;
+    
+    vector2i V0 = ScreenPositions[IndexOffset + 0];
+    vector2i V1 = ScreenPositions[IndexOffset + 1];
+    vector2i V2 = ScreenPositions[IndexOffset + 2];
+    vector2i P = { StartWidth, StartHeight };
+    
+    edge E01, E12, E20;
+    
+    lane_i32 W0Row = InitEdge<block_shape_square>(&E12, V1, V2, P);
+    lane_i32 W1Row = InitEdge<block_shape_square>(&E20, V2, V0, P);
+    lane_i32 W2Row = InitEdge<block_shape_square>(&E01, V0, V1, P);
+    
+    Assert(Thread->Lights.Count == 1);
+    scene_lights* SceneLights = Thread->Lights.Lights;
+    uint32_t Light = Thread->Lights.Indices[0];
+    vector3 LightPos = { SceneLights->PositionsX[Light], SceneLights->PositionsY[Light], SceneLights->PositionsZ[Light] };
+    vector3 LightColor = { SceneLights->ColorsX[Light], SceneLights->ColorsY[Light], SceneLights->ColorsZ[Light] };
+    
+    fixed16_weight DiffuseWeights[3];
+    fixed16_weight SpecularWeights[3];
+    DiffuseWeights[0] = InitFixed16Weight(Material->DiffuseColor.X * LightColor.X * Material->DiffuseIntensity);
+    DiffuseWeights[1] = InitFixed16Weight(Material->DiffuseColor.Y * LightColor.Y * Material->DiffuseIntensity);
+    DiffuseWeights[2] = InitFixed16Weight(Material->DiffuseColor.Z * LightColor.Z * Material->DiffuseIntensity);
+    SpecularWeights[0] = InitFixed16Weight(Material->SpecularColor.X * LightColor.X * Material->SpecularIntensity);
+    SpecularWeights[1] = InitFixed16Weight(Material->SpecularColor.Y * LightColor.Y * Material->SpecularIntensity);
+    SpecularWeights[2] = InitFixed16Weight(Material->SpecularColor.Z * LightColor.Z * Material->SpecularIntensity);
+    
+    lane_v3_i16 N[3];
+    lane_v3_i16 L[3];
+    lane_v3_i16 H[3];
+    lane_v3_i16 Ambient[3];
+    for(int32_t Vertex = 0; Vertex < 3; ++Vertex)
+    {
+        vector3 Position = ConvertHalfV3(Positions[IndexOffset + Vertex]);
+        vector3 Normal = ConvertHalfV3(Normals[IndexOffset + Vertex]);
+        float InvNormalLength = 1.0f / sqrtf(Normal.X * Normal.X + Normal.Y * Normal.Y + Normal.Z * Normal.Z);
+        lane_v3 Irradiance = EvaluateProbe(Thread->Lights.Probe, InitLaneV3(Normal.X * InvNormalLength,
+                                                                            Normal.Y * InvNormalLength,
+                                                                            Normal.Z * InvNormalLength));
+        float AmbientRed = MIN(Material->AmbientColor.X * GetLane(Irradiance.X, 0), 1.0f);
+        float AmbientGreen = MIN(Material->AmbientColor.Y * GetLane(Irradiance.Y, 0), 1.0f);
+        float AmbientBlue = MIN(Material->AmbientColor.Z * GetLane(Irradiance.Z, 0), 1.0f);
+        Ambient[Vertex] = InitLaneV3I16((int16_t)(AmbientRed * (float)Q15_MAX),
+                                        (int16_t)(AmbientGreen * (float)Q15_MAX),
+                                        (int16_t)(AmbientBlue * (float)Q15_MAX));
+        
+        float LightX = LightPos.X - Position.X;
+        float LightY = LightPos.Y - Position.Y;
+        float LightZ = LightPos.Z - Position.Z;
+        float InvLightLength = 1.0f / sqrtf(LightX * LightX + LightY * LightY + LightZ * LightZ);
+        float InvCamLength = 1.0f / sqrtf(Position.X * Position.X + Position.Y * Position.Y + Position.Z * Position.Z);
+        
+        N[Vertex] = InitLaneV3Q14(Normal.X, Normal.Y, Normal.Z);
+        L[Vertex] = InitLaneV3Q14(LightX, LightY, LightZ);
+        H[Vertex] = InitLaneV3Q14(LightX * InvLightLength - Position.X * InvCamLength,
+                                  LightY * InvLightLength - Position.Y * InvCamLength,
+                                  LightZ * InvLightLength - Position.Z * InvCamLength);
+    }
+    
+    lane_f32 InvAreaVec = InitLaneF32(InvArea);
+    lane_i16 Zero = InitLaneI16(0);
+    lane_i16 DotMax = InitLaneI16((1 << 13) - 1);
+    int32_t PitchInPixels = Buffer->Pitch / (int32_t)sizeof(uint32_t);
+    
+    for (int32_t j = StartHeight; j <= EndHeight; j += 4) 
+    { 
+        lane_i32 W0 = W0Row;
+        lane_i32 W1 = W1Row;
+        lane_i32 W2 = W2Row;
+        for (int32_t i = StartWidth; i <= EndWidth; i += 4) 
+        {
+            lane_i32 LowerW0 = W0 + E12.OneStepY;
+            lane_i32 LowerW1 = W1 + E20.OneStepY;
+            lane_i32 LowerW2 = W2 + E01.OneStepY;
+            lane_mask UpperMask = LaneZeroI32 < (W0 | W1 | W2);
+            lane_mask LowerMask = LaneZeroI32 < (LowerW0 | LowerW1 | LowerW2);
+            if (!IsAllZeros(UpperMask | LowerMask)) 
+            {
+                int32_t SetLanes = CountSetLanes(UpperMask) + CountSetLanes(LowerMask);
+                Thread->FragmentsCount += SetLanes;
+                
+                // NOTE: Lanes outside the triangle saturate harmlessly and are never stored
+                lane_i16 B0 = BarycentricQ15(W0, LowerW0, E12.OriginCorrection, InvAreaVec);
+                lane_i16 B1 = BarycentricQ15(W1, LowerW1, E20.OriginCorrection, InvAreaVec);
+                lane_i16 B2 = BarycentricQ15(W2, LowerW2, E01.OriginCorrection, InvAreaVec);
+                
+                lane_v3_i16 Normal = MultiplyFixed(N[0], B0) + MultiplyFixed(N[1], B1) + MultiplyFixed(N[2], B2);
+                lane_v3_i16 LightDir = MultiplyFixed(L[0], B0) + MultiplyFixed(L[1], B1) + MultiplyFixed(L[2], B2);
+                lane_v3_i16 HalfAngles = MultiplyFixed(H[0], B0) + MultiplyFixed(H[1], B1) + MultiplyFixed(H[2], B2);
+                Normal = RenormalizeFixed(Normal);
+                LightDir = RenormalizeFixed(LightDir);
+                HalfAngles = RenormalizeFixed(HalfAngles);
+                
+                // Q13 dot products to Q15 in [0, 1)
+                lane_i16 NdotL = Clamp(DotProductFixed(Normal, LightDir), Zero, DotMax) << 2;
+                lane_i16 NdotH = Clamp(DotProductFixed(Normal, HalfAngles), Zero, DotMax) << 2;
+                
+                lane_i16 SpecularHighlight = NdotH;
+                for(int32_t Square = 0; Square < 5; ++Square)
+                {
+                    SpecularHighlight = MultiplyFixed(SpecularHighlight, SpecularHighlight);
+                }
+                
+                // NOTE: Lanes outside the triangle can go negative, that would gather outside the
+                // table. The saturating sums clamp the channels to 1
+                lane_v3_i16 AmbientTerm = MultiplyFixed(Ambient[0], B0) + MultiplyFixed(Ambient[1], B1) + MultiplyFixed(Ambient[2], B2);
+                lane_i16 Red = (Max(AmbientTerm.X, Zero) + ApplyFixed16Weight(NdotL, &DiffuseWeights[0]) +
+                                ApplyFixed16Weight(SpecularHighlight, &SpecularWeights[0]));
+                lane_i16 Green = (Max(AmbientTerm.Y, Zero) + ApplyFixed16Weight(NdotL, &DiffuseWeights[1]) +
+                                  ApplyFixed16Weight(SpecularHighlight, &SpecularWeights[1]));
+                lane_i16 Blue = (Max(AmbientTerm.Z, Zero) + ApplyFixed16Weight(NdotL, &DiffuseWeights[2]) +
+                                 ApplyFixed16Weight(SpecularHighlight, &SpecularWeights[2]));
+                
+                lane_i32 LowerRed, LowerGreen, LowerBlue;
+                lane_i32 UpperRed = LookupChannelSRGB8(Red, Zero, 16, &LowerRed);
+                lane_i32 UpperGreen = LookupChannelSRGB8(Green, Zero, 8, &LowerGreen);
+                lane_i32 UpperBlue = LookupChannelSRGB8(Blue, Zero, 0, &LowerBlue);
+                lane_i32 UpperColor = UpperRed | UpperGreen | UpperBlue;
+                lane_i32 LowerColor = LowerRed | LowerGreen | LowerBlue;
+                
+                uint32_t* BlockPixels = (uint32_t*)((uint8_t*)Buffer->Memory + (j - Buffer->OriginY) * Buffer->Pitch) + (i - Buffer->OriginX);
+                ConditionalStoreBlock<4, 2>(BlockPixels, PitchInPixels, UpperColor, UpperMask);
+                ConditionalStoreBlock<4, 2>(BlockPixels + 2 * PitchInPixels, PitchInPixels, LowerColor, LowerMask);
+#if SABLUJO_INTERNAL
+                Thread->Stats.PixelsComputed += 16;
+                Thread->Stats.PixelsWasted += 16 - SetLanes;
+#endif
+            }
+#if SABLUJO_INTERNAL
+            else
+            {
+                Thread->Stats.PixelsSkipped += 16;
+            }
+#endif
+            W0 += E12.OneStepX;
+            W1 += E20.OneStepX;
+            W2 += E01.OneStepX;       
+        }
+        
+        // Two square rows per block
+        W0Row += E12.OneStepY + E12.OneStepY;
+        W1Row += E20.OneStepY + E20.OneStepY;
+        W2Row += E01.OneStepY + E01.OneStepY;
+    }
+}
+#endif
+
+void
+GetRasterKernels(raster_kernels* Kernels)
+{
+#if LANE_WIDTH == 16
+    Kernels->Tier = RasterTier_AVX512;
+    Kernels->Name = "AVX-512";
+#elif LANE_WIDTH == 8
+    Kernels->Tier = RasterTier_AVX2;
+    Kernels->Name = "AVX2";
+#elif LANE_WIDTH == 4
+    Kernels->Tier = RasterTier_SSE4;
+    Kernels->Name = "SSE4.1";
+#else
+    Kernels->Tier = RasterTier_Scalar;
+    Kernels->Name = "Scalar";
+#endif
+#if defined(LANE_GENERIC)
+    Kernels->Name = "Generic";
+#endif
+    Kernels->BlockShapeSizes[BlockShape_Wide][0] = block_shape_wide::StepXSize;
+    Kernels->BlockShapeSizes[BlockShape_Wide][1] = block_shape_wide::StepYSize;
+    Kernels->BlockShapeSizes[BlockShape_Square][0] = block_shape_square::StepXSize;
+    Kernels->BlockShapeSizes[BlockShape_Square][1] = block_shape_square::StepYSize;
+    Kernels->BlockShapeSizes[BlockShape_Tall][0] = block_shape_tall::StepXSize;
+    Kernels->BlockShapeSizes[BlockShape_Tall][1] = block_shape_tall::StepYSize;
+    Kernels->RasterizeTriangle = RasterizeTriangle;
+    Kernels->RasterizeTriangleShaded = RasterizeTriangleShaded;
+    Kernels->LightVertices = LightVertices;
+    Kernels->PackHalves = PackHalves;
+#if LANE_WIDTH >= 4
+    Kernels->RasterizeTriangleCoarse = RasterizeTriangleCoarse;
+#else
+    Kernels->RasterizeTriangleCoarse = 0;
+#endif
+    Kernels->RasterizeVisibility = RasterizeVisibility;
+    Kernels->RasterizeDepth = RasterizeDepth;
+    Kernels->ShadeVisibility = ShadeVisibility;
+    Kernels->ShadeCheckerboard = ShadeCheckerboard;
+    Kernels->RasterizeGBuffer = RasterizeGBuffer;
+    Kernels->ShadeGBuffer = ShadeGBuffer;
+#if LANE_FIXED16
+    InitSRGB8Table();
+    Kernels->RasterizeTriangleFixed16 = RasterizeTriangleFixed16;
+#else
+    Kernels->RasterizeTriangleFixed16 = 0;
+#endif
+}
+
+} // namespace LANE_NAMESPACE
@@ -0,0 +1,2527 @@
+#include "sablujo_render.h"
+
+internal void 
+ClearRegion(game_offscreen_buffer* Buffer, 
+            int32_t StartWidth, int32_t StartHeight,
+            int32_t EndWidth, int32_t EndHeight)
+{
+    uint8_t* Row = (uint8_t*)Buffer->Memory + (StartHeight - Buffer->OriginY) * Buffer->Pitch;
+    for(int32_t Y = StartHeight; Y <= EndHeight; ++Y)
+    {
+        uint32_t* Pixel = (uint32_t*)Row + (StartWidth - Buffer->OriginX);
+        uint32_t* EndPointer = (uint32_t*)Row + (EndWidth - Buffer->OriginX) + 1;
+        while(Pixel != EndPointer)
+        {
+            *Pixel++ = 0;
+        }
+        Row += Buffer->Pitch;
+    }
+}
+
+// NOTE: Half precision halves the attribute streams written here, copied by the culled
+// triangles compaction and read back by every raster job. The conversion is a raster kernel,
+// F16C is only enabled in the translation units of the tiers that have it.
+internal void 
+VertexStage(memory_arena* Arena, game_state* GameState, raster_kernels* Kernels, camera* Camera, mesh* Mesh,
+            int32_t ScreenWidth, int32_t ScreenHeight,
+            vector2i* OutputVertices, vector3h* OutputPositions, vector3h* OutputNormals,
+            float* OutputDepths, vector3* OutputTexCoords)
+{
+    temporary_memory TempMemory = BeginTemporaryMemory(Arena);
+    vector3* Positions = PushArray(Arena, Mesh->IndicesCount, vector3);
+    vector3* Normals = PushArray(Arena, Mesh->IndicesCount, vector3);
+    for (uint32_t j = 0; j < Mesh->IndicesCount; j++) 
+    {
+        Assert(Mesh->Indices[j] < Mesh->VerticesCount);
+        vector4 Vertex = vector4(Mesh->Vertices[Mesh->Indices[j]], 1.0f);
+        vector4 ModelVertex       = MultPointMatrix(&Mesh->Transform, &Vertex);
+        vector4 CameraSpaceVertex = MultPointMatrix(&Camera->View, &ModelVertex);
+        vector4 ProjectedVertex   = MultVecMatrix(&Camera->Projection, &CameraSpaceVertex);
+        
+        vector3 TransformedNormal = MultPointMatrix(&Mesh->InverseTransform, &Mesh->Normals[Mesh->Indices[j]]);
+        
+        // convert to raster space and mark the position of the vertex in the image with a simple dot
+        int32_t x = MIN(ScreenWidth - 1, (int32_t)((ProjectedVertex.X + 1) * 0.5f * ScreenWidth));
+        int32_t y = MIN(ScreenHeight - 1, (int32_t)((1 - (ProjectedVertex.Y + 1) * 0.5f) * ScreenHeight));
+        
+        OutputVertices[j]  = {x, y};
+        // NOTE: The padding lanes are never read back, W goes along with the position
+        Positions[j].vec = ModelVertex.vec;
+        Normals[j]       = TransformedNormal;
+        // NOTE: The camera looks down +Z, the inverse depth interpolates linearly on screen
+        // and grows towards the camera. Vertices behind it get 0 and never pass the test.
+        float InvDepth = CameraSpaceVertex.Z > 0.0f ? 1.0f / CameraSpaceVertex.Z : 0.0f;
+        if(OutputDepths)
+        {
+            OutputDepths[j] = InvDepth;
+        }
+        if(OutputTexCoords)
+        {
+            vector2 TexCoord = Mesh->TexCoords[Mesh->Indices[j]];
+            OutputTexCoords[j] = {TexCoord.X * InvDepth, TexCoord.Y * InvDepth, InvDepth};
+        }
+#if SABLUJO_INTERNAL
+        ++GameState->RenderStats.VerticesCount;
+#endif
+    }
+    
+    Kernels->PackHalves(Positions, OutputPositions, Mesh->IndicesCount);
+    Kernels->PackHalves(Normals, OutputNormals, Mesh->IndicesCount);
+    EndTemporaryMemory(TempMemory);
+}
+
+// NOTE: Every vertex is lit once however many triangles share it, in lanes over the unique
+// vertices, then the colors are expanded to the triangle corners like the other attributes
+internal void
+LightMeshVertices(memory_arena* Arena, raster_kernels* Kernels, mesh* Mesh, material* Material,
+                  light_list* Lights, vector3h* OutputColors)
+{
+    temporary_memory TempMemory = BeginTemporaryMemory(Arena);
+    
+    // NOTE: Padded to the widest tier with copies of the last vertex
+    uint32_t PaddedCount = (Mesh->VerticesCount + 15) & ~15u;
+    vector3* Positions = PushArray(Arena, PaddedCount, vector3);
+    vector3* Normals = PushArray(Arena, PaddedCount, vector3);
+    uint16_t* ColorsX = PushArray(Arena, PaddedCount, uint16_t);
+    uint16_t* ColorsY = PushArray(Arena, PaddedCount, uint16_t);
+    uint16_t* ColorsZ = PushArray(Arena, PaddedCount, uint16_t);
+    for(uint32_t i = 0; i < PaddedCount; ++i)
+    {
+        uint32_t VertexIndex = MIN(i, Mesh->VerticesCount - 1);
+        vector4 Vertex = vector4(Mesh->Vertices[VertexIndex], 1.0f);
+        Positions[i].vec = MultPointMatrix(&Mesh->Transform, &Vertex).vec;
+        Normals[i] = MultPointMatrix(&Mesh->InverseTransform, &Mesh->Normals[VertexIndex]);
+    }
+    
+    Kernels->LightVertices(Positions, Normals, PaddedCount, Material, Lights, ColorsX, ColorsY, ColorsZ);
+    
+    for(uint32_t j = 0; j < Mesh->IndicesCount; ++j)
+    {
+        uint32_t VertexIndex = Mesh->Indices[j];
+        OutputColors[j].X = ColorsX[VertexIndex];
+        OutputColors[j].Y = ColorsY[VertexIndex];
+        OutputColors[j].Z = ColorsZ[VertexIndex];
+        OutputColors[j].Padding = 0;
+    }
+    
+    EndTemporaryMemory(TempMemory);
+}
+
+inline float srgb_to_linear(float x) 
+{
+    return (x <= 0.04045f) ? x / 12.92f : powf((x + 0.055f) / 1.055f, 2.4f);
+}
+
+/////////////////////////
+// Textures
+/////////////////////////
+
+// NOTE: Spreads the low 16 bits over the even bits
+internal uint32_t
+SpreadBits(uint32_t Value)
+{
+    Value &= 0xFFFF;
+    Value = (Value | (Value << 8)) & 0x00FF00FF;
+    Value = (Value | (Value << 4)) & 0x0F0F0F0F;
+    Value = (Value | (Value << 2)) & 0x33333333;
+    Value = (Value | (Value << 1)) & 0x55555555;
+    return Value;
+}
+
+uint32_t
+GetTextureTexelCount(uint32_t LogSize)
+{
+    // NOTE: The chain is addressed with 32 bits, see SampleTexture
+    Assert(LogSize <= 14);
+    uint32_t Size = 1u << LogSize;
+    return (4 * Size * Size - 1) / 3;
+}
+
+uint32_t*
+GetTextureTexel(texture* Texture, uint32_t Level, uint32_t X, uint32_t Y)
+{
+    Assert(Level <= Texture->LogSize);
+    uint32_t Size = 1u << (Texture->LogSize - Level);
+    Assert(X < Size && Y < Size);
+    uint32_t LevelOffset = (Size * Size - 1) / 3;
+    return Texture->Texels + LevelOffset + (SpreadBits(X) | (SpreadBits(Y) << 1));
+}
+
+// NOTE: Exact inverse of srgb_to_linear, LinearToSRGB leaves the offset out like the output
+// merger does and would brighten every level a little more
+internal uint32_t
+EncodeTexelChannel(float Linear)
+{
+    float Encoded = (Linear <= 0.0031308f) ? Linear * 12.92f : 1.055f * powf(Linear, 1.0f / 2.4f) - 0.055f;
+    return (uint32_t)(MIN(Encoded, 1.0f) * 255.0f + 0.5f);
+}
+
+void
+BuildTextureMips(texture* Texture)
+{
+    for(uint32_t Level = 1; Level <= Texture->LogSize; ++Level)
+    {
+        uint32_t Size = 1u << (Texture->LogSize - Level);
+        for(uint32_t Y = 0; Y < Size; ++Y)
+        {
+            for(uint32_t X = 0; X < Size; ++X)
+            {
+                float Red = 0.0f;
+                float Green = 0.0f;
+                float Blue = 0.0f;
+                uint32_t Alpha = 0;
+                for(uint32_t Corner = 0; Corner < 4; ++Corner)
+                {
+                    uint32_t Texel = *GetTextureTexel(Texture, Level - 1, 2 * X + (Corner & 1), 2 * Y + (Corner >> 1));
+                    Red += srgb_to_linear((float)((Texel >> 16) & 0xFF) / 255.0f);
+                    Green += srgb_to_linear((float)((Texel >> 8) & 0xFF) / 255.0f);
+                    Blue += srgb_to_linear((float)(Texel & 0xFF) / 255.0f);
+                    Alpha += Texel >> 24;
+                }
+                *GetTextureTexel(Texture, Level, X, Y) = (((Alpha + 2) / 4) << 24 |
+                                                          EncodeTexelChannel(0.25f * Red) << 16 |
+                                                          EncodeTexelChannel(0.25f * Green) << 8 |
+                                                          EncodeTexelChannel(0.25f * Blue));
+            }
+        }
+    }
+}
+
+internal uint32_t
+PackColor565(uint32_t Red, uint32_t Green, uint32_t Blue)
+{
+    return ((Red * 31 + 127) / 255) << 11 | ((Green * 63 + 127) / 255) << 5 | ((Blue * 31 + 127) / 255);
+}
+
+// NOTE: Same bit replication as the decoder in SampleTexture
+internal void
+UnpackColor565(uint32_t Color, uint32_t* Channels)
+{
+    uint32_t Red = (Color >> 11) & 31;
+    uint32_t Green = (Color >> 5) & 63;
+    uint32_t Blue = Color & 31;
+    Channels[0] = (Red << 3) | (Red >> 2);
+    Channels[1] = (Green << 2) | (Green >> 4);
+    Channels[2] = (Blue << 3) | (Blue >> 2);
+}
+
+internal uint32_t
+GetChannel(uint32_t Texel, uint32_t Channel)
+{
+    return (Texel >> (16 - 8 * Channel)) & 0xFF;
+}
+
+// NOTE: Endpoints on the corners of the bounding box of the block colors, always in four color
+// mode. Good enough for flat and two tone blocks, a least squares fit would be the next step.
+internal void
+EncodeBC1(uint32_t* Texels, uint8_t* Block)
+{
+    uint32_t Low[3] = { 255, 255, 255 };
+    uint32_t High[3] = { 0, 0, 0 };
+    for(uint32_t Index = 0; Index < 16; ++Index)
+    {
+        for(uint32_t Channel = 0; Channel < 3; ++Channel)
+        {
+            Low[Channel] = MIN(Low[Channel], GetChannel(Texels[Index], Channel));
+            High[Channel] = MAX(High[Channel], GetChannel(Texels[Index], Channel));
+        }
+    }
+    
+    uint32_t Color0 = PackColor565(High[0], High[1], High[2]);
+    uint32_t Color1 = PackColor565(Low[0], Low[1], Low[2]);
+    uint32_t Indices = 0;
+    if(Color0 != Color1)
+    {
+        if(Color0 < Color1)
+        {
+            uint32_t Swap = Color0;
+            Color0 = Color1;
+            Color1 = Swap;
+        }
+        
+        uint32_t Endpoints[2][3];
+        UnpackColor565(Color0, Endpoints[0]);
+        UnpackColor565(Color1, Endpoints[1]);
+        uint32_t Palette[4][3];
+        for(uint32_t Channel = 0; Channel < 3; ++Channel)
+        {
+            Palette[0][Channel] = Endpoints[0][Channel];
+            Palette[1][Channel] = Endpoints[1][Channel];
+            Palette[2][Channel] = (2 * Endpoints[0][Channel] + Endpoints[1][Channel] + 1) / 3;
+            Palette[3][Channel] = (Endpoints[0][Channel] + 2 * Endpoints[1][Channel] + 1) / 3;
+        }
+        
+        for(uint32_t Index = 0; Index < 16; ++Index)
+        {
+            uint32_t BestEntry = 0;
+            int32_t BestDistance = INT32_MAX;
+            for(uint32_t Entry = 0; Entry < 4; ++Entry)
+            {
+                int32_t Distance = 0;
+                for(uint32_t Channel = 0; Channel < 3; ++Channel)
+                {
+                    int32_t Delta = (int32_t)GetChannel(Texels[Index], Channel) - (int32_t)Palette[Entry][Channel];
+                    Distance += Delta * Delta;
+                }
+                if(Distance < BestDistance)
+                {
+                    BestDistance = Distance;
+                    BestEntry = Entry;
+                }
+            }
+            Indices |= BestEntry << (2 * Index);
+        }
+    }
+    
+    Block[0] = (uint8_t)Color0;
+    Block[1] = (uint8_t)(Color0 >> 8);
+    Block[2] = (uint8_t)Color1;
+    Block[3] = (uint8_t)(Color1 >> 8);
+    for(uint32_t Byte = 0; Byte < 4; ++Byte)
+    {
+        Block[4 + Byte] = (uint8_t)(Indices >> (8 * Byte));
+    }
+}
+
+// NOTE: Always the eight value mode, its palette spans exactly the range of the block
+internal void
+EncodeBC4Channel(uint32_t* Texels, uint32_t Channel, uint8_t* Block)
+{
+    uint32_t Low = 255;
+    uint32_t High = 0;
+    for(uint32_t Index = 0; Index < 16; ++Index)
+    {
+        Low = MIN(Low, GetChannel(Texels[Index], Channel));
+        High = MAX(High, GetChannel(Texels[Index], Channel));
+    }
+    
+    uint64_t Indices = 0;
+    if(High > Low)
+    {
+        for(uint32_t Index = 0; Index < 16; ++Index)
+        {
+            // NOTE: Nearest of the 7 steps from High to Low, then in palette order where the
+            // endpoints come first
+            uint32_t Step = (7 * (High - GetChannel(Texels[Index], Channel)) + (High - Low) / 2) / (High - Low);
+            uint64_t Entry = (Step == 0) ? 0 : (Step == 7) ? 1 : Step + 1;
+            Indices |= Entry << (3 * Index);
+        }
+    }
+    
+    Block[0] = (uint8_t)High;
+    Block[1] = (uint8_t)Low;
+    for(uint32_t Byte = 0; Byte < 6; ++Byte)
+    {
+        Block[2 + Byte] = (uint8_t)(Indices >> (8 * Byte));
+    }
+}
+
+internal uint32_t
+GetTextureBlockBytes(texture_format Format)
+{
+    return Format == TextureFormat_BC5 ? 16 : 8;
+}
+
+uint32_t
+GetCompressedTextureSize(texture_format Format, uint32_t LogSize)
+{
+    uint32_t BlocksCount = 0;
+    for(uint32_t Level = 0; Level <= LogSize; ++Level)
+    {
+        uint32_t BlocksPerSide = MAX((1u << (LogSize - Level)) / 4, 1u);
+        BlocksCount += BlocksPerSide * BlocksPerSide;
+    }
+    return BlocksCount * GetTextureBlockBytes(Format);
+}
+
+void
+CompressTexture(texture* Source, texture_format Format, uint8_t* Blocks, texture* Dest)
+{
+    Assert(Source->Format == TextureFormat_RGBA8 && Format != TextureFormat_RGBA8);
+    *Dest = {};
+    Dest->Format = Format;
+    Dest->LogSize = Source->LogSize;
+    Dest->Blocks = Blocks;
+    
+    // NOTE: Smallest level first like the texels, the levels under 4x4 still take a block
+    uint32_t BlocksCount = 0;
+    for(uint32_t Level = Source->LogSize + 1; Level-- > 0;)
+    {
+        Dest->BlockLevelOffsets[Level] = BlocksCount;
+        uint32_t BlocksPerSide = MAX((1u << (Source->LogSize - Level)) / 4, 1u);
+        BlocksCount += BlocksPerSide * BlocksPerSide;
+    }
+    
+    uint32_t BlockBytes = GetTextureBlockBytes(Format);
+    for(uint32_t Level = 0; Level <= Source->LogSize; ++Level)
+    {
+        uint32_t SizeMask = (1u << (Source->LogSize - Level)) - 1;
+        uint32_t BlocksPerSide = (SizeMask + 1 + 3) / 4;
+        for(uint32_t BlockY = 0; BlockY < BlocksPerSide; ++BlockY)
+        {
+            for(uint32_t BlockX = 0; BlockX < BlocksPerSide; ++BlockX)
+            {
+                // NOTE: Blocks are in Morton order too, a level narrower than a block repeats
+                // across it the way the sampler wraps
+                uint32_t Texels[16];
+                for(uint32_t Index = 0; Index < 16; ++Index)
+                {
+                    uint32_t X = (4 * BlockX + (Index & 3)) & SizeMask;
+                    uint32_t Y = (4 * BlockY + (Index >> 2)) & SizeMask;
+                    Texels[Index] = *GetTextureTexel(Source, Level, X, Y);
+                }
+                
+                uint32_t BlockIndex = Dest->BlockLevelOffsets[Level] + (SpreadBits(BlockX) | (SpreadBits(BlockY) << 1));
+                uint8_t* Block = Blocks + BlockIndex * BlockBytes;
+                switch(Format)
+                {
+                    case TextureFormat_BC1:
+                    {
+                        EncodeBC1(Texels, Block);
+                    } break;
+                    
+                    case TextureFormat_BC4:
+                    {
+                        EncodeBC4Channel(Texels, 1, Block);
+                    } break;
+                    
+                    case TextureFormat_BC5:
+                    {
+                        EncodeBC4Channel(Texels, 0, Block);
+                        EncodeBC4Channel(Texels, 1, Block + 8);
+                    } break;
+                    
+                    default:
+                    {
+                        Assert(!"Not a block compressed format");
+                    } break;
+                }
+            }
+        }
+    }
+}
+
+internal int64_t 
+EdgeFunction(vector2i A, vector2i B, vector2i C)
+{
+    return (int64_t)(B.X - A.X) * (C.Y - A.Y) - (int64_t)(B.Y - A.Y) * (C.X - A.X);
+}
+
+internal uint32_t
+GetAspectBucket(int32_t Width, int32_t Height)
+{
+    float Aspect = (float)Width / (float)Height;
+    int32_t Bucket = (int32_t)floorf(2.0f * Log2(Aspect) + 0.5f) + BLOCK_SHAPE_ASPECT_BUCKET_COUNT / 2;
+    Bucket = MAX(0, MIN(BLOCK_SHAPE_ASPECT_BUCKET_COUNT - 1, Bucket));
+    return (uint32_t)Bucket;
+}
+
+internal float
+GetAspectBucketBound(int32_t Bucket, float HalfBucketOffset)
+{
+    return Exp2(((float)(Bucket - BLOCK_SHAPE_ASPECT_BUCKET_COUNT / 2) + HalfBucketOffset) * 0.5f);
+}
+
+internal block_shape_type
+SelectBlockShape(block_shape_thresholds* Thresholds, int32_t Width, int32_t Height)
+{
+    block_shape_type Result = BlockShape_Square;
+    float Aspect = (float)Width / (float)Height;
+    if(Aspect >= Thresholds->WideAspect)
+    {
+        Result = BlockShape_Wide;
+    }
+    else if(Aspect <= Thresholds->TallAspect)
+    {
+        Result = BlockShape_Tall;
+    }
+    return Result;
+}
+
+void
+InitializeBlockShapeThresholds(block_shape_thresholds* Thresholds)
+{
+    // NOTE: Safe defaults until calibration measured the current machine
+    Thresholds->WideAspect = 2.0f;
+    Thresholds->TallAspect = 0.5f;
+    Thresholds->IsCalibrated = false;
+}
+
+// NOTE: Buckets with fewer triangles than this are considered noise
+#define BLOCK_SHAPE_CALIBRATION_MIN_TRIANGLES 16
+
+internal void
+UpdateBlockShapeThresholds(block_shape_calibration* Calibration, block_shape_thresholds* Thresholds)
+{
+    int32_t SquareBucket = BLOCK_SHAPE_ASPECT_BUCKET_COUNT / 2;
+    
+    // NOTE: Start with both elongated shapes off so a shape that loses in its outermost
+    // measured bucket stays off, even if an earlier calibration had turned it on
+    Thresholds->WideAspect = INFINITY;
+    Thresholds->TallAspect = 0.0f;
+    
+    // Walk inward from the widest bucket while the wide shape keeps beating the square one
+    for(int32_t Bucket = BLOCK_SHAPE_ASPECT_BUCKET_COUNT - 1; Bucket > SquareBucket; --Bucket)
+    {
+        if(Calibration->TrianglesCount[Bucket] < BLOCK_SHAPE_CALIBRATION_MIN_TRIANGLES)
+        {
+            continue;
+        }
+        if(Calibration->Cycles[BlockShape_Wide][Bucket] >= Calibration->Cycles[BlockShape_Square][Bucket])
+        {
+            break;
+        }
+        Thresholds->WideAspect = GetAspectBucketBound(Bucket, -0.5f);
+    }
+    
+    // Same thing on the tall side
+    for(int32_t Bucket = 0; Bucket < SquareBucket; ++Bucket)
+    {
+        if(Calibration->TrianglesCount[Bucket] < BLOCK_SHAPE_CALIBRATION_MIN_TRIANGLES)
+        {
+            continue;
+        }
+        if(Calibration->Cycles[BlockShape_Tall][Bucket] >= Calibration->Cycles[BlockShape_Square][Bucket])
+        {
+            break;
+        }
+        Thresholds->TallAspect = GetAspectBucketBound(Bucket, 0.5f);
+    }
+    Thresholds->IsCalibrated = true;
+}
+
+#if SABLUJO_INTERNAL
+internal void
+PrintBlockShapeCalibration(game_memory* Memory, raster_kernels* Kernels,
+                           block_shape_calibration* Calibration, 
+                           block_shape_thresholds* Thresholds)
+{
+    int32_t (*BlockShapeSizes)[2] = Kernels->BlockShapeSizes;
+    char Line[256];
+    Memory->Platform.DEBUGFormatString(Line, sizeof(Line),
+                                       "Block shape calibration (cycles/wasted pixels per triangle: %dx%d | %dx%d | %dx%d)\n",
+                                       BlockShapeSizes[BlockShape_Wide][0], BlockShapeSizes[BlockShape_Wide][1],
+                                       BlockShapeSizes[BlockShape_Square][0], BlockShapeSizes[BlockShape_Square][1],
+                                       BlockShapeSizes[BlockShape_Tall][0], BlockShapeSizes[BlockShape_Tall][1]);
+    Memory->Platform.DEBUGPrintLine(Line);
+    for(int32_t Bucket = 0; Bucket < BLOCK_SHAPE_ASPECT_BUCKET_COUNT; ++Bucket)
+    {
+        uint32_t Count = Calibration->TrianglesCount[Bucket];
+        if(Count)
+        {
+            Memory->Platform.DEBUGFormatString(Line, sizeof(Line),
+                                               "Aspect %7.3f (%5d tris): %8.0f/%6.1f | %8.0f/%6.1f | %8.0f/%6.1f\n",
+                                               GetAspectBucketBound(Bucket, 0.0f), Count,
+                                               (double)Calibration->Cycles[BlockShape_Wide][Bucket] / Count,
+                                               (double)Calibration->PixelsWasted[BlockShape_Wide][Bucket] / Count,
+                                               (double)Calibration->Cycles[BlockShape_Square][Bucket] / Count,
+                                               (double)Calibration->PixelsWasted[BlockShape_Square][Bucket] / Count,
+                                               (double)Calibration->Cycles[BlockShape_Tall][Bucket] / Count,
+                                               (double)Calibration->PixelsWasted[BlockShape_Tall][Bucket] / Count);
+            Memory->Platform.DEBUGPrintLine(Line);
+        }
+    }
+    Memory->Platform.DEBUGFormatString(Line, sizeof(Line),
+                                       "Selection thresholds: wide >= %.3f, tall <= %.3f\n",
+                                       Thresholds->WideAspect, Thresholds->TallAspect);
+    Memory->Platform.DEBUGPrintLine(Line);
+}
+#endif
+
+/////////////////////////
+// Kernel dispatch
+/////////////////////////
+
+// NOTE: Library globals are reset by a reload, the tier is detected again after it
+global_variable raster_kernels RasterKernels[RasterTier_Count];
+global_variable raster_kernels* SelectedRasterKernels;
+
+internal raster_tier
+DetectRasterTier(void)
+{
+    int32_t Info[4];
+    GetCPUID(0, 0, Info);
+    int32_t MaxLeaf = Info[0];
+    
+    GetCPUID(1, 0, Info);
+    bool HasSSE41 = (Info[2] & (1 << 19)) != 0;
+    bool HasFMA = (Info[2] & (1 << 12)) != 0;
+    bool HasOSXSAVE = (Info[2] & (1 << 27)) != 0;
+    bool HasAVX = (Info[2] & (1 << 28)) != 0;
+    bool HasF16C = (Info[2] & (1 << 29)) != 0;
+    
+    bool HasAVX2 = false;
+    bool HasAVX512F = false;
+    if(MaxLeaf >= 7)
+    {
+        GetCPUID(7, 0, Info);
+        HasAVX2 = (Info[1] & (1 << 5)) != 0;
+        HasAVX512F = (Info[1] & (1 << 16)) != 0;
+    }
+    
+    // NOTE: The OS must also save the upper halves of the YMM registers on context switches,
+    // and the ZMM registers and mask registers for AVX-512
+    uint64_t EnabledStates = HasOSXSAVE ? GetEnabledRegisterStates() : 0;
+    bool HasYMMState = (EnabledStates & 0x6) == 0x6;
+    bool HasZMMState = (EnabledStates & 0xE6) == 0xE6;
+    
+    raster_tier Result = RasterTier_Scalar;
+    if(HasAVX512F && HasZMMState)
+    {
+        Result = RasterTier_AVX512;
+    }
+    else if(HasAVX && HasAVX2 && HasFMA && HasF16C && HasYMMState)
+    {
+        Result = RasterTier_AVX2;
+    }
+    else if(HasSSE41)
+    {
+        Result = RasterTier_SSE4;
+    }
+    return Result;
+}
+
+internal raster_kernels*
+SelectRasterKernels(game_memory* Memory)
+{
+    if(!SelectedRasterKernels)
+    {
+        lane1::GetRasterKernels(RasterKernels + RasterTier_Scalar);
+        lane4::GetRasterKernels(RasterKernels + RasterTier_SSE4);
+        lane8::GetRasterKernels(RasterKernels + RasterTier_AVX2);
+        lane16::GetRasterKernels(RasterKernels + RasterTier_AVX512);
+        // NOTE: Every AVX-512 machine runs AVX2 too
+        RasterKernels[RasterTier_AVX512].RasterizeTriangleFixed16 = RasterKernels[RasterTier_AVX2].RasterizeTriangleFixed16;
+        
+        // NOTE: Forcing a tier the CPU lacks would fault, it only ever lowers the detected one
+        raster_tier Tier = DetectRasterTier();
+        if(Memory->ForcedRasterTier != RasterTier_Auto && Memory->ForcedRasterTier < Tier)
+        {
+            Tier = Memory->ForcedRasterTier;
+        }
+        SelectedRasterKernels = RasterKernels + Tier;
+    }
+    return SelectedRasterKernels;
+}
+
+#define BLOCK_SHAPE_THRESHOLDS_FILE_VERSION 1
+
+// NOTE: The thresholds only hold for the tier that measured them
+struct block_shape_thresholds_file
+{
+    uint32_t Version;
+    uint32_t Tier;
+    float WideAspect;
+    float TallAspect;
+};
+
+void
+LoadBlockShapeThresholds(game_memory* Memory, block_shape_thresholds* Thresholds)
+{
+    InitializeBlockShapeThresholds(Thresholds);
+    
+    block_shape_thresholds_file Contents = {};
+    platform_file_handle File = Memory->Platform.OpenFileForReading(BLOCK_SHAPE_THRESHOLDS_FILE_NAME);
+    Memory->Platform.ReadFileAt(&File, 0, sizeof(Contents), &Contents);
+    Memory->Platform.CloseFile(&File);
+    if(File.NoErrors && Contents.Version == BLOCK_SHAPE_THRESHOLDS_FILE_VERSION &&
+       Contents.Tier == (uint32_t)SelectRasterKernels(Memory)->Tier)
+    {
+        Thresholds->WideAspect = Contents.WideAspect;
+        Thresholds->TallAspect = Contents.TallAspect;
+        Thresholds->IsCalibrated = true;
+    }
+}
+
+internal void
+SaveBlockShapeThresholds(game_memory* Memory, raster_kernels* Kernels, block_shape_thresholds* Thresholds)
+{
+    block_shape_thresholds_file Contents = {};
+    Contents.Version = BLOCK_SHAPE_THRESHOLDS_FILE_VERSION;
+    Contents.Tier = (uint32_t)Kernels->Tier;
+    Contents.WideAspect = Thresholds->WideAspect;
+    Contents.TallAspect = Thresholds->TallAspect;
+    
+    platform_file_handle File = Memory->Platform.OpenFileForWriting(BLOCK_SHAPE_THRESHOLDS_FILE_NAME);
+    Memory->Platform.WriteFileAt(&File, 0, sizeof(Contents), &Contents);
+    Memory->Platform.CloseFile(&File);
+}
+
+/////////////////////////
+// Binning
+/////////////////////////
+
+// NOTE: A distant light of color C towards D adds C Y_lm(D) to the radiance coefficients, the
+// irradiance scales band l by pi, 2pi / 3 and pi / 4. With the squared basis constant of the
+// evaluation folded in the band scales come out as plain fractions.
+internal void
+ProjectAmbientProbe(scene_lights* Lights, sh_probe* Probe)
+{
+    float Scales[SH_COEFFICIENT_COUNT] = 
+    {
+        1.0f / 4.0f,
+        1.0f / 2.0f, 1.0f / 2.0f, 1.0f / 2.0f,
+        15.0f / 16.0f, 15.0f / 16.0f, 5.0f / 64.0f, 15.0f / 16.0f, 15.0f / 64.0f,
+    };
+    
+    *Probe = {};
+    for(uint32_t Light = 0; Light < Lights->DistantCount; ++Light)
+    {
+        float X = Lights->DistantDirectionsX[Light];
+        float Y = Lights->DistantDirectionsY[Light];
+        float Z = Lights->DistantDirectionsZ[Light];
+        float Basis[SH_COEFFICIENT_COUNT] = 
+        {
+            1.0f,
+            Y, Z, X,
+            X * Y, Y * Z, 3.0f * Z * Z - 1.0f, X * Z, X * X - Y * Y,
+        };
+        for(uint32_t Index = 0; Index < SH_COEFFICIENT_COUNT; ++Index)
+        {
+            float Weight = Scales[Index] * Basis[Index];
+            Probe->CoefficientsX[Index] += Weight * Lights->DistantColorsX[Light];
+            Probe->CoefficientsY[Index] += Weight * Lights->DistantColorsY[Light];
+            Probe->CoefficientsZ[Index] += Weight * Lights->DistantColorsZ[Light];
+        }
+    }
+}
+
+render_frame*
+BeginRenderFrame(memory_arena* Arena, game_memory* Memory, game_state* GameState,
+                 camera* Camera, int32_t ImageWidth, int32_t ImageHeight, uint32_t IndicesCount,
+                 bool AllowCalibration)
+{
+    Assert(IndicesCount % 3 == 0);
+    
+    render_frame* Frame = PushStruct(Arena, render_frame);
+    *Frame = {};
+    Frame->ImageWidth = ImageWidth;
+    Frame->ImageHeight = ImageHeight;
+    Frame->Camera = Camera;
+    Frame->Kernels = SelectRasterKernels(Memory);
+    Frame->BlockShapeThresholds = &GameState->BlockShapeThresholds;
+    Frame->RenderMode = Memory->RenderMode;
+    // NOTE: The visibility pass always rasterizes wide blocks, there is nothing to calibrate
+    Frame->IsCalibratingBlockShapes = (AllowCalibration && GameState->BlockShapeCalibration.FramesRemaining > 0 &&
+                                       Frame->RenderMode == RenderMode_Forward);
+    Frame->WorkerCount = Memory->RenderQueue ? MAX(1, MIN(Memory->RenderThreadCount, MAX_RENDER_THREAD_COUNT)) : 1;
+    
+    // Compact the platform cache domains, in order of first appearance
+    uint32_t DomainIds[MAX_RENDER_THREAD_COUNT];
+    for(uint32_t WorkerIndex = 0; WorkerIndex < Frame->WorkerCount; ++WorkerIndex)
+    {
+        uint32_t DomainId = Memory->RenderQueue ? Memory->RenderThreadCacheDomains[WorkerIndex] : 0;
+        uint32_t Domain = 0;
+        while(Domain < Frame->DomainsCount && DomainIds[Domain] != DomainId)
+        {
+            ++Domain;
+        }
+        if(Domain == Frame->DomainsCount)
+        {
+            DomainIds[Frame->DomainsCount++] = DomainId;
+        }
+        Frame->WorkerDomains[WorkerIndex] = Domain;
+        ++Frame->DomainWorkersCount[Domain];
+    }
+    
+    Frame->TrianglesCapacity = IndicesCount / 3;
+    Frame->ScreenPositions = PushArray(Arena, IndicesCount, vector2i);
+    Frame->Positions = PushArray(Arena, IndicesCount, vector3h);
+    Frame->Normals = PushArray(Arena, IndicesCount, vector3h);
+    Frame->TexCoords = PushArray(Arena, IndicesCount, vector3);
+    if(Frame->RenderMode == RenderMode_Forward || Frame->RenderMode == RenderMode_DepthPrepass)
+    {
+        Frame->Colors = PushArray(Arena, IndicesCount, vector3h);
+    }
+    Frame->Triangles = PushArray(Arena, Frame->TrianglesCapacity, raster_triangle);
+    
+    scene_lights* Lights = &GameState->Lights;
+    Assert(Lights->Count <= MAX_SCENE_LIGHT_COUNT);
+    Frame->Lights = Lights;
+    Frame->LightViewX = PushArray(Arena, Lights->Count, float);
+    Frame->LightViewY = PushArray(Arena, Lights->Count, float);
+    Frame->LightViewZ = PushArray(Arena, Lights->Count, float);
+    ProjectAmbientProbe(Lights, &Frame->AmbientProbe);
+    Frame->AllLights.Lights = Lights;
+    Frame->AllLights.Probe = &Frame->AmbientProbe;
+    Frame->AllLights.Count = Lights->Count;
+    for(uint32_t Light = 0; Light < Lights->Count; ++Light)
+    {
+        vector4 Position = vector4(0.0f, 0.0f, 0.0f, 1.0f);
+        Position.X = Lights->PositionsX[Light];
+        Position.Y = Lights->PositionsY[Light];
+        Position.Z = Lights->PositionsZ[Light];
+        vector4 ViewPosition = MultPointMatrix(&Camera->View, &Position);
+        Frame->LightViewX[Light] = ViewPosition.X;
+        Frame->LightViewY[Light] = ViewPosition.Y;
+        Frame->LightViewZ[Light] = ViewPosition.Z;
+        Frame->AllLights.Indices[Light] = (uint16_t)Light;
+    }
+    
+    if(Memory->ShadingRateMode == ShadingRateMode_Auto && Frame->RenderMode == RenderMode_Forward)
+    {
+        shading_rate_history* History = &GameState->ShadingRateHistory;
+        int32_t TileCountX = (ImageWidth + SHADING_RATE_TILE_SIZE - 1) / SHADING_RATE_TILE_SIZE;
+        int32_t TileCountY = (ImageHeight + SHADING_RATE_TILE_SIZE - 1) / SHADING_RATE_TILE_SIZE;
+        if(TileCountX * TileCountY <= MAX_SHADING_RATE_TILE_COUNT)
+        {
+            // Nothing measured yet, start at full rate
+            if(History->TileCountX != TileCountX || History->TileCountY != TileCountY)
+            {
+                History->TileCountX = TileCountX;
+                History->TileCountY = TileCountY;
+                for(int32_t TileIndex = 0; TileIndex < TileCountX * TileCountY; ++TileIndex)
+                {
+                    History->Contrasts[TileIndex] = UINT8_MAX;
+                }
+            }
+            
+            // NOTE: A tile takes the highest contrast around it, detail moving in from a
+            // neighbour since last frame is shaded at the right rate
+            for(int32_t TileY = 0; TileY < TileCountY; ++TileY)
+            {
+                for(int32_t TileX = 0; TileX < TileCountX; ++TileX)
+                {
+                    int32_t Contrast = 0;
+                    for(int32_t Y = MAX(TileY - 1, 0); Y <= MIN(TileY + 1, TileCountY - 1); ++Y)
+                    {
+                        for(int32_t X = MAX(TileX - 1, 0); X <= MIN(TileX + 1, TileCountX - 1); ++X)
+                        {
+                            Contrast = MAX(Contrast, History->Contrasts[Y * TileCountX + X]);
+                        }
+                    }
+                    
+                    shading_rate Rate = ShadingRate_1x1;
+                    if(Contrast <= SHADING_RATE_4X4_MAX_CONTRAST)
+                    {
+                        Rate = ShadingRate_4x4;
+                    }
+                    else if(Contrast <= SHADING_RATE_2X2_MAX_CONTRAST)
+                    {
+                        Rate = ShadingRate_2x2;
+                    }
+                    History->Rates[TileY * TileCountX + TileX] = (uint8_t)Rate;
+                }
+            }
+            Frame->ShadingRates = History->Rates;
+            Frame->ShadingRateCountX = TileCountX;
+            Frame->ShadingRateHistory = History;
+        }
+    }
+    
+    if(Frame->RenderMode != RenderMode_Forward)
+    {
+        Frame->Depths = PushArray(Arena, IndicesCount, float);
+    }
+    if(Frame->RenderMode == RenderMode_VisibilityBuffer || Frame->RenderMode == RenderMode_Checkerboard ||
+       Frame->RenderMode == RenderMode_DepthPrepass)
+    {
+        for(uint32_t WorkerIndex = 0; WorkerIndex < Frame->WorkerCount; ++WorkerIndex)
+        {
+            Frame->ThreadContexts[WorkerIndex].VisibilityTile = (visibility_tile*)PushSize_(Arena, sizeof(visibility_tile), 64);
+        }
+    }
+    for(uint32_t WorkerIndex = 0; WorkerIndex < Frame->WorkerCount; ++WorkerIndex)
+    {
+        // NOTE: The decoded texels are only read behind a matching tag, they can stay garbage
+        texture_cache* Cache = (texture_cache*)PushSize_(Arena, sizeof(texture_cache), 64);
+        for(uint32_t Slot = 0; Slot < TEXTURE_CACHE_SIZE; ++Slot)
+        {
+            Cache->Tags[Slot] = 0;
+            Cache->Stamps[Slot] = 0;
+        }
+        Cache->Stamp = 0;
+#if SABLUJO_INTERNAL
+        Cache->Lookups = 0;
+        Cache->Decodes = 0;
+#endif
+        Frame->ThreadContexts[WorkerIndex].TextureCache = Cache;
+    }
+    return Frame;
+}
+
+void
+SetShadingRateImage(render_frame* Frame, uint8_t* Rates, int32_t TileCountX, int32_t TileCountY)
+{
+    Assert(TileCountX * SHADING_RATE_TILE_SIZE >= Frame->ImageWidth);
+    Assert(TileCountY * SHADING_RATE_TILE_SIZE >= Frame->ImageHeight);
+    Frame->ShadingRates = Rates;
+    Frame->ShadingRateCountX = TileCountX;
+    Frame->ShadingRateHistory = 0;
+}
+
+internal shader_type
+GetMeshShader(render_frame* Frame, mesh* Mesh, material* Material)
+{
+    bool IsForward = Frame->RenderMode == RenderMode_Forward || Frame->RenderMode == RenderMode_DepthPrepass;
+    shader_type Shader = IsForward ? Mesh->Shader : Shader_Phong;
+    if(Mesh->ShadingFrequency == ShadingFrequency_Vertex && Shader == Shader_Phong && Frame->Colors)
+    {
+        Shader = Shader_Gouraud;
+    }
+    else if(Shader == Shader_Phong && Material->DiffuseTexture && Mesh->TexCoords)
+    {
+        Shader = Shader_Textured;
+    }
+    return Shader;
+}
+
+// NOTE: Shader in the top byte, then the material, then the view depth of the mesh origin.
+// Positive floats order like their bits, so the low half sorts near to far.
+internal uint64_t
+GetDrawSortKey(render_frame* Frame, game_state* GameState, mesh* Mesh)
+{
+    vector4 Origin = vector4(0.0f, 0.0f, 0.0f, 1.0f);
+    vector4 ModelOrigin = MultPointMatrix(&Mesh->Transform, &Origin);
+    vector4 CameraSpaceOrigin = MultPointMatrix(&Frame->Camera->View, &ModelOrigin);
+    f32_bits Depth = {MAX(CameraSpaceOrigin.Z, 0.0f)};
+    uint32_t DepthBits = Depth.U32;
+    if(Frame->RenderMode == RenderMode_Forward)
+    {
+        // NOTE: Without a depth test the last draw wins, far to near keeps the painter's order
+        // right and leaves the state switches to chance
+        return (uint64_t)(UINT32_MAX - DepthBits);
+    }
+    
+    uint64_t Key = ((uint64_t)GetMeshShader(Frame, Mesh, GameState->Materials + Mesh->MaterialIndex) << 56) | ((uint64_t)Mesh->MaterialIndex << 32) | DepthBits;
+    return Key;
+}
+
+void
+SortMeshDraws(memory_arena* Arena, render_frame* Frame, game_state* GameState, mesh** Meshes, uint32_t Count)
+{
+    temporary_memory TempMemory = BeginTemporaryMemory(Arena);
+    uint64_t* Keys = PushArray(Arena, Count, uint64_t);
+    mesh** Temp = PushArray(Arena, Count, mesh*);
+    uint64_t* TempKeys = PushArray(Arena, Count, uint64_t);
+    for(uint32_t Index = 0; Index < Count; ++Index)
+    {
+        Keys[Index] = GetDrawSortKey(Frame, GameState, Meshes[Index]);
+    }
+    
+    // NOTE: Stable merge sort, draws with equal keys keep the order they were submitted in
+    for(uint32_t Width = 1; Width < Count; Width *= 2)
+    {
+        for(uint32_t Start = 0; Start < Count; Start += 2 * Width)
+        {
+            uint32_t Middle = MIN(Start + Width, Count);
+            uint32_t End = MIN(Start + 2 * Width, Count);
+            uint32_t Left = Start;
+            uint32_t Right = Middle;
+            for(uint32_t Out = Start; Out < End; ++Out)
+            {
+                uint32_t From = (Left < Middle && (Right >= End || Keys[Left] <= Keys[Right])) ? Left++ : Right++;
+                Temp[Out] = Meshes[From];
+                TempKeys[Out] = Keys[From];
+            }
+        }
+        for(uint32_t Index = 0; Index < Count; ++Index)
+        {
+            Meshes[Index] = Temp[Index];
+            Keys[Index] = TempKeys[Index];
+        }
+    }
+    EndTemporaryMemory(TempMemory);
+}
+
+void 
+PushMesh(memory_arena* Arena, render_frame* Frame, game_state* GameState, mesh* Mesh)
+{
+    Assert(Frame->TrianglesCount + Mesh->IndicesCount / 3 <= Frame->TrianglesCapacity);
+    Assert(Frame->MeshesCount < MAX_FRAME_MESH_COUNT && Mesh->IndicesCount / 3 <= (1 << VISIBILITY_TRIANGLE_BITS));
+    Assert(Mesh->MaterialIndex < ArrayCount(GameState->Materials));
+    uint32_t MeshIndex = Frame->MeshesCount++;
+    uint32_t MeshFirstTriangle = Frame->TrianglesCount;
+    Frame->MeshFirstTriangles[MeshIndex] = MeshFirstTriangle;
+    Frame->Materials[MeshIndex] = GameState->Materials[Mesh->MaterialIndex];
+    shader_type Shader = GetMeshShader(Frame, Mesh, Frame->Materials + MeshIndex);
+    // NOTE: The rasterizers only check the material for a texture
+    bool IsTextured = Mesh->TexCoords && Frame->Materials[MeshIndex].DiffuseTexture;
+    if(!IsTextured)
+    {
+        Frame->Materials[MeshIndex].DiffuseTexture = 0;
+    }
+    uint32_t IndexOffset = Frame->TrianglesCount * 3;
+    vector2i* TriangleVertices = Frame->ScreenPositions + IndexOffset;
+    float* Depths = Frame->Depths ? Frame->Depths + IndexOffset : 0;
+    vector3* TexCoords = IsTextured ? Frame->TexCoords + IndexOffset : 0;
+    
+    VertexStage(Arena, GameState, Frame->Kernels, Frame->Camera, Mesh, 
+                Frame->ImageWidth, Frame->ImageHeight,
+                TriangleVertices, Frame->Positions + IndexOffset, Frame->Normals + IndexOffset,
+                Depths, TexCoords);
+    if(Shader == Shader_Gouraud)
+    {
+        LightMeshVertices(Arena, Frame->Kernels, Mesh, Frame->Materials + MeshIndex, &Frame->AllLights,
+                          Frame->Colors + IndexOffset);
+    }
+    
+    for (uint32_t i = 0; i < Mesh->IndicesCount; i+=3) 
+    {
+        vector2i V0 = TriangleVertices[i+0];
+        vector2i V1 = TriangleVertices[i+1];
+        vector2i V2 = TriangleVertices[i+2];
+#if SABLUJO_INTERNAL
+        ++GameState->RenderStats.TrianglesCount;
+#endif
+        
+        int64_t Area = EdgeFunction(V0, V1, V2);
+        // NOTE: Back facing and degenerate triangles can't have a pixel with all edges positive
+        if(Area <= 0)
+        {
+            continue;
+        }
+        
+        raster_triangle* Triangle = Frame->Triangles + Frame->TrianglesCount;
+        int32_t MinX = MIN(V0.X, MIN(V1.X, V2.X));
+        int32_t MinY = MIN(V0.Y, MIN(V1.Y, V2.Y));
+        int32_t MaxX = MAX(V0.X, MAX(V1.X, V2.X));
+        int32_t MaxY = MAX(V0.Y, MAX(V1.Y, V2.Y));
+        
+        // Clip against image bounds
+        Triangle->MinX = MAX(MinX, 0);
+        Triangle->MinY = MAX(MinY, 0);
+        Triangle->MaxX = MIN(MaxX, Frame->ImageWidth - 1);
+        Triangle->MaxY = MIN(MaxY, Frame->ImageHeight - 1);
+        Triangle->InvArea = (float)(1.0 / (double)Area);
+        
+        int32_t Width = Triangle->MaxX - Triangle->MinX + 1;
+        int32_t Height = Triangle->MaxY - Triangle->MinY + 1;
+        Triangle->AspectBucket = GetAspectBucket(Width, Height);
+        Triangle->Shape = SelectBlockShape(Frame->BlockShapeThresholds, Width, Height);
+        Triangle->ShadingMode = Mesh->ShadingMode;
+        Triangle->Shader = Shader;
+        Triangle->VisibilityId = (MeshIndex << VISIBILITY_TRIANGLE_BITS) | (Frame->TrianglesCount - MeshFirstTriangle);
+#if SABLUJO_INTERNAL
+        if(!Frame->IsCalibratingBlockShapes)
+        {
+            ++GameState->RenderStats.TrianglesPerShape[Triangle->Shape];
+        }
+#endif
+        
+        // NOTE: Culled triangles leave holes in the vertex outputs, triangle i always reads index 3 * i
+        if(Frame->TrianglesCount * 3 != IndexOffset + i)
+        {
+            uint32_t Destination = Frame->TrianglesCount * 3;
+            for(uint32_t Vertex = 0; Vertex < 3; ++Vertex)
+            {
+                Frame->ScreenPositions[Destination + Vertex] = Frame->ScreenPositions[IndexOffset + i + Vertex];
+                Frame->Positions[Destination + Vertex] = Frame->Positions[IndexOffset + i + Vertex];
+                Frame->Normals[Destination + Vertex] = Frame->Normals[IndexOffset + i + Vertex];
+                if(Shader == Shader_Gouraud)
+                {
+                    Frame->Colors[Destination + Vertex] = Frame->Colors[IndexOffset + i + Vertex];
+                }
+                if(Frame->Depths)
+                {
+                    Frame->Depths[Destination + Vertex] = Frame->Depths[IndexOffset + i + Vertex];
+                }
+                if(IsTextured)
+                {
+                    Frame->TexCoords[Destination + Vertex] = Frame->TexCoords[IndexOffset + i + Vertex];
+                }
+            }
+        }
+        ++Frame->TrianglesCount;
+    }
+}
+
+internal void
+InitializeBins(triangle_bins* Bins, int32_t OriginX, int32_t OriginY, 
+               int32_t Width, int32_t Height, int32_t TileSize)
+{
+    *Bins = {};
+    Bins->OriginX = OriginX;
+    Bins->OriginY = OriginY;
+    Bins->EndX = OriginX + Width - 1;
+    Bins->EndY = OriginY + Height - 1;
+    Bins->TileSize = TileSize;
+    Bins->TileCountX = (Width + TileSize - 1) / TileSize;
+    Bins->TileCountY = (Height + TileSize - 1) / TileSize;
+}
+
+// NOTE: Tiles touched by the triangle bounds, false when the triangle is outside of the bins
+internal bool
+GetBinsRange(triangle_bins* Bins, raster_triangle* Triangle,
+             int32_t* MinTileX, int32_t* MinTileY, int32_t* MaxTileX, int32_t* MaxTileY)
+{
+    int32_t MinX = MAX(Triangle->MinX, Bins->OriginX);
+    int32_t MinY = MAX(Triangle->MinY, Bins->OriginY);
+    int32_t MaxX = MIN(Triangle->MaxX, Bins->EndX);
+    int32_t MaxY = MIN(Triangle->MaxY, Bins->EndY);
+    if(MinX > MaxX || MinY > MaxY)
+    {
+        return false;
+    }
+    
+    *MinTileX = (MinX - Bins->OriginX) / Bins->TileSize;
+    *MinTileY = (MinY - Bins->OriginY) / Bins->TileSize;
+    *MaxTileX = (MaxX - Bins->OriginX) / Bins->TileSize;
+    *MaxTileY = (MaxY - Bins->OriginY) / Bins->TileSize;
+    return true;
+}
+
+internal void
+BinTriangles(memory_arena* Arena, raster_triangle* Triangles, triangle_bins* Bins,
+             uint32_t* TriangleIndices, uint32_t TrianglesCount)
+{
+    uint32_t TileCount = Bins->TileCountX * Bins->TileCountY;
+    Bins->TriangleOffsets = PushArray(Arena, TileCount + 1, uint32_t);
+    Bins->EstimatedFragments = PushArray(Arena, TileCount, uint32_t);
+    for(uint32_t TileIndex = 0; TileIndex <= TileCount; ++TileIndex)
+    {
+        Bins->TriangleOffsets[TileIndex] = 0;
+    }
+    
+    // Count triangles per tile, shifted by one to turn them into offsets in place
+    uint32_t BinnedCount = 0;
+    int32_t MinTileX, MinTileY, MaxTileX, MaxTileY;
+    for(uint32_t Index = 0; Index < TrianglesCount; ++Index)
+    {
+        raster_triangle* Triangle = Triangles + (TriangleIndices ? TriangleIndices[Index] : Index);
+        if(!GetBinsRange(Bins, Triangle, &MinTileX, &MinTileY, &MaxTileX, &MaxTileY))
+        {
+            continue;
+        }
+        
+        for(int32_t TileY = MinTileY; TileY <= MaxTileY; ++TileY)
+        {
+            for(int32_t TileX = MinTileX; TileX <= MaxTileX; ++TileX)
+            {
+                ++Bins->TriangleOffsets[TileY * Bins->TileCountX + TileX + 1];
+                ++BinnedCount;
+            }
+        }
+    }
+    for(uint32_t TileIndex = 0; TileIndex < TileCount; ++TileIndex)
+    {
+        Bins->TriangleOffsets[TileIndex + 1] += Bins->TriangleOffsets[TileIndex];
+        Bins->EstimatedFragments[TileIndex] = 0;
+    }
+    
+    // Fill the bins, triangles keep their submission order inside a tile
+    uint32_t* TileFill = PushArray(Arena, TileCount, uint32_t);
+    for(uint32_t TileIndex = 0; TileIndex < TileCount; ++TileIndex)
+    {
+        TileFill[TileIndex] = Bins->TriangleOffsets[TileIndex];
+    }
+    Bins->Triangles = PushArray(Arena, BinnedCount, uint32_t);
+    for(uint32_t Index = 0; Index < TrianglesCount; ++Index)
+    {
+        uint32_t TriangleIndex = TriangleIndices ? TriangleIndices[Index] : Index;
+        raster_triangle* Triangle = Triangles + TriangleIndex;
+        if(!GetBinsRange(Bins, Triangle, &MinTileX, &MinTileY, &MaxTileX, &MaxTileY))
+        {
+            continue;
+        }
+        
+        for(int32_t TileY = MinTileY; TileY <= MaxTileY; ++TileY)
+        {
+            int32_t TileMinY = Bins->OriginY + TileY * Bins->TileSize;
+            int32_t TileMaxY = MIN(TileMinY + Bins->TileSize - 1, Bins->EndY);
+            int32_t OverlapHeight = MIN(Triangle->MaxY, TileMaxY) - MAX(Triangle->MinY, TileMinY) + 1;
+            for(int32_t TileX = MinTileX; TileX <= MaxTileX; ++TileX)
+            {
+                int32_t TileMinX = Bins->OriginX + TileX * Bins->TileSize;
+                int32_t TileMaxX = MIN(TileMinX + Bins->TileSize - 1, Bins->EndX);
+                int32_t OverlapWidth = MIN(Triangle->MaxX, TileMaxX) - MAX(Triangle->MinX, TileMinX) + 1;
+                uint32_t TileIndex = TileY * Bins->TileCountX + TileX;
+                Bins->Triangles[TileFill[TileIndex]++] = TriangleIndex;
+                // NOTE: A triangle covers about half of its bounding box
+                Bins->EstimatedFragments[TileIndex] += (OverlapWidth * OverlapHeight) / 2;
+            }
+        }
+    }
+}
+
+triangle_bins*
+BinFrameTriangles(memory_arena* Arena, render_frame* Frame, int32_t TileSize)
+{
+    triangle_bins* Bins = PushStruct(Arena, triangle_bins);
+    InitializeBins(Bins, 0, 0, Frame->ImageWidth, Frame->ImageHeight, TileSize);
+    BinTriangles(Arena, Frame->Triangles, Bins, 0, Frame->TrianglesCount);
+    return Bins;
+}
+
+/////////////////////////
+// Shadows
+/////////////////////////
+
+internal void
+RenderShadowWorker(platform_work_queue* Queue, uint32_t ThreadIndex, void* Data)
+{
+    shadow_pass* Pass = (shadow_pass*)Data;
+    render_frame* Frame = Pass->Frame;
+    render_thread_context* Thread = Frame->ThreadContexts + ThreadIndex;
+    uint32_t TileCount = Pass->Bins.TileCountX * Pass->Bins.TileCountY;
+    uint64_t StartCycles = __rdtsc();
+    uint64_t StartFragments = Thread->FragmentsCount;
+    
+    uint32_t TileIndex;
+    while((TileIndex = AtomicIncrementUInt32(&Pass->NextTile) - 1) < TileCount)
+    {
+        depth_plane Plane;
+        Plane.Depths = Pass->Map->Depths;
+        Plane.OriginX = 0;
+        Plane.OriginY = 0;
+        Plane.Pitch = SHADOW_MAP_SIZE;
+        int32_t MinX = (TileIndex % Pass->Bins.TileCountX) * RASTER_TILE_SIZE;
+        int32_t MinY = (TileIndex / Pass->Bins.TileCountX) * RASTER_TILE_SIZE;
+        int32_t MaxX = MinX + RASTER_TILE_SIZE - 1;
+        int32_t MaxY = MinY + RASTER_TILE_SIZE - 1;
+        for(int32_t Y = MinY; Y <= MaxY; ++Y)
+        {
+            uint32_t* Row = Plane.Depths + Y * SHADOW_MAP_SIZE;
+            for(int32_t X = MinX; X <= MaxX; ++X)
+            {
+                Row[X] = RASTER_CLEAR_DEPTH;
+            }
+        }
+        
+        uint32_t* TileTriangles = Pass->Bins.Triangles + Pass->Bins.TriangleOffsets[TileIndex];
+        uint32_t* TileTrianglesEnd = Pass->Bins.Triangles + Pass->Bins.TriangleOffsets[TileIndex + 1];
+        for(uint32_t* TriangleIndex = TileTriangles; TriangleIndex != TileTrianglesEnd; ++TriangleIndex)
+        {
+            raster_triangle* Triangle = Pass->Triangles + *TriangleIndex;
+            int32_t StartWidth = MAX(Triangle->MinX, MinX);
+            int32_t StartHeight = MAX(Triangle->MinY, MinY);
+            int32_t EndWidth = MIN(Triangle->MaxX, MaxX);
+            int32_t EndHeight = MIN(Triangle->MaxY, MaxY);
+            Frame->Kernels->RasterizeDepth(Thread, &Plane, StartWidth, StartHeight, EndWidth, EndHeight,
+                                           *TriangleIndex * 3, Pass->ScreenPositions, Pass->Depths,
+                                           Triangle->InvArea);
+        }
+    }
+    
+    // NOTE: A thread can run several entries of the pass, the later ones find no tiles left
+    Pass->WorkerCycles[ThreadIndex] += __rdtsc() - StartCycles;
+    Pass->WorkerFragments[ThreadIndex] += Thread->FragmentsCount - StartFragments;
+}
+
+// NOTE: The key light looks at the bounding sphere of the casters, the map just covers it.
+// Only the faces turned away from the light are drawn, the lit surfaces of a closed mesh are
+// never compared against themselves and don't need much bias.
+void
+RenderShadowMap(memory_arena* Arena, game_memory* Memory, render_frame* Frame,
+                mesh** Casters, uint32_t CastersCount, bool IsFiltered)
+{
+    uint32_t IndicesCount = 0;
+    vector3 BoundsMin = { INFINITY, INFINITY, INFINITY};
+    vector3 BoundsMax = {-INFINITY, -INFINITY, -INFINITY};
+    for(uint32_t CasterIndex = 0; CasterIndex < CastersCount; ++CasterIndex)
+    {
+        mesh* Mesh = Casters[CasterIndex];
+        IndicesCount += Mesh->IndicesCount;
+        for(uint32_t Vertex = 0; Vertex < Mesh->VerticesCount; ++Vertex)
+        {
+            vector4 ModelVertex = vector4(Mesh->Vertices[Vertex], 1.0f);
+            vector4 WorldVertex = MultPointMatrix(&Mesh->Transform, &ModelVertex);
+            BoundsMin = {MIN(BoundsMin.X, WorldVertex.X), MIN(BoundsMin.Y, WorldVertex.Y), MIN(BoundsMin.Z, WorldVertex.Z)};
+            BoundsMax = {MAX(BoundsMax.X, WorldVertex.X), MAX(BoundsMax.Y, WorldVertex.Y), MAX(BoundsMax.Z, WorldVertex.Z)};
+        }
+    }
+    if(IndicesCount == 0)
+    {
+        return;
+    }
+    
+    uint32_t Light = 0;
+    scene_lights* Lights = Frame->Lights;
+    vector3 Origin = {Lights->PositionsX[Light], Lights->PositionsY[Light], Lights->PositionsZ[Light]};
+    vector3 Center = 0.5f * (BoundsMin + BoundsMax);
+    vector3 Diagonal = BoundsMax - BoundsMin;
+    float Radius = 0.5f * SquareRoot(DotProduct(Diagonal, Diagonal));
+    vector3 ToCenter = Center - Origin;
+    float Distance = SquareRoot(DotProduct(ToCenter, ToCenter));
+    // NOTE: A light among the casters would need a cube map, it stays unshadowed
+    if(Distance <= Radius)
+    {
+        return;
+    }
+    
+    shadow_map* Map = PushStruct(Arena, shadow_map);
+    Map->Light = Light;
+    Map->IsFiltered = IsFiltered;
+    Map->Origin = Origin;
+    Map->AxisZ = (1.0f / Distance) * ToCenter;
+    vector3 Up = {0.0f, 1.0f, 0.0f};
+    if(ABS(DotProduct(Up, Map->AxisZ)) > 0.9f)
+    {
+        Up = {1.0f, 0.0f, 0.0f};
+    }
+    vector3 AxisX = CrossProduct(Up, Map->AxisZ);
+    Map->AxisX = (1.0f / SquareRoot(DotProduct(AxisX, AxisX))) * AxisX;
+    Map->AxisY = CrossProduct(Map->AxisZ, Map->AxisX);
+    // NOTE: One texel of margin so the filter never reads past the casters
+    float TanHalfAngle = Radius / SquareRoot(Distance * Distance - Radius * Radius);
+    float Scale = (0.5f * SHADOW_MAP_SIZE - 1.0f) / TanHalfAngle;
+    Map->AxisX = Scale * Map->AxisX;
+    Map->AxisY = Scale * Map->AxisY;
+    Map->Center = 0.5f * SHADOW_MAP_SIZE;
+    Map->Depths = (uint32_t*)PushSize_(Arena, SHADOW_MAP_SIZE * SHADOW_MAP_SIZE * sizeof(uint32_t), 64);
+    
+    shadow_pass* Pass = PushStruct(Arena, shadow_pass);
+    *Pass = {};
+    Pass->Frame = Frame;
+    Pass->Map = Map;
+    Pass->ScreenPositions = PushArray(Arena, IndicesCount, vector2i);
+    Pass->Depths = PushArray(Arena, IndicesCount, float);
+    Pass->Triangles = PushArray(Arena, IndicesCount / 3, raster_triangle);
+    uint32_t TrianglesCount = 0;
+    for(uint32_t CasterIndex = 0; CasterIndex < CastersCount; ++CasterIndex)
+    {
+        mesh* Mesh = Casters[CasterIndex];
+        for(uint32_t Index = 0; Index < Mesh->IndicesCount; Index += 3)
+        {
+            vector2i* Vertices = Pass->ScreenPositions + TrianglesCount * 3;
+            float* Depths = Pass->Depths + TrianglesCount * 3;
+            bool IsBehind = false;
+            for(uint32_t Corner = 0; Corner < 3; ++Corner)
+            {
+                vector4 ModelVertex = vector4(Mesh->Vertices[Mesh->Indices[Index + Corner]], 1.0f);
+                vector4 WorldVertex = MultPointMatrix(&Mesh->Transform, &ModelVertex);
+                vector3 Position = {WorldVertex.X, WorldVertex.Y, WorldVertex.Z};
+                vector3 Offset = Position - Origin;
+                float Depth = DotProduct(Offset, Map->AxisZ);
+                IsBehind = IsBehind || Depth <= 0.0f;
+                float InvDepth = Depth > 0.0f ? 1.0f / Depth : 0.0f;
+                Vertices[Corner].X = (int32_t)(DotProduct(Offset, Map->AxisX) * InvDepth + Map->Center);
+                Vertices[Corner].Y = (int32_t)(DotProduct(Offset, Map->AxisY) * InvDepth + Map->Center);
+                Depths[Corner] = InvDepth;
+            }
+            
+            // NOTE: Turned away from the light is the opposite winding of the camera, the two
+            // last corners are swapped so the edge functions stay positive inside
+            int64_t Area = -EdgeFunction(Vertices[0], Vertices[1], Vertices[2]);
+            if(IsBehind || Area <= 0)
+            {
+                continue;
+            }
+            vector2i Swap = Vertices[1];
+            Vertices[1] = Vertices[2];
+            Vertices[2] = Swap;
+            float SwapDepth = Depths[1];
+            Depths[1] = Depths[2];
+            Depths[2] = SwapDepth;
+            
+            raster_triangle* Triangle = Pass->Triangles + TrianglesCount++;
+            *Triangle = {};
+            Triangle->MinX = MAX(MIN(Vertices[0].X, MIN(Vertices[1].X, Vertices[2].X)), 0);
+            Triangle->MinY = MAX(MIN(Vertices[0].Y, MIN(Vertices[1].Y, Vertices[2].Y)), 0);
+            Triangle->MaxX = MIN(MAX(Vertices[0].X, MAX(Vertices[1].X, Vertices[2].X)), SHADOW_MAP_SIZE - 1);
+            Triangle->MaxY = MIN(MAX(Vertices[0].Y, MAX(Vertices[1].Y, Vertices[2].Y)), SHADOW_MAP_SIZE - 1);
+            Triangle->InvArea = (float)(1.0 / (double)Area);
+        }
+    }
+    
+    InitializeBins(&Pass->Bins, 0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, RASTER_TILE_SIZE);
+    BinTriangles(Arena, Pass->Triangles, &Pass->Bins, 0, TrianglesCount);
+    if(Memory->RenderQueue && Frame->WorkerCount > 1)
+    {
+        for(uint32_t WorkerIndex = 0; WorkerIndex < Frame->WorkerCount; ++WorkerIndex)
+        {
+            Memory->Platform.AddEntry(Memory->RenderQueue, RenderShadowWorker, Pass);
+        }
+        Memory->Platform.CompleteAllWork(Memory->RenderQueue);
+    }
+    else
+    {
+        RenderShadowWorker(0, 0, Pass);
+    }
+    
+    for(uint32_t WorkerIndex = 0; WorkerIndex < Frame->WorkerCount; ++WorkerIndex)
+    {
+        Frame->ShadowCycles += Pass->WorkerCycles[WorkerIndex];
+        Frame->ShadowFragmentsCount += Pass->WorkerFragments[WorkerIndex];
+    }
+    Frame->Shadow = Map;
+    Frame->AllLights.Shadow = Map;
+#if SABLUJO_INTERNAL
+    game_state* GameState = (game_state*)Memory->PermanentStorage;
+    GameState->RenderStats.ShadowTrianglesCount += TrianglesCount;
+    GameState->RenderStats.ShadowFragmentsCount += (uint32_t)Frame->ShadowFragmentsCount;
+#endif
+}
+
+/////////////////////////
+// Scheduling
+/////////////////////////
+
+internal void
+PushRenderJob(render_frame* Frame, 
+              int32_t MinX, int32_t MinY, int32_t MaxX, int32_t MaxY,
+              uint32_t TileIndex, uint64_t PredictedCycles, uint64_t HotCycles)
+{
+    if(MinX > Frame->Tiles.EndX || MinY > Frame->Tiles.EndY)
+    {
+        return;
+    }
+    
+    int32_t Size = MaxX - MinX + 1;
+    if(PredictedCycles > HotCycles && Size > RENDER_JOB_MIN_SIZE)
+    {
+        // NOTE: Assume the cost is spread evenly over the quadrants, next frame will tell
+        int32_t HalfSize = Size / 2;
+        uint64_t QuadrantCycles = PredictedCycles / 4;
+        PushRenderJob(Frame, MinX, MinY, MinX + HalfSize - 1, MinY + HalfSize - 1, TileIndex, QuadrantCycles, HotCycles);
+        PushRenderJob(Frame, MinX + HalfSize, MinY, MaxX, MinY + HalfSize - 1, TileIndex, QuadrantCycles, HotCycles);
+        PushRenderJob(Frame, MinX, MinY + HalfSize, MinX + HalfSize - 1, MaxY, TileIndex, QuadrantCycles, HotCycles);
+        PushRenderJob(Frame, MinX + HalfSize, MinY + HalfSize, MaxX, MaxY, TileIndex, QuadrantCycles, HotCycles);
+    }
+    else
+    {
+        render_job* Job = Frame->Jobs + Frame->JobsCount++;
+        *Job = {};
+        Job->MinX = MinX;
+        Job->MinY = MinY;
+        Job->MaxX = MIN(MaxX, Frame->Tiles.EndX);
+        Job->MaxY = MIN(MaxY, Frame->Tiles.EndY);
+        Job->TileIndex = TileIndex;
+        Job->TileCount = 1;
+        Job->PredictedCycles = PredictedCycles;
+    }
+}
+
+// NOTE: Stable merge sort of job indices, most expensive first
+internal void
+SortJobsByPredictedCycles(render_job* Jobs, uint32_t* Indices, uint32_t* Temp, uint32_t Count)
+{
+    for(uint32_t Width = 1; Width < Count; Width *= 2)
+    {
+        for(uint32_t Start = 0; Start < Count; Start += 2 * Width)
+        {
+            uint32_t Middle = MIN(Start + Width, Count);
+            uint32_t End = MIN(Start + 2 * Width, Count);
+            uint32_t Left = Start;
+            uint32_t Right = Middle;
+            for(uint32_t Out = Start; Out < End; ++Out)
+            {
+                if(Left < Middle && (Right >= End || Jobs[Indices[Left]].PredictedCycles >= Jobs[Indices[Right]].PredictedCycles))
+                {
+                    Temp[Out] = Indices[Left++];
+                }
+                else
+                {
+                    Temp[Out] = Indices[Right++];
+                }
+            }
+        }
+        for(uint32_t Index = 0; Index < Count; ++Index)
+        {
+            Indices[Index] = Temp[Index];
+        }
+    }
+}
+
+internal void
+ScheduleJobs(memory_arena* Arena, render_frame* Frame, render_tile_history* History)
+{
+    triangle_bins* Tiles = &Frame->Tiles;
+    uint32_t TileCount = Tiles->TileCountX * Tiles->TileCountY;
+    bool HasHistory = (History->OriginX == Tiles->OriginX && History->OriginY == Tiles->OriginY &&
+                       History->TileCountX == Tiles->TileCountX && History->TileCountY == Tiles->TileCountY);
+    float CyclesPerFragment = History->CyclesPerFragment > 0.0f ? History->CyclesPerFragment : RENDER_DEFAULT_CYCLES_PER_FRAGMENT;
+    
+    // Predict each tile cost from last frame, or from its binned coverage when it has no usable history
+    uint64_t* PredictedCycles = PushArray(Arena, TileCount, uint64_t);
+    uint64_t TotalPredictedCycles = 0;
+    for(uint32_t TileIndex = 0; TileIndex < TileCount; ++TileIndex)
+    {
+        uint32_t TrianglesCount = Tiles->TriangleOffsets[TileIndex + 1] - Tiles->TriangleOffsets[TileIndex];
+        uint64_t Estimate = (uint64_t)(Tiles->EstimatedFragments[TileIndex] * CyclesPerFragment);
+        uint64_t Prediction = Estimate;
+        if(HasHistory && TrianglesCount && History->Tiles[TileIndex].TrianglesCount)
+        {
+            Prediction = History->Tiles[TileIndex].Cycles;
+        }
+        PredictedCycles[TileIndex] = TrianglesCount ? Prediction : 0;
+        TotalPredictedCycles += PredictedCycles[TileIndex];
+    }
+    uint64_t HotCycles = TotalPredictedCycles / (Frame->WorkerCount * RENDER_JOBS_PER_WORKER);
+    
+    // Give each cache domain a band of tile rows sized to its share of the workers, so
+    // neighbouring tiles are rendered by workers sharing a cache
+    uint32_t* RowDomains = PushArray(Arena, Tiles->TileCountY, uint32_t);
+    uint64_t* RowCycles = PushArray(Arena, Tiles->TileCountY, uint64_t);
+    uint64_t TotalRowCycles = 0;
+    for(int32_t TileY = 0; TileY < Tiles->TileCountY; ++TileY)
+    {
+        RowCycles[TileY] = 0;
+        for(int32_t TileX = 0; TileX < Tiles->TileCountX; ++TileX)
+        {
+            RowCycles[TileY] += MAX(1, PredictedCycles[TileY * Tiles->TileCountX + TileX]);
+        }
+        TotalRowCycles += RowCycles[TileY];
+    }
+    uint32_t Domain = 0;
+    uint32_t DomainWorkersEnd = Frame->DomainWorkersCount[0];
+    uint64_t RowCyclesStart = 0;
+    for(int32_t TileY = 0; TileY < Tiles->TileCountY; ++TileY)
+    {
+        // NOTE: A row belongs to the domain its cost midpoint falls in
+        uint64_t RowMiddle = RowCyclesStart + RowCycles[TileY] / 2;
+        while(Domain + 1 < Frame->DomainsCount && 
+              RowMiddle >= TotalRowCycles * DomainWorkersEnd / Frame->WorkerCount)
+        {
+            DomainWorkersEnd += Frame->DomainWorkersCount[++Domain];
+        }
+        RowDomains[TileY] = Domain;
+        RowCyclesStart += RowCycles[TileY];
+    }
+    
+    // Split hot tiles, merge runs of empty tiles on a row into a single clearing job
+    uint32_t MaxJobsPerTile = (RASTER_TILE_SIZE / RENDER_JOB_MIN_SIZE) * (RASTER_TILE_SIZE / RENDER_JOB_MIN_SIZE);
+    Frame->Jobs = PushArray(Arena, TileCount * MaxJobsPerTile, render_job);
+    Frame->JobsCount = 0;
+    for(int32_t TileY = 0; TileY < Tiles->TileCountY; ++TileY)
+    {
+        render_job* EmptyRun = 0;
+        for(int32_t TileX = 0; TileX < Tiles->TileCountX; ++TileX)
+        {
+            uint32_t TileIndex = TileY * Tiles->TileCountX + TileX;
+            int32_t MinX = Tiles->OriginX + TileX * RASTER_TILE_SIZE;
+            int32_t MinY = Tiles->OriginY + TileY * RASTER_TILE_SIZE;
+            int32_t MaxX = MinX + RASTER_TILE_SIZE - 1;
+            int32_t MaxY = MinY + RASTER_TILE_SIZE - 1;
+            if(Tiles->TriangleOffsets[TileIndex + 1] == Tiles->TriangleOffsets[TileIndex])
+            {
+                if(EmptyRun)
+                {
+                    EmptyRun->MaxX = MIN(MaxX, Tiles->EndX);
+                    ++EmptyRun->TileCount;
+                }
+                else
+                {
+                    PushRenderJob(Frame, MinX, MinY, MaxX, MaxY, RENDER_JOB_NO_TILE, 0, HotCycles);
+                    EmptyRun = Frame->Jobs + Frame->JobsCount - 1;
+                }
+            }
+            else
+            {
+                EmptyRun = 0;
+                PushRenderJob(Frame, MinX, MinY, MaxX, MaxY, TileIndex, PredictedCycles[TileIndex], HotCycles);
+            }
+        }
+    }
+    
+    // Most expensive first, each job goes to the least loaded worker of its domain
+    uint32_t* SortedJobs = PushArray(Arena, Frame->JobsCount, uint32_t);
+    uint32_t* SortTemp = PushArray(Arena, Frame->JobsCount, uint32_t);
+    for(uint32_t JobIndex = 0; JobIndex < Frame->JobsCount; ++JobIndex)
+    {
+        SortedJobs[JobIndex] = JobIndex;
+    }
+    SortJobsByPredictedCycles(Frame->Jobs, SortedJobs, SortTemp, Frame->JobsCount);
+    
+    uint32_t* JobWorker = SortTemp;
+    uint32_t WorkerJobsCount[MAX_RENDER_THREAD_COUNT] = {};
+    for(uint32_t WorkerIndex = 0; WorkerIndex < Frame->WorkerCount; ++WorkerIndex)
+    {
+        Frame->WorkerQueues[WorkerIndex].PredictedCycles = 0;
+    }
+    for(uint32_t SortedIndex = 0; SortedIndex < Frame->JobsCount; ++SortedIndex)
+    {
+        render_job* Job = Frame->Jobs + SortedJobs[SortedIndex];
+        uint32_t JobDomain = RowDomains[(Job->MinY - Tiles->OriginY) / RASTER_TILE_SIZE];
+        uint32_t LeastLoaded = UINT32_MAX;
+        for(uint32_t WorkerIndex = 0; WorkerIndex < Frame->WorkerCount; ++WorkerIndex)
+        {
+            if(Frame->WorkerDomains[WorkerIndex] == JobDomain &&
+               (LeastLoaded == UINT32_MAX || 
+                Frame->WorkerQueues[WorkerIndex].PredictedCycles < Frame->WorkerQueues[LeastLoaded].PredictedCycles))
+            {
+                LeastLoaded = WorkerIndex;
+            }
+        }
+        // NOTE: Empty jobs cost little but not nothing, keep them spread out
+        Frame->WorkerQueues[LeastLoaded].PredictedCycles += MAX(1, Job->PredictedCycles);
+        JobWorker[SortedIndex] = LeastLoaded;
+        ++WorkerJobsCount[LeastLoaded];
+    }
+    
+    // Lay the job indices out worker by worker, keeping the expensive first order
+    Frame->WorkerJobs = PushArray(Arena, Frame->JobsCount, uint32_t);
+    uint32_t WorkerFill[MAX_RENDER_THREAD_COUNT];
+    uint32_t FirstJob = 0;
+    for(uint32_t WorkerIndex = 0; WorkerIndex < Frame->WorkerCount; ++WorkerIndex)
+    {
+        render_worker_queue* Queue = Frame->WorkerQueues + WorkerIndex;
+        Queue->FirstJob = FirstJob;
+        Queue->JobsCount = WorkerJobsCount[WorkerIndex];
+        WorkerFill[WorkerIndex] = FirstJob;
+        FirstJob += WorkerJobsCount[WorkerIndex];
+    }
+    for(uint32_t SortedIndex = 0; SortedIndex < Frame->JobsCount; ++SortedIndex)
+    {
+        Frame->WorkerJobs[WorkerFill[JobWorker[SortedIndex]]++] = SortedJobs[SortedIndex];
+    }
+}
+
+/////////////////////////
+// Workers
+/////////////////////////
+
+internal bool
+PopJob(render_frame* Frame, render_worker_queue* Queue, bool FromFront, uint32_t* JobIndex)
+{
+    for(;;)
+    {
+        uint64_t HeadTail = Queue->HeadTail;
+        uint32_t Head = (uint32_t)HeadTail;
+        uint32_t Tail = (uint32_t)(HeadTail >> 32);
+        if(Head >= Tail)
+        {
+            return false;
+        }
+        
+        uint32_t Taken = FromFront ? Head : Tail - 1;
+        uint64_t NewHeadTail = FromFront ? (HeadTail + 1) : (HeadTail - ((uint64_t)1 << 32));
+        if(AtomicCompareExchangeUInt64(&Queue->HeadTail, NewHeadTail, HeadTail) == HeadTail)
+        {
+            *JobIndex = Frame->WorkerJobs[Queue->FirstJob + Taken];
+            return true;
+        }
+    }
+}
+
+internal material*
+GetTriangleMaterial(render_frame* Frame, raster_triangle* Triangle)
+{
+    return Frame->Materials + (Triangle->VisibilityId >> VISIBILITY_TRIANGLE_BITS);
+}
+
+// NOTE: RasterizeTriangleFixed16 shades one untextured light without falloff or shadows
+internal bool
+CanShadeFixed16(light_list* Lights, material* Material)
+{
+    bool Result = false;
+    if(Lights->Count == 1 && !Material->DiffuseTexture)
+    {
+        uint32_t Light = Lights->Indices[0];
+        Result = (Lights->Lights->Radii[Light] == 0.0f && !(Lights->Shadow && Lights->Shadow->Light == Light));
+    }
+    return Result;
+}
+
+internal void
+CalibrateBlockShapes(render_thread_context* Thread, raster_kernels* Kernels, 
+                     game_offscreen_buffer* Buffer, raster_triangle* Triangle, uint32_t TriangleIndex,
+                     int32_t StartWidth, int32_t StartHeight,
+                     int32_t EndWidth, int32_t EndHeight,
+                     vector2i* ScreenPositions, vector3h* Positions, vector3h* Normals, material* Material)
+{
+    // NOTE: Every shape rasterizes the same region, they all write the same pixels
+    block_shape_calibration* Calibration = &Thread->Calibration;
+    ++Calibration->TrianglesCount[Triangle->AspectBucket];
+    for(uint32_t ShapeOffset = 0; ShapeOffset < BlockShape_Count; ++ShapeOffset)
+    {
+        // Rotate the first shape so none of them always gets the cold caches
+        block_shape_type Shape = (block_shape_type)((TriangleIndex + ShapeOffset) % BlockShape_Count);
+#if SABLUJO_INTERNAL
+        uint32_t PixelsWastedBefore = Thread->Stats.PixelsWasted;
+#endif
+        uint64_t StartCycles = __rdtsc();
+        Kernels->RasterizeTriangle(Thread, Buffer, Shape, StartWidth, StartHeight, EndWidth, EndHeight, 
+                                   TriangleIndex * 3, ScreenPositions, Positions, Normals, Material, Triangle->InvArea);
+        Calibration->Cycles[Shape][Triangle->AspectBucket] += __rdtsc() - StartCycles;
+#if SABLUJO_INTERNAL
+        Calibration->PixelsWasted[Shape][Triangle->AspectBucket] += Thread->Stats.PixelsWasted - PixelsWastedBefore;
+#endif
+    }
+}
+
+// NOTE: Splits the region in runs of screen tiles sharing a rate, a row of tiles at a time
+internal void
+RasterizeTriangleRated(render_frame* Frame, render_thread_context* Thread, raster_triangle* Triangle, uint32_t TriangleIndex,
+                       int32_t StartWidth, int32_t StartHeight, int32_t EndWidth, int32_t EndHeight)
+{
+    material* Material = GetTriangleMaterial(Frame, Triangle);
+    for(int32_t RowStart = StartHeight; RowStart <= EndHeight;)
+    {
+        int32_t TileY = RowStart / SHADING_RATE_TILE_SIZE;
+        int32_t RowEnd = MIN(EndHeight, (TileY + 1) * SHADING_RATE_TILE_SIZE - 1);
+        uint8_t* RowRates = Frame->ShadingRates + TileY * Frame->ShadingRateCountX;
+        for(int32_t RunStart = StartWidth; RunStart <= EndWidth;)
+        {
+            int32_t TileX = RunStart / SHADING_RATE_TILE_SIZE;
+            shading_rate Rate = (shading_rate)RowRates[TileX];
+            while((TileX + 1) * SHADING_RATE_TILE_SIZE <= EndWidth && RowRates[TileX + 1] == Rate)
+            {
+                ++TileX;
+            }
+            int32_t RunEnd = MIN(EndWidth, (TileX + 1) * SHADING_RATE_TILE_SIZE - 1);
+            
+            if(Rate == ShadingRate_1x1)
+            {
+                Frame->Kernels->RasterizeTriangle(Thread, Frame->Buffer, Triangle->Shape, RunStart, RowStart, RunEnd, RowEnd, 
+                                                  TriangleIndex * 3, Frame->ScreenPositions, Frame->Positions, Frame->Normals, Material, Triangle->InvArea);
+            }
+            else
+            {
+                Frame->Kernels->RasterizeTriangleCoarse(Thread, Frame->Buffer, Rate, RunStart, RowStart, RunEnd, RowEnd, 
+                                                        TriangleIndex * 3, Frame->ScreenPositions, Frame->Positions, Frame->Normals, Material, Triangle->InvArea);
+            }
+            RunStart = RunEnd + 1;
+        }
+        RowStart = RowEnd + 1;
+    }
+}
+
+// NOTE: Largest step of any color channel between two pixels, none when one is still clear
+internal inline int32_t
+GetPixelStep(uint32_t A, uint32_t B)
+{
+    int32_t Step = 0;
+    if(A && B)
+    {
+        for(int32_t Shift = 0; Shift < 24; Shift += 8)
+        {
+            Step = MAX(Step, ABS((int32_t)((A >> Shift) & 0xFF) - (int32_t)((B >> Shift) & 0xFF)));
+        }
+    }
+    return Step;
+}
+
+// NOTE: Same for 4 pairs of pixels, per channel byte
+internal inline __m128i
+GetPixelSteps(__m128i A, __m128i B)
+{
+    __m128i Zero = _mm_setzero_si128();
+    __m128i Cleared = _mm_or_si128(_mm_cmpeq_epi32(A, Zero), _mm_cmpeq_epi32(B, Zero));
+    __m128i Steps = _mm_or_si128(_mm_subs_epu8(A, B), _mm_subs_epu8(B, A));
+    return _mm_andnot_si128(Cleared, Steps);
+}
+
+// NOTE: Measures the largest color step between neighbouring pixels of every screen tile of
+// the job. The variance of the whole tile hides a highlight or terminator in a corner, this
+// doesn't. Pairs with a pixel left at the clear color are not counted, silhouettes keep per
+// pixel coverage whatever the rate. Nothing is read outside the job, other workers may be
+// writing there.
+internal void
+MeasureShadingContrasts(render_frame* Frame, render_job* Job)
+{
+    shading_rate_history* History = Frame->ShadingRateHistory;
+    game_offscreen_buffer* Buffer = Frame->Buffer;
+    // Empty jobs were only cleared, their tiles are flat
+    bool IsEmpty = (Job->TileIndex == RENDER_JOB_NO_TILE);
+    for(int32_t TileY = Job->MinY / SHADING_RATE_TILE_SIZE; TileY <= Job->MaxY / SHADING_RATE_TILE_SIZE; ++TileY)
+    {
+        int32_t MinY = MAX(Job->MinY, TileY * SHADING_RATE_TILE_SIZE);
+        int32_t MaxY = MIN(Job->MaxY, (TileY + 1) * SHADING_RATE_TILE_SIZE - 1);
+        for(int32_t TileX = Job->MinX / SHADING_RATE_TILE_SIZE; TileX <= Job->MaxX / SHADING_RATE_TILE_SIZE; ++TileX)
+        {
+            int32_t MinX = MAX(Job->MinX, TileX * SHADING_RATE_TILE_SIZE);
+            int32_t MaxX = MIN(Job->MaxX, (TileX + 1) * SHADING_RATE_TILE_SIZE - 1);
+            
+            int32_t MaxContrast = 0;
+            __m128i MaxSteps = _mm_setzero_si128();
+            for(int32_t Y = MinY; !IsEmpty && Y <= MaxY; ++Y)
+            {
+                uint32_t* Row = (uint32_t*)((uint8_t*)Buffer->Memory + (Y - Buffer->OriginY) * Buffer->Pitch) - Buffer->OriginX;
+                uint32_t* Below = (uint32_t*)((uint8_t*)Row + Buffer->Pitch);
+                int32_t X = MinX;
+                for(; X + 3 <= MaxX; X += 4)
+                {
+                    __m128i Pixels = _mm_loadu_si128((__m128i*)(Row + X));
+                    // The last group shifts in a zero, which counts as clear
+                    __m128i Right = (X + 4 <= MaxX) ? _mm_loadu_si128((__m128i*)(Row + X + 1)) : _mm_srli_si128(Pixels, 4);
+                    MaxSteps = _mm_max_epu8(MaxSteps, GetPixelSteps(Pixels, Right));
+                    if(Y < MaxY)
+                    {
+                        MaxSteps = _mm_max_epu8(MaxSteps, GetPixelSteps(Pixels, _mm_loadu_si128((__m128i*)(Below + X))));
+                    }
+                }
+                for(; X <= MaxX; ++X)
+                {
+                    if(X < MaxX)
+                    {
+                        MaxContrast = MAX(MaxContrast, GetPixelStep(Row[X], Row[X + 1]));
+                    }
+                    if(Y < MaxY)
+                    {
+                        MaxContrast = MAX(MaxContrast, GetPixelStep(Row[X], Below[X]));
+                    }
+                }
+            }
+            MaxSteps = _mm_max_epu8(MaxSteps, _mm_srli_si128(MaxSteps, 8));
+            MaxSteps = _mm_max_epu8(MaxSteps, _mm_srli_si128(MaxSteps, 4));
+            MaxSteps = _mm_max_epu8(MaxSteps, _mm_srli_si128(MaxSteps, 2));
+            MaxSteps = _mm_max_epu8(MaxSteps, _mm_srli_si128(MaxSteps, 1));
+            MaxContrast = MAX(MaxContrast, _mm_cvtsi128_si32(MaxSteps) & 0xFF);
+            History->Contrasts[TileY * History->TileCountX + TileX] = (uint8_t)MaxContrast;
+        }
+    }
+}
+
+// NOTE: Clears the job region of a tile sized plane starting at the job corner. The shading
+// passes read whole blocks, the columns up to the next job boundary are cleared too.
+internal void
+ClearJobPlane(uint32_t* Plane, render_job* Job, uint32_t Value)
+{
+    int32_t ClearWidth = (Job->MaxX - Job->MinX + RENDER_JOB_MIN_SIZE) & ~(RENDER_JOB_MIN_SIZE - 1);
+    for(int32_t Y = 0; Y <= Job->MaxY - Job->MinY; ++Y)
+    {
+        uint32_t* Row = Plane + Y * RASTER_TILE_SIZE;
+        for(int32_t X = 0; X < ClearWidth; ++X)
+        {
+            Row[X] = Value;
+        }
+    }
+}
+
+// NOTE: Jobs narrower than a reconstruction group, at the right edge of odd sized images, are
+// shaded whole
+internal bool
+IsCheckerboardHalfJob(render_frame* Frame, render_job* Job)
+{
+    return Frame->IsCheckerboardHalf && Job->MaxX - Job->MinX + 1 >= 4;
+}
+
+// NOTE: View depth range of the covered pixels of the job, from a tile sized plane of inverse
+// depths starting at the job corner. False when nothing was drawn there.
+internal bool
+GetJobDepthBounds(uint32_t* Plane, render_job* Job, float* MinDepth, float* MaxDepth)
+{
+    float MinInvDepth = INFINITY;
+    float MaxInvDepth = 0.0f;
+    for(int32_t Y = 0; Y <= Job->MaxY - Job->MinY; ++Y)
+    {
+        float* Row = (float*)(Plane + Y * RASTER_TILE_SIZE);
+        for(int32_t X = 0; X <= Job->MaxX - Job->MinX; ++X)
+        {
+            // NOTE: The clear depth is 0, it never lowers the minimum
+            float InvDepth = Row[X];
+            if(InvDepth > 0.0f)
+            {
+                MinInvDepth = MIN(MinInvDepth, InvDepth);
+            }
+            MaxInvDepth = MAX(MaxInvDepth, InvDepth);
+        }
+    }
+    
+    if(MaxInvDepth == 0.0f)
+    {
+        return false;
+    }
+    *MinDepth = 1.0f / MaxInvDepth;
+    *MaxDepth = 1.0f / MinInvDepth;
+    return true;
+}
+
+// NOTE: Keeps the lights whose sphere touches the frustum of the job, the side planes through
+// the eye and the depth range. A pixel edge x is at the view space slope
+// X / Z = (1 - 2x / Width) / P00 and y at Y / Z = (2y / Height - 1) / P11.
+internal void
+CullJobLights(render_frame* Frame, render_thread_context* Thread, render_job* Job,
+              float MinDepth, float MaxDepth)
+{
+    scene_lights* Lights = Frame->Lights;
+    light_list* List = &Thread->Lights;
+    List->Lights = Lights;
+    List->Probe = &Frame->AmbientProbe;
+    List->Shadow = Frame->Shadow;
+    List->Count = 0;
+    
+    float InvScaleX = 1.0f / Frame->Camera->Projection.val[0][0];
+    float InvScaleY = 1.0f / Frame->Camera->Projection.val[1][1];
+    float LeftSlope = (1.0f - 2.0f * (float)Job->MinX / (float)Frame->ImageWidth) * InvScaleX;
+    float RightSlope = (1.0f - 2.0f * (float)(Job->MaxX + 1) / (float)Frame->ImageWidth) * InvScaleX;
+    float TopSlope = (2.0f * (float)Job->MinY / (float)Frame->ImageHeight - 1.0f) * InvScaleY;
+    float BottomSlope = (2.0f * (float)(Job->MaxY + 1) / (float)Frame->ImageHeight - 1.0f) * InvScaleY;
+    float InvLeftLength = 1.0f / SquareRoot(1.0f + LeftSlope * LeftSlope);
+    float InvRightLength = 1.0f / SquareRoot(1.0f + RightSlope * RightSlope);
+    float InvTopLength = 1.0f / SquareRoot(1.0f + TopSlope * TopSlope);
+    float InvBottomLength = 1.0f / SquareRoot(1.0f + BottomSlope * BottomSlope);
+    
+    for(uint32_t Light = 0; Light < Lights->Count; ++Light)
+    {
+        float Radius = Lights->Radii[Light];
+        if(Radius > 0.0f)
+        {
+            float X = Frame->LightViewX[Light];
+            float Y = Frame->LightViewY[Light];
+            float Z = Frame->LightViewZ[Light];
+            if(Z + Radius < MinDepth || Z - Radius > MaxDepth ||
+               (LeftSlope * Z - X) * InvLeftLength < -Radius ||
+               (X - RightSlope * Z) * InvRightLength < -Radius ||
+               (BottomSlope * Z - Y) * InvBottomLength < -Radius ||
+               (Y - TopSlope * Z) * InvTopLength < -Radius)
+            {
+                continue;
+            }
+        }
+        List->Indices[List->Count++] = (uint16_t)Light;
+    }
+#if SABLUJO_INTERNAL
+    Thread->Stats.JobLightsCount += List->Count;
+#endif
+}
+
+// NOTE: Pixels left out this frame were shaded in place last frame. That color is kept when it
+// lies between the shaded neighbours, channel by channel, and clamped to them otherwise so
+// moving shading doesn't smear. The neighbours on the same triangle give the range, or those
+// on the same mesh when there are none. Only neighbours inside the job are read, the other
+// jobs may not be shaded yet. Empty pixels are cleared, shaded or not.
+internal void
+ReconstructCheckerboard(render_frame* Frame, visibility_tile* Tile, render_job* Job)
+{
+    game_offscreen_buffer* Buffer = Frame->Buffer;
+    int32_t Width = Job->MaxX - Job->MinX + 1;
+    Assert(Width >= 4);
+    
+    // NOTE: Stands in for the ids above the first row and below the last one
+    uint32_t EmptyIds[RASTER_TILE_SIZE];
+    for(int32_t X = 0; X < RASTER_TILE_SIZE; ++X)
+    {
+        EmptyIds[X] = VISIBILITY_EMPTY_ID;
+    }
+    
+    __m128i Zero = _mm_setzero_si128();
+    __m128i AllSet = _mm_set1_epi32(-1);
+    __m128i One = _mm_set1_epi32(1);
+    __m128i LaneX = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i EmptyId = _mm_set1_epi32((int32_t)VISIBILITY_EMPTY_ID);
+    __m128i WidthVec = _mm_set1_epi32(Width);
+    for(int32_t Y = Job->MinY; Y <= Job->MaxY; ++Y)
+    {
+        uint32_t* Row = (uint32_t*)((uint8_t*)Buffer->Memory + (Y - Buffer->OriginY) * Buffer->Pitch) + (Job->MinX - Buffer->OriginX);
+        uint32_t* IdRow = Tile->Ids + (Y - Tile->OriginY) * RASTER_TILE_SIZE + (Job->MinX - Tile->OriginX);
+        uint32_t* RowUp = (Y > Job->MinY) ? (uint32_t*)((uint8_t*)Row - Buffer->Pitch) : Row;
+        uint32_t* RowDown = (Y < Job->MaxY) ? (uint32_t*)((uint8_t*)Row + Buffer->Pitch) : Row;
+        uint32_t* IdRowUp = (Y > Job->MinY) ? IdRow - RASTER_TILE_SIZE : EmptyIds;
+        uint32_t* IdRowDown = (Y < Job->MaxY) ? IdRow + RASTER_TILE_SIZE : EmptyIds;
+        __m128i RowParity = _mm_set1_epi32(Job->MinX + Y + (int32_t)Frame->CheckerboardParity);
+        
+        // NOTE: Four pixels at a time, the last group is moved back to end on the last pixel.
+        // Running a pixel twice gives the same result since only the shaded ones are read.
+        for(int32_t GroupX = 0; GroupX < Width; GroupX += 4)
+        {
+            int32_t X = MIN(GroupX, Width - 4);
+            __m128i Xs = _mm_add_epi32(LaneX, _mm_set1_epi32(X));
+            __m128i Ids = _mm_loadu_si128((__m128i*)(IdRow + X));
+            __m128i IsEmpty = _mm_cmpeq_epi32(Ids, EmptyId);
+            if(_mm_movemask_epi8(IsEmpty) == 0xFFFF)
+            {
+                _mm_storeu_si128((__m128i*)(Row + X), Zero);
+                continue;
+            }
+            
+            __m128i Colors = _mm_loadu_si128((__m128i*)(Row + X));
+            __m128i NeighbourColors[4];
+            __m128i NeighbourIds[4];
+            __m128i IsInJob[4];
+            if(X > 0)
+            {
+                NeighbourColors[0] = _mm_loadu_si128((__m128i*)(Row + X - 1));
+                NeighbourIds[0] = _mm_loadu_si128((__m128i*)(IdRow + X - 1));
+            }
+            else
+            {
+                NeighbourColors[0] = _mm_slli_si128(Colors, 4);
+                NeighbourIds[0] = _mm_slli_si128(Ids, 4);
+            }
+            if(X + 5 <= Width)
+            {
+                NeighbourColors[1] = _mm_loadu_si128((__m128i*)(Row + X + 1));
+                NeighbourIds[1] = _mm_loadu_si128((__m128i*)(IdRow + X + 1));
+            }
+            else
+            {
+                NeighbourColors[1] = _mm_srli_si128(Colors, 4);
+                NeighbourIds[1] = _mm_srli_si128(Ids, 4);
+            }
+            NeighbourColors[2] = _mm_loadu_si128((__m128i*)(RowUp + X));
+            NeighbourIds[2] = _mm_loadu_si128((__m128i*)(IdRowUp + X));
+            NeighbourColors[3] = _mm_loadu_si128((__m128i*)(RowDown + X));
+            NeighbourIds[3] = _mm_loadu_si128((__m128i*)(IdRowDown + X));
+            IsInJob[0] = _mm_cmpgt_epi32(Xs, Zero);
+            IsInJob[1] = _mm_cmplt_epi32(_mm_add_epi32(Xs, One), WidthVec);
+            IsInJob[2] = AllSet;
+            IsInJob[3] = AllSet;
+            
+            __m128i Meshes = _mm_srli_epi32(Ids, VISIBILITY_TRIANGLE_BITS);
+            __m128i SameTriangles[4];
+            __m128i SameMeshes[4];
+            __m128i AnySameTriangle = Zero;
+            for(int32_t Neighbour = 0; Neighbour < 4; ++Neighbour)
+            {
+                SameTriangles[Neighbour] = _mm_and_si128(IsInJob[Neighbour], _mm_cmpeq_epi32(NeighbourIds[Neighbour], Ids));
+                SameMeshes[Neighbour] = _mm_and_si128(IsInJob[Neighbour], _mm_cmpeq_epi32(_mm_srli_epi32(NeighbourIds[Neighbour], VISIBILITY_TRIANGLE_BITS), Meshes));
+                AnySameTriangle = _mm_or_si128(AnySameTriangle, SameTriangles[Neighbour]);
+            }
+            
+            __m128i Low = AllSet;
+            __m128i High = Zero;
+            __m128i AnyUsed = Zero;
+            for(int32_t Neighbour = 0; Neighbour < 4; ++Neighbour)
+            {
+                __m128i Used = _mm_or_si128(_mm_and_si128(AnySameTriangle, SameTriangles[Neighbour]),
+                                            _mm_andnot_si128(AnySameTriangle, SameMeshes[Neighbour]));
+                Low = _mm_min_epu8(Low, _mm_or_si128(_mm_and_si128(Used, NeighbourColors[Neighbour]), _mm_andnot_si128(Used, AllSet)));
+                High = _mm_max_epu8(High, _mm_and_si128(Used, NeighbourColors[Neighbour]));
+                AnyUsed = _mm_or_si128(AnyUsed, Used);
+            }
+            __m128i Clamped = _mm_max_epu8(_mm_min_epu8(Colors, High), Low);
+            
+            __m128i Missing = _mm_cmpeq_epi32(_mm_and_si128(_mm_add_epi32(Xs, RowParity), One), One);
+            __m128i Replace = _mm_and_si128(Missing, AnyUsed);
+            Colors = _mm_or_si128(_mm_and_si128(Replace, Clamped), _mm_andnot_si128(Replace, Colors));
+            Colors = _mm_andnot_si128(IsEmpty, Colors);
+            _mm_storeu_si128((__m128i*)(Row + X), Colors);
+        }
+    }
+}
+
+// NOTE: Both passes run on the same job so the tile stays in cache, jobs are what spreads
+// them over the workers
+internal void
+RenderVisibilityJob(render_frame* Frame, render_thread_context* Thread, render_job* Job)
+{
+    visibility_tile* Tile = Thread->VisibilityTile;
+    Tile->OriginX = Job->MinX;
+    Tile->OriginY = Job->MinY;
+    ClearJobPlane(Tile->Depths, Job, RASTER_CLEAR_DEPTH);
+    ClearJobPlane(Tile->Ids, Job, VISIBILITY_EMPTY_ID);
+    
+    uint32_t* TileTriangles = Frame->Tiles.Triangles + Frame->Tiles.TriangleOffsets[Job->TileIndex];
+    uint32_t* TileTrianglesEnd = Frame->Tiles.Triangles + Frame->Tiles.TriangleOffsets[Job->TileIndex + 1];
+    for(uint32_t* TriangleIndex = TileTriangles; TriangleIndex != TileTrianglesEnd; ++TriangleIndex)
+    {
+        raster_triangle* Triangle = Frame->Triangles + *TriangleIndex;
+        int32_t StartWidth = MAX(Triangle->MinX, Job->MinX);
+        int32_t StartHeight = MAX(Triangle->MinY, Job->MinY);
+        int32_t EndWidth = MIN(Triangle->MaxX, Job->MaxX);
+        int32_t EndHeight = MIN(Triangle->MaxY, Job->MaxY);
+        if(StartWidth > EndWidth || StartHeight > EndHeight)
+        {
+            continue;
+        }
+        
+        Frame->Kernels->RasterizeVisibility(Thread, Tile, StartWidth, StartHeight, EndWidth, EndHeight,
+                                            *TriangleIndex * 3, Frame->ScreenPositions, Frame->Depths,
+                                            Triangle->InvArea, Triangle->VisibilityId);
+    }
+    
+    // NOTE: An empty job still goes through the shading, the checkerboard reconstruction
+    // has to clear it
+    float MinDepth, MaxDepth;
+    if(GetJobDepthBounds(Tile->Depths, Job, &MinDepth, &MaxDepth))
+    {
+        CullJobLights(Frame, Thread, Job, MinDepth, MaxDepth);
+    }
+    else
+    {
+        Thread->Lights.Probe = &Frame->AmbientProbe;
+        Thread->Lights.Count = 0;
+    }
+    
+    if(IsCheckerboardHalfJob(Frame, Job))
+    {
+        Frame->Kernels->ShadeCheckerboard(Thread, Frame, Tile, Job->MinX, Job->MinY, Job->MaxX, Job->MaxY,
+                                          Frame->CheckerboardParity);
+        ReconstructCheckerboard(Frame, Tile, Job);
+    }
+    else
+    {
+        Frame->Kernels->ShadeVisibility(Thread, Frame, Tile, Job->MinX, Job->MinY, Job->MaxX, Job->MaxY);
+    }
+}
+
+// NOTE: The shading pass goes through the forward kernels at full rate, the fixed point,
+// calibration and coarse paths have no depth equal test
+internal void
+RenderDepthPrepassJob(render_frame* Frame, render_thread_context* Thread, render_job* Job)
+{
+    visibility_tile* Tile = Thread->VisibilityTile;
+    ClearJobPlane(Tile->Depths, Job, RASTER_CLEAR_DEPTH);
+    depth_plane Plane;
+    Plane.Depths = Tile->Depths;
+    Plane.OriginX = Job->MinX;
+    Plane.OriginY = Job->MinY;
+    Plane.Pitch = RASTER_TILE_SIZE;
+    
+#if SABLUJO_INTERNAL
+    uint64_t StartCycles = __rdtsc();
+    uint64_t StartFragments = Thread->FragmentsCount;
+#endif
+    uint32_t* TileTriangles = Frame->Tiles.Triangles + Frame->Tiles.TriangleOffsets[Job->TileIndex];
+    uint32_t* TileTrianglesEnd = Frame->Tiles.Triangles + Frame->Tiles.TriangleOffsets[Job->TileIndex + 1];
+    for(uint32_t* TriangleIndex = TileTriangles; TriangleIndex != TileTrianglesEnd; ++TriangleIndex)
+    {
+        raster_triangle* Triangle = Frame->Triangles + *TriangleIndex;
+        int32_t StartWidth = MAX(Triangle->MinX, Job->MinX);
+        int32_t StartHeight = MAX(Triangle->MinY, Job->MinY);
+        int32_t EndWidth = MIN(Triangle->MaxX, Job->MaxX);
+        int32_t EndHeight = MIN(Triangle->MaxY, Job->MaxY);
+        if(StartWidth > EndWidth || StartHeight > EndHeight)
+        {
+            continue;
+        }
+        
+        Frame->Kernels->RasterizeDepth(Thread, &Plane, StartWidth, StartHeight, EndWidth, EndHeight,
+                                       *TriangleIndex * 3, Frame->ScreenPositions, Frame->Depths,
+                                       Triangle->InvArea);
+    }
+#if SABLUJO_INTERNAL
+    Thread->Stats.PrepassCycles += __rdtsc() - StartCycles;
+    Thread->Stats.PrepassDepthFragments += (uint32_t)(Thread->FragmentsCount - StartFragments);
+#endif
+    
+    // NOTE: Unlike the forward mode the depth range is known here
+    float MinDepth, MaxDepth;
+    if(!GetJobDepthBounds(Tile->Depths, Job, &MinDepth, &MaxDepth))
+    {
+        return;
+    }
+    CullJobLights(Frame, Thread, Job, MinDepth, MaxDepth);
+    
+    vertex_streams Streams;
+    Streams.Positions = Frame->Positions;
+    Streams.Normals = Frame->Normals;
+    Streams.Colors = Frame->Colors;
+    Streams.TexCoords = Frame->TexCoords;
+    Streams.Depths = Frame->Depths;
+    Thread->DepthPrepass = &Plane;
+    for(uint32_t* TriangleIndex = TileTriangles; TriangleIndex != TileTrianglesEnd; ++TriangleIndex)
+    {
+        raster_triangle* Triangle = Frame->Triangles + *TriangleIndex;
+        int32_t StartWidth = MAX(Triangle->MinX, Job->MinX);
+        int32_t StartHeight = MAX(Triangle->MinY, Job->MinY);
+        int32_t EndWidth = MIN(Triangle->MaxX, Job->MaxX);
+        int32_t EndHeight = MIN(Triangle->MaxY, Job->MaxY);
+        if(StartWidth > EndWidth || StartHeight > EndHeight)
+        {
+            continue;
+        }
+        
+        Frame->Kernels->RasterizeTriangleShaded(Thread, Frame->Buffer, Triangle->Shader, Triangle->Shape, StartWidth, StartHeight, EndWidth, EndHeight, 
+                                                *TriangleIndex * 3, Frame->ScreenPositions, &Streams, GetTriangleMaterial(Frame, Triangle),
+                                                Triangle->InvArea);
+    }
+    Thread->DepthPrepass = 0;
+}
+
+// NOTE: Only fills the G-buffer, the lighting pass runs once every job of the frame is done
+internal void
+RenderGBufferJob(render_frame* Frame, render_thread_context* Thread, render_job* Job)
+{
+    gbuffer_tile* Tile = Frame->GBuffer + Job->TileIndex;
+    int32_t JobOffset = (Job->MinY - Tile->OriginY) * RASTER_TILE_SIZE + (Job->MinX - Tile->OriginX);
+    ClearJobPlane(Tile->Depths + JobOffset, Job, RASTER_CLEAR_DEPTH);
+    
+    uint32_t* TileTriangles = Frame->Tiles.Triangles + Frame->Tiles.TriangleOffsets[Job->TileIndex];
+    uint32_t* TileTrianglesEnd = Frame->Tiles.Triangles + Frame->Tiles.TriangleOffsets[Job->TileIndex + 1];
+    for(uint32_t* TriangleIndex = TileTriangles; TriangleIndex != TileTrianglesEnd; ++TriangleIndex)
+    {
+        raster_triangle* Triangle = Frame->Triangles + *TriangleIndex;
+        int32_t StartWidth = MAX(Triangle->MinX, Job->MinX);
+        int32_t StartHeight = MAX(Triangle->MinY, Job->MinY);
+        int32_t EndWidth = MIN(Triangle->MaxX, Job->MaxX);
+        int32_t EndHeight = MIN(Triangle->MaxY, Job->MaxY);
+        if(StartWidth > EndWidth || StartHeight > EndHeight)
+        {
+            continue;
+        }
+        
+        uint32_t MeshIndex = Triangle->VisibilityId >> VISIBILITY_TRIANGLE_BITS;
+        Frame->Kernels->RasterizeGBuffer(Thread, Tile, StartWidth, StartHeight, EndWidth, EndHeight,
+                                         *TriangleIndex * 3, Frame->ScreenPositions,
+                                         Frame->Positions, Frame->Normals, Frame->TexCoords, Frame->Depths,
+                                         Triangle->InvArea, MeshIndex, Frame->Materials[MeshIndex].DiffuseTexture);
+    }
+}
+
+internal void
+RenderJob(render_frame* Frame, render_thread_context* Thread, render_job* Job)
+{
+    uint64_t StartCycles = __rdtsc();
+    uint64_t StartFragments = Thread->FragmentsCount;
+    
+    if(Frame->IsLightingPass)
+    {
+        if(Job->TileIndex != RENDER_JOB_NO_TILE)
+        {
+            gbuffer_tile* Tile = Frame->GBuffer + Job->TileIndex;
+            int32_t JobOffset = (Job->MinY - Tile->OriginY) * RASTER_TILE_SIZE + (Job->MinX - Tile->OriginX);
+            float MinDepth, MaxDepth;
+            if(GetJobDepthBounds(Tile->Depths + JobOffset, Job, &MinDepth, &MaxDepth))
+            {
+                CullJobLights(Frame, Thread, Job, MinDepth, MaxDepth);
+                Frame->Kernels->ShadeGBuffer(Thread, Frame->Buffer, Tile, Frame->Materials,
+                                             Job->MinX, Job->MinY, Job->MaxX, Job->MaxY);
+            }
+        }
+    }
+    else if(Job->TileIndex == RENDER_JOB_NO_TILE)
+    {
+        ClearRegion(Frame->Buffer, Job->MinX, Job->MinY, Job->MaxX, Job->MaxY);
+    }
+    else if(Frame->RenderMode == RenderMode_VisibilityBuffer || Frame->RenderMode == RenderMode_Checkerboard)
+    {
+        // NOTE: Half shaded jobs write every pixel, the buffer holds the previous frame
+        if(!IsCheckerboardHalfJob(Frame, Job))
+        {
+            ClearRegion(Frame->Buffer, Job->MinX, Job->MinY, Job->MaxX, Job->MaxY);
+        }
+        RenderVisibilityJob(Frame, Thread, Job);
+    }
+    else if(Frame->RenderMode == RenderMode_Deferred)
+    {
+        ClearRegion(Frame->Buffer, Job->MinX, Job->MinY, Job->MaxX, Job->MaxY);
+        RenderGBufferJob(Frame, Thread, Job);
+    }
+    else if(Frame->RenderMode == RenderMode_DepthPrepass)
+    {
+        ClearRegion(Frame->Buffer, Job->MinX, Job->MinY, Job->MaxX, Job->MaxY);
+        RenderDepthPrepassJob(Frame, Thread, Job);
+    }
+    else
+    {
+        ClearRegion(Frame->Buffer, Job->MinX, Job->MinY, Job->MaxX, Job->MaxY);
+        // NOTE: Nothing bounds the depth without a depth buffer, only the side planes cull
+        CullJobLights(Frame, Thread, Job, 0.0f, INFINITY);
+        vertex_streams Streams;
+        Streams.Positions = Frame->Positions;
+        Streams.Normals = Frame->Normals;
+        Streams.Colors = Frame->Colors;
+        Streams.TexCoords = Frame->TexCoords;
+        uint32_t* TileTriangles = Frame->Tiles.Triangles + Frame->Tiles.TriangleOffsets[Job->TileIndex];
+        uint32_t* TileTrianglesEnd = Frame->Tiles.Triangles + Frame->Tiles.TriangleOffsets[Job->TileIndex + 1];
+        for(uint32_t* TriangleIndex = TileTriangles; TriangleIndex != TileTrianglesEnd; ++TriangleIndex)
+        {
+            raster_triangle* Triangle = Frame->Triangles + *TriangleIndex;
+            int32_t StartWidth = MAX(Triangle->MinX, Job->MinX);
+            int32_t StartHeight = MAX(Triangle->MinY, Job->MinY);
+            int32_t EndWidth = MIN(Triangle->MaxX, Job->MaxX);
+            int32_t EndHeight = MIN(Triangle->MaxY, Job->MaxY);
+            if(StartWidth > EndWidth || StartHeight > EndHeight)
+            {
+                continue;
+            }
+            
+            material* Material = GetTriangleMaterial(Frame, Triangle);
+            // NOTE: The fixed point, calibration and coarse paths all shade with Phong
+            if(Triangle->Shader != Shader_Phong)
+            {
+                Frame->Kernels->RasterizeTriangleShaded(Thread, Frame->Buffer, Triangle->Shader, Triangle->Shape, StartWidth, StartHeight, EndWidth, EndHeight, 
+                                                        *TriangleIndex * 3, Frame->ScreenPositions, &Streams, Material, Triangle->InvArea);
+            }
+            else if(Triangle->ShadingMode == ShadingMode_Fixed16 && Frame->Kernels->RasterizeTriangleFixed16 &&
+                    CanShadeFixed16(&Thread->Lights, Material))
+            {
+                Frame->Kernels->RasterizeTriangleFixed16(Thread, Frame->Buffer, Triangle->Shape, StartWidth, StartHeight, EndWidth, EndHeight, 
+                                                         *TriangleIndex * 3, Frame->ScreenPositions, Frame->Positions, Frame->Normals, Material, Triangle->InvArea);
+            }
+            else if(Frame->IsCalibratingBlockShapes)
+            {
+                CalibrateBlockShapes(Thread, Frame->Kernels, Frame->Buffer, Triangle, *TriangleIndex,
+                                     StartWidth, StartHeight, EndWidth, EndHeight,
+                                     Frame->ScreenPositions, Frame->Positions, Frame->Normals, Material);
+            }
+            else if(Frame->ShadingRates && Frame->Kernels->RasterizeTriangleCoarse)
+            {
+                RasterizeTriangleRated(Frame, Thread, Triangle, *TriangleIndex, StartWidth, StartHeight, EndWidth, EndHeight);
+            }
+            else
+            {
+                Frame->Kernels->RasterizeTriangle(Thread, Frame->Buffer, Triangle->Shape, StartWidth, StartHeight, EndWidth, EndHeight, 
+                                                  *TriangleIndex * 3, Frame->ScreenPositions, Frame->Positions, Frame->Normals, Material, Triangle->InvArea);
+            }
+        }
+    }
+    
+    if(Frame->ShadingRateHistory)
+    {
+        MeasureShadingContrasts(Frame, Job);
+    }
+    
+    uint64_t Cycles = __rdtsc() - StartCycles;
+    Job->Cycles += Cycles;
+    Job->FragmentsCount += (uint32_t)(Thread->FragmentsCount - StartFragments);
+    Thread->BusyCycles += Cycles;
+}
+
+internal void
+RenderWorker(platform_work_queue* Queue, uint32_t ThreadIndex, void* Data)
+{
+    render_frame* Frame = (render_frame*)Data;
+    Assert(ThreadIndex < Frame->WorkerCount);
+    render_thread_context* Thread = Frame->ThreadContexts + ThreadIndex;
+    
+    // Own jobs first, most expensive first
+    uint32_t JobIndex;
+    while(PopJob(Frame, Frame->WorkerQueues + ThreadIndex, true, &JobIndex))
+    {
+        RenderJob(Frame, Thread, Frame->Jobs + JobIndex);
+    }
+    
+    // Then steal the leftovers from the back of the other queues, workers sharing our cache first
+    for(uint32_t Pass = 0; Pass < 2; ++Pass)
+    {
+        for(uint32_t VictimOffset = 1; VictimOffset < Frame->WorkerCount; ++VictimOffset)
+        {
+            uint32_t VictimIndex = (ThreadIndex + VictimOffset) % Frame->WorkerCount;
+            bool IsSameDomain = Frame->WorkerDomains[VictimIndex] == Frame->WorkerDomains[ThreadIndex];
+            if(IsSameDomain != (Pass == 0))
+            {
+                continue;
+            }
+            
+            while(PopJob(Frame, Frame->WorkerQueues + VictimIndex, false, &JobIndex))
+            {
+                RenderJob(Frame, Thread, Frame->Jobs + JobIndex);
+#if SABLUJO_INTERNAL
+                ++Thread->Stats.JobsStolen;
+#endif
+            }
+        }
+    }
+}
+
+internal void
+UpdateTileHistory(render_tile_history* History, render_frame* Frame)
+{
+    // Record the tile costs for the next frame scheduling
+    triangle_bins* Tiles = &Frame->Tiles;
+    History->OriginX = Tiles->OriginX;
+    History->OriginY = Tiles->OriginY;
+    History->TileCountX = Tiles->TileCountX;
+    History->TileCountY = Tiles->TileCountY;
+    uint32_t TileCount = Tiles->TileCountX * Tiles->TileCountY;
+    for(uint32_t TileIndex = 0; TileIndex < TileCount; ++TileIndex)
+    {
+        History->Tiles[TileIndex] = {};
+        History->Tiles[TileIndex].TrianglesCount = Tiles->TriangleOffsets[TileIndex + 1] - Tiles->TriangleOffsets[TileIndex];
+    }
+    
+    uint64_t TotalCycles = 0;
+    uint64_t TotalFragments = 0;
+    for(uint32_t JobIndex = 0; JobIndex < Frame->JobsCount; ++JobIndex)
+    {
+        render_job* Job = Frame->Jobs + JobIndex;
+        uint32_t FirstTile = ((Job->MinY - Tiles->OriginY) / RASTER_TILE_SIZE) * Tiles->TileCountX + (Job->MinX - Tiles->OriginX) / RASTER_TILE_SIZE;
+        for(uint32_t TileIndex = FirstTile; TileIndex < FirstTile + Job->TileCount; ++TileIndex)
+        {
+            History->Tiles[TileIndex].Cycles += Job->Cycles / Job->TileCount;
+            History->Tiles[TileIndex].FragmentsCount += Job->FragmentsCount / Job->TileCount;
+        }
+        TotalCycles += Job->Cycles;
+        TotalFragments += Job->FragmentsCount;
+    }
+    if(TotalFragments)
+    {
+        History->CyclesPerFragment = (float)TotalCycles / (float)TotalFragments;
+    }
+}
+
+// NOTE: Re-arms every worker queue with the jobs ScheduleJobs gave it, so a frame can run
+// its jobs more than once
+internal void
+RunRenderWorkers(game_memory* Memory, render_frame* Frame)
+{
+    for(uint32_t WorkerIndex = 0; WorkerIndex < Frame->WorkerCount; ++WorkerIndex)
+    {
+        render_worker_queue* Queue = Frame->WorkerQueues + WorkerIndex;
+        Queue->HeadTail = (uint64_t)Queue->JobsCount << 32;
+    }
+    
+    if(Memory->RenderQueue && Frame->WorkerCount > 1)
+    {
+        for(uint32_t WorkerIndex = 0; WorkerIndex < Frame->WorkerCount; ++WorkerIndex)
+        {
+            Memory->Platform.AddEntry(Memory->RenderQueue, RenderWorker, Frame);
+        }
+        Memory->Platform.CompleteAllWork(Memory->RenderQueue);
+    }
+    else
+    {
+        RenderWorker(0, 0, Frame);
+    }
+}
+
+void
+RenderFrame(memory_arena* Arena, game_memory* Memory, game_state* GameState, render_frame* Frame,
+            game_offscreen_buffer* Buffer, uint32_t* TriangleIndices, uint32_t TrianglesCount)
+{
+    Frame->Buffer = Buffer;
+    InitializeBins(&Frame->Tiles, Buffer->OriginX, Buffer->OriginY, Buffer->Width, Buffer->Height, RASTER_TILE_SIZE);
+    Assert(Frame->Tiles.TileCountX * Frame->Tiles.TileCountY <= MAX_RENDER_TILE_COUNT);
+    BinTriangles(Arena, Frame->Triangles, &Frame->Tiles, TriangleIndices, TriangleIndices ? TrianglesCount : Frame->TrianglesCount);
+    ScheduleJobs(Arena, Frame, &GameState->TileHistory);
+    
+    if(Frame->RenderMode == RenderMode_Deferred)
+    {
+        uint32_t TileCount = Frame->Tiles.TileCountX * Frame->Tiles.TileCountY;
+        Frame->GBuffer = (gbuffer_tile*)PushSize_(Arena, TileCount * sizeof(gbuffer_tile), 64);
+        for(int32_t TileY = 0; TileY < Frame->Tiles.TileCountY; ++TileY)
+        {
+            for(int32_t TileX = 0; TileX < Frame->Tiles.TileCountX; ++TileX)
+            {
+                gbuffer_tile* Tile = Frame->GBuffer + TileY * Frame->Tiles.TileCountX + TileX;
+                Tile->OriginX = Frame->Tiles.OriginX + TileX * RASTER_TILE_SIZE;
+                Tile->OriginY = Frame->Tiles.OriginY + TileY * RASTER_TILE_SIZE;
+            }
+        }
+    }
+    
+    // NOTE: Half of the pixels come from the previous frame only when it was a checkerboard
+    // frame of the whole image in this same buffer
+    checkerboard_history* History = &GameState->CheckerboardHistory;
+    bool IsWholeImage = (Buffer->OriginX == 0 && Buffer->OriginY == 0 &&
+                         Buffer->Width == Frame->ImageWidth && Buffer->Height == Frame->ImageHeight);
+    if(Frame->RenderMode == RenderMode_Checkerboard && IsWholeImage)
+    {
+        Frame->IsCheckerboardHalf = (History->IsValid && History->Memory == Buffer->Memory &&
+                                     History->Width == Buffer->Width && History->Height == Buffer->Height);
+        Frame->CheckerboardParity = History->Parity ^ 1;
+        History->Memory = Buffer->Memory;
+        History->Width = Buffer->Width;
+        History->Height = Buffer->Height;
+        History->Parity = Frame->CheckerboardParity;
+        History->IsValid = true;
+    }
+    else
+    {
+        History->IsValid = false;
+    }
+    
+    uint64_t StartCycles = __rdtsc();
+    Frame->IsLightingPass = false;
+    RunRenderWorkers(Memory, Frame);
+    if(Frame->RenderMode == RenderMode_Deferred)
+    {
+        // NOTE: The whole G-buffer is complete here, screen space passes would go in between
+        Frame->IsLightingPass = true;
+        RunRenderWorkers(Memory, Frame);
+    }
+    Frame->RenderCycles += __rdtsc() - StartCycles;
+    
+    UpdateTileHistory(&GameState->TileHistory, Frame);
+}
+
+void
+EndRenderFrame(game_memory* Memory, game_state* GameState, render_frame* Frame)
+{
+    block_shape_calibration* Calibration = &GameState->BlockShapeCalibration;
+    for(uint32_t ThreadIndex = 0; ThreadIndex < Frame->WorkerCount; ++ThreadIndex)
+    {
+        render_thread_context* Thread = Frame->ThreadContexts + ThreadIndex;
+#if SABLUJO_INTERNAL
+        render_stats* Stats = &GameState->RenderStats;
+        Stats->PixelsSkipped += Thread->Stats.PixelsSkipped;
+        Stats->PixelsComputed += Thread->Stats.PixelsComputed;
+        Stats->PixelsWasted += Thread->Stats.PixelsWasted;
+        Stats->JobsStolen += Thread->Stats.JobsStolen;
+        Stats->JobLightsCount += Thread->Stats.JobLightsCount;
+        Stats->TextureBlockLookups += Thread->TextureCache->Lookups;
+        Stats->TextureBlocksDecoded += Thread->TextureCache->Decodes;
+        Stats->PrepassDepthFragments += Thread->Stats.PrepassDepthFragments;
+        Stats->PrepassCycles += Thread->Stats.PrepassCycles;
+        Stats->PrepassFragmentsTested += Thread->Stats.PrepassFragmentsTested;
+        Stats->PrepassFragmentsShaded += Thread->Stats.PrepassFragmentsShaded;
+#endif
+        if(Frame->IsCalibratingBlockShapes)
+        {
+            for(uint32_t Bucket = 0; Bucket < BLOCK_SHAPE_ASPECT_BUCKET_COUNT; ++Bucket)
+            {
+                Calibration->TrianglesCount[Bucket] += Thread->Calibration.TrianglesCount[Bucket];
+                for(uint32_t Shape = 0; Shape < BlockShape_Count; ++Shape)
+                {
+                    Calibration->Cycles[Shape][Bucket] += Thread->Calibration.Cycles[Shape][Bucket];
+#if SABLUJO_INTERNAL
+                    Calibration->PixelsWasted[Shape][Bucket] += Thread->Calibration.PixelsWasted[Shape][Bucket];
+#endif
+                }
+            }
+        }
+    }
+#if SABLUJO_INTERNAL
+    GameState->RenderStats.JobsCount = Frame->JobsCount;
+#endif
+    
+    if(Frame->IsCalibratingBlockShapes && --Calibration->FramesRemaining == 0)
+    {
+        UpdateBlockShapeThresholds(Calibration, &GameState->BlockShapeThresholds);
+        SaveBlockShapeThresholds(Memory, Frame->Kernels, &GameState->BlockShapeThresholds);
+#if SABLUJO_INTERNAL
+        PrintBlockShapeCalibration(Memory, Frame->Kernels, Calibration, &GameState->BlockShapeThresholds);
+#endif
+    }
+    
+#if SABLUJO_INTERNAL
+    uint32_t PixelsComputed = GameState->RenderStats.PixelsComputed;
+    uint32_t PixelsWasted = GameState->RenderStats.PixelsWasted;
+    int32_t (*BlockShapeSizes)[2] = Frame->Kernels->BlockShapeSizes;
+    char StatsMessage [512];
+    
+    Memory->Platform.DEBUGFormatString(StatsMessage,
+                                       sizeof(StatsMessage),
+                                       "Raster tier: %s\nRender jobs: %d (%d stolen)\nTriangles per shape (%dx%d/%dx%d/%dx%d): %d/%d/%d\nPixels Skipped: %d\nPixels Computed: %d\nPixels Computation Wasted: %d(%.3f%%)\nLights per job: %.1f of %d\nTexture blocks decoded: %d of %d lookups\n" , 
+                                       Frame->Kernels->Name,
+                                       GameState->RenderStats.JobsCount, GameState->RenderStats.JobsStolen,
+                                       BlockShapeSizes[BlockShape_Wide][0], BlockShapeSizes[BlockShape_Wide][1],
+                                       BlockShapeSizes[BlockShape_Square][0], BlockShapeSizes[BlockShape_Square][1],
+                                       BlockShapeSizes[BlockShape_Tall][0], BlockShapeSizes[BlockShape_Tall][1],
+                                       GameState->RenderStats.TrianglesPerShape[BlockShape_Wide],
+                                       GameState->RenderStats.TrianglesPerShape[BlockShape_Square],
+                                       GameState->RenderStats.TrianglesPerShape[BlockShape_Tall],
+                                       GameState->RenderStats.PixelsSkipped, 
+                                       PixelsComputed, 
+                                       PixelsWasted,
+                                       100.0f * (float)PixelsWasted / (float)PixelsComputed,
+                                       (float)GameState->RenderStats.JobLightsCount / (float)MAX(Frame->JobsCount, 1),
+                                       Frame->Lights->Count,
+                                       GameState->RenderStats.TextureBlocksDecoded,
+                                       GameState->RenderStats.TextureBlockLookups);
+    Memory->Platform.DEBUGPrintLine(StatsMessage);
+    
+    if(Frame->Shadow)
+    {
+        // NOTE: Against the cost of a shaded fragment measured by the tile history
+        char ShadowMessage[256];
+        float ShadowCyclesPerFragment = (float)Frame->ShadowCycles / (float)MAX(Frame->ShadowFragmentsCount, 1);
+        Memory->Platform.DEBUGFormatString(ShadowMessage, sizeof(ShadowMessage),
+                                           "Shadow pass: %d triangles, %.1f cycles per fragment (%.1f shaded)\n",
+                                           GameState->RenderStats.ShadowTrianglesCount, ShadowCyclesPerFragment,
+                                           GameState->TileHistory.CyclesPerFragment);
+        Memory->Platform.DEBUGPrintLine(ShadowMessage);
+    }
+    
+    if(Frame->RenderMode == RenderMode_DepthPrepass)
+    {
+        // NOTE: The shading saved is the overdraw the forward mode would have shaded, paid for
+        // with the depth pass share of the render time
+        render_stats* Stats = &GameState->RenderStats;
+        uint64_t BusyCycles = 0;
+        for(uint32_t ThreadIndex = 0; ThreadIndex < Frame->WorkerCount; ++ThreadIndex)
+        {
+            BusyCycles += Frame->ThreadContexts[ThreadIndex].BusyCycles;
+        }
+        char PrepassMessage[256];
+        Memory->Platform.DEBUGFormatString(PrepassMessage, sizeof(PrepassMessage),
+                                           "Depth prepass: %d of %d fragments shaded (%d saved), depth pass %d fragments in %.1f%% of the job cycles\n",
+                                           Stats->PrepassFragmentsShaded, Stats->PrepassFragmentsTested,
+                                           Stats->PrepassFragmentsTested - Stats->PrepassFragmentsShaded,
+                                           Stats->PrepassDepthFragments,
+                                           100.0f * (float)Stats->PrepassCycles / (float)MAX(BusyCycles, 1));
+        Memory->Platform.DEBUGPrintLine(PrepassMessage);
+    }
+    
+    // NOTE: Share of the frame render time each worker spent on jobs
+    char UtilizationMessage[1024];
+    int32_t UtilizationLength = Memory->Platform.DEBUGFormatString(UtilizationMessage, sizeof(UtilizationMessage),
+                                                                    "Worker utilization (%d domains):",
+                                                                    Frame->DomainsCount);
+    for(uint32_t ThreadIndex = 0; ThreadIndex < Frame->WorkerCount; ++ThreadIndex)
+    {
+        render_thread_context* Thread = Frame->ThreadContexts + ThreadIndex;
+        float Utilization = Frame->RenderCycles ? (float)Thread->BusyCycles / (float)Frame->RenderCycles : 0.0f;
+        UtilizationLength += Memory->Platform.DEBUGFormatString(UtilizationMessage + UtilizationLength,
+                                                                sizeof(UtilizationMessage) - UtilizationLength,
+                                                                " %d:%.0f%%", ThreadIndex, 100.0f * Utilization);
+    }
+    Memory->Platform.DEBUGFormatString(UtilizationMessage + UtilizationLength,
+                                       sizeof(UtilizationMessage) - UtilizationLength, "\n");
+    Memory->Platform.DEBUGPrintLine(UtilizationMessage);
+#endif
+}
@@ -0,0 +1,492 @@
+#if !defined(SABLUJO_RENDER_H)
+
+#include "sablujo.h"
+
+// NOTE: Hot tiles are split in quadrants until they are cheap enough or this small, it must
+// stay a multiple of every block shape size so blocks never straddle two jobs
+#define RENDER_JOB_MIN_SIZE 16
+// NOTE: Jobs more expensive than a fraction of a worker's share of the frame get split
+#define RENDER_JOBS_PER_WORKER 4
+
+// NOTE: Only used until a frame measured the real cost
+#define RENDER_DEFAULT_CYCLES_PER_FRAGMENT 100.0f
+
+#define RENDER_JOB_NO_TILE UINT32_MAX
+
+// NOTE: Largest step of a color channel between neighbouring pixels of a screen tile, in 8-bit
+// sRGB steps, under which the Auto mode shades it coarser next frame
+#define SHADING_RATE_4X4_MAX_CONTRAST 2
+#define SHADING_RATE_2X2_MAX_CONTRAST 8
+
+// NOTE: Visibility ids pack the mesh in the top byte and the triangle within the mesh below,
+// valid ids keep the top bit clear so they compare above the empty id as signed lanes
+#define MAX_FRAME_MESH_COUNT 128
+#define VISIBILITY_TRIANGLE_BITS 24
+#define VISIBILITY_EMPTY_ID UINT32_MAX
+
+// NOTE: Depth buffers hold the bits of the inverse depth, positive floats that order like
+// integers. Clear is behind everything.
+#define RASTER_CLEAR_DEPTH 0
+
+struct raster_triangle
+{
+    // Clipped screen bounds, inclusive
+    int32_t MinX;
+    int32_t MinY;
+    int32_t MaxX;
+    int32_t MaxY;
+    float InvArea;
+    block_shape_type Shape;
+    uint32_t AspectBucket;
+    shading_mode ShadingMode;
+    shader_type Shader;
+    uint32_t VisibilityId;
+};
+
+struct render_job
+{
+    // Screen region, inclusive, never larger than a tile
+    int32_t MinX;
+    int32_t MinY;
+    int32_t MaxX;
+    int32_t MaxY;
+    
+    // Bin to read the triangles from, RENDER_JOB_NO_TILE for merged empty tiles
+    uint32_t TileIndex;
+    // Consecutive tiles of a row covered by the job, only merged empty tiles have more than one
+    uint32_t TileCount;
+    
+    uint64_t PredictedCycles;
+    // NOTE: Summed over the passes of the frame
+    uint64_t Cycles;
+    uint32_t FragmentsCount;
+};
+
+// NOTE: Head and tail are packed in a single value, the owner pops the most expensive jobs from
+// the front while thieves take the cheap leftovers from the back, both with one compare exchange
+struct render_worker_queue
+{
+    uint64_t volatile HeadTail;
+    uint32_t FirstJob;
+    uint32_t JobsCount;
+    uint64_t PredictedCycles;
+};
+
+// NOTE: Triangle lists for a grid of square tiles, in image pixels. Used for the raster
+// tiles of a render and for the coarse chunks of an offline render
+struct triangle_bins
+{
+    int32_t OriginX;
+    int32_t OriginY;
+    // Last pixel binned, inclusive, the last row and column of tiles can be partial
+    int32_t EndX;
+    int32_t EndY;
+    int32_t TileSize;
+    int32_t TileCountX;
+    int32_t TileCountY;
+    
+    // TriangleOffsets has one more entry than there are tiles
+    uint32_t* TriangleOffsets;
+    uint32_t* Triangles;
+    uint32_t* EstimatedFragments;
+};
+
+// NOTE: Irradiance from the distant lights in L2 spherical harmonics, one plane per channel.
+// The convolution with the clamped cosine and the basis constants are folded in, so evaluating
+// a normal is 9 multiply-adds per channel on 1, y, z, x, xy, yz, 3z^2 - 1, xz, x^2 - y^2.
+#define SH_COEFFICIENT_COUNT 9
+struct sh_probe
+{
+    float CoefficientsX[SH_COEFFICIENT_COUNT];
+    float CoefficientsY[SH_COEFFICIENT_COUNT];
+    float CoefficientsZ[SH_COEFFICIENT_COUNT];
+};
+
+// NOTE: Must be a multiple of the raster tile size
+#define SHADOW_MAP_SIZE 1024
+// NOTE: Relative to the inverse depth. Only the faces turned away from the light are in the
+// map, the lit surfaces sit well in front of it but along the terminator
+#define SHADOW_DEPTH_BIAS 0.02f
+
+// NOTE: Inverse depth seen from one light through a perspective fitted around the shadow
+// casters. A world position P lands on texel (dot(D, AxisX) / z, dot(D, AxisY) / z) + Center
+// with D = P - Origin and z = dot(D, AxisZ), AxisX and AxisY carry the texels per unit slope.
+struct shadow_map
+{
+    uint32_t Light;
+    bool IsFiltered;
+    vector3 Origin;
+    vector3 AxisX;
+    vector3 AxisY;
+    vector3 AxisZ;
+    float Center;
+    // NOTE: SHADOW_MAP_SIZE rows, in the depth buffer encoding
+    uint32_t* Depths;
+};
+
+// NOTE: Lights that can reach some pixel of a job, as indices into the scene lights
+struct light_list
+{
+    scene_lights* Lights;
+    sh_probe* Probe;
+    // NOTE: Null when no light casts shadows
+    shadow_map* Shadow;
+    uint32_t Count;
+    uint16_t Indices[MAX_SCENE_LIGHT_COUNT];
+};
+
+// NOTE: Inverse depths of a depth only pass, Pitch in pixels from the first pixel at the origin
+struct depth_plane
+{
+    uint32_t* Depths;
+    int32_t OriginX;
+    int32_t OriginY;
+    int32_t Pitch;
+};
+
+// NOTE: Inverse depth and visibility id of the job being rendered, the origin is the job corner
+// and the pitch is a whole tile
+struct visibility_tile
+{
+    int32_t OriginX;
+    int32_t OriginY;
+    uint32_t Depths[RASTER_TILE_SIZE * RASTER_TILE_SIZE];
+    uint32_t Ids[RASTER_TILE_SIZE * RASTER_TILE_SIZE];
+};
+
+// NOTE: One per raster tile of the frame, each attribute in its own plane so a row of lanes
+// loads and stores in one go. Positions and normals keep the vertex outputs half precision.
+struct gbuffer_tile
+{
+    int32_t OriginX;
+    int32_t OriginY;
+    uint32_t Depths[RASTER_TILE_SIZE * RASTER_TILE_SIZE];
+    uint16_t PositionsX[RASTER_TILE_SIZE * RASTER_TILE_SIZE];
+    uint16_t PositionsY[RASTER_TILE_SIZE * RASTER_TILE_SIZE];
+    uint16_t PositionsZ[RASTER_TILE_SIZE * RASTER_TILE_SIZE];
+    uint16_t NormalsX[RASTER_TILE_SIZE * RASTER_TILE_SIZE];
+    uint16_t NormalsY[RASTER_TILE_SIZE * RASTER_TILE_SIZE];
+    uint16_t NormalsZ[RASTER_TILE_SIZE * RASTER_TILE_SIZE];
+    // NOTE: Linear diffuse texture color, textures are sampled while the G-buffer is written
+    uint16_t AlbedosX[RASTER_TILE_SIZE * RASTER_TILE_SIZE];
+    uint16_t AlbedosY[RASTER_TILE_SIZE * RASTER_TILE_SIZE];
+    uint16_t AlbedosZ[RASTER_TILE_SIZE * RASTER_TILE_SIZE];
+    // NOTE: Index of the mesh in the frame, picks the material when lighting
+    uint32_t MeshIndices[RASTER_TILE_SIZE * RASTER_TILE_SIZE];
+};
+
+// NOTE: Decoded 4x4 blocks of the compressed textures, direct mapped on the block address so
+// the blocks around the last samples stay resident. A lane whose slot is claimed by another
+// block in the same gather decodes into a spill block of its own instead.
+#define TEXTURE_CACHE_SIZE 64
+#define TEXTURE_CACHE_SPILL_COUNT 16
+struct texture_cache
+{
+    uint32_t Texels[TEXTURE_CACHE_SIZE + TEXTURE_CACHE_SPILL_COUNT][16];
+    uint8_t* Tags[TEXTURE_CACHE_SIZE];
+    // NOTE: Gather that last used each slot
+    uint32_t Stamps[TEXTURE_CACHE_SIZE];
+    uint32_t Stamp;
+#if SABLUJO_INTERNAL
+    uint32_t Lookups;
+    uint32_t Decodes;
+#endif
+};
+
+struct render_thread_context
+{
+#if SABLUJO_INTERNAL
+    render_stats Stats;
+#endif
+    block_shape_calibration Calibration;
+    uint64_t FragmentsCount;
+    uint64_t BusyCycles;
+    // NOTE: Only allocated in the visibility buffer, checkerboard and depth prepass modes
+    visibility_tile* VisibilityTile;
+    // NOTE: Culled for the job being rendered, before its pixels are shaded
+    light_list Lights;
+    // NOTE: Starts empty every frame
+    texture_cache* TextureCache;
+    // NOTE: Set while the shading pass of a depth prepass job runs, null otherwise
+    depth_plane* DepthPrepass;
+};
+
+// NOTE: Region bounds are inclusive and must stay within one raster tile
+typedef void rasterize_triangle(render_thread_context* Thread,
+                                game_offscreen_buffer* Buffer,
+                                block_shape_type Shape,
+                                int32_t StartWidth, int32_t StartHeight,
+                                int32_t EndWidth, int32_t EndHeight,
+                                uint32_t IndexOffset,
+                                vector2i* ScreenPositions,
+                                vector3h* Positions,
+                                vector3h* Normals,
+                                material* Material,
+                                float InvArea);
+
+// NOTE: Rounds Count vectors to half precision, the padding lanes are written as whatever
+// the conversion makes of them
+typedef void pack_halves(vector3* Source, vector3h* Dest, uint32_t Count);
+
+// NOTE: Same region rules, the rate must be coarser than 1x1 and constant over the region. Left
+// null by tiers too narrow for it.
+typedef void rasterize_triangle_coarse(render_thread_context* Thread,
+                                       game_offscreen_buffer* Buffer,
+                                       shading_rate Rate,
+                                       int32_t StartWidth, int32_t StartHeight,
+                                       int32_t EndWidth, int32_t EndHeight,
+                                       uint32_t IndexOffset,
+                                       vector2i* ScreenPositions,
+                                       vector3h* Positions,
+                                       vector3h* Normals,
+                                       material* Material,
+                                       float InvArea);
+
+// NOTE: Vertex stage outputs the shaders read from, 3 per triangle like the screen positions
+struct vertex_streams
+{
+    vector3h* Positions;
+    vector3h* Normals;
+    vector3h* Colors;
+    vector3* TexCoords;
+    // NOTE: Only read by the depth equal test after a prepass
+    float* Depths;
+};
+
+// NOTE: Same region rules, the loop is specialized per shader
+typedef void rasterize_triangle_shaded(render_thread_context* Thread,
+                                       game_offscreen_buffer* Buffer,
+                                       shader_type Shader,
+                                       block_shape_type Shape,
+                                       int32_t StartWidth, int32_t StartHeight,
+                                       int32_t EndWidth, int32_t EndHeight,
+                                       uint32_t IndexOffset,
+                                       vector2i* ScreenPositions,
+                                       vertex_streams* Streams,
+                                       material* Material,
+                                       float InvArea);
+
+// NOTE: Lights Count vertices with the fragment lighting into linear half precision colors, one
+// plane per channel. Count must be a multiple of the lane width of every tier.
+typedef void light_vertices(vector3* Positions, vector3* Normals, uint32_t Count,
+                            material* Material, light_list* Lights,
+                            uint16_t* ColorsX, uint16_t* ColorsY, uint16_t* ColorsZ);
+
+// NOTE: Depth tests the triangle against the tile in wide blocks, the block shape only pays
+// off when the pixels are shaded
+typedef void rasterize_visibility(render_thread_context* Thread,
+                                  visibility_tile* Tile,
+                                  int32_t StartWidth, int32_t StartHeight,
+                                  int32_t EndWidth, int32_t EndHeight,
+                                  uint32_t IndexOffset,
+                                  vector2i* ScreenPositions,
+                                  float* Depths,
+                                  float InvArea,
+                                  uint32_t VisibilityId);
+
+// NOTE: RasterizeRegion with only the inverse depth interpolated and tested, no varyings and
+// no fragment stage. Wide blocks like the visibility pass.
+typedef void rasterize_depth(render_thread_context* Thread,
+                             depth_plane* Plane,
+                             int32_t StartWidth, int32_t StartHeight,
+                             int32_t EndWidth, int32_t EndHeight,
+                             uint32_t IndexOffset,
+                             vector2i* ScreenPositions,
+                             float* Depths,
+                             float InvArea);
+
+struct render_frame;
+// NOTE: Shades the visible pixels of a region of the tile to the frame buffer
+typedef void shade_visibility(render_thread_context* Thread,
+                              render_frame* Frame,
+                              visibility_tile* Tile,
+                              int32_t MinX, int32_t MinY,
+                              int32_t MaxX, int32_t MaxY);
+
+// NOTE: Shades the visible pixels of one checkerboard parity, see ShadeCheckerboard
+typedef void shade_checkerboard(render_thread_context* Thread,
+                                render_frame* Frame,
+                                visibility_tile* Tile,
+                                int32_t MinX, int32_t MinY,
+                                int32_t MaxX, int32_t MaxY,
+                                uint32_t Parity);
+
+// NOTE: Depth tests in wide blocks too, only the closest fragments reach the G-buffer
+typedef void rasterize_gbuffer(render_thread_context* Thread,
+                               gbuffer_tile* Tile,
+                               int32_t StartWidth, int32_t StartHeight,
+                               int32_t EndWidth, int32_t EndHeight,
+                               uint32_t IndexOffset,
+                               vector2i* ScreenPositions,
+                               vector3h* Positions,
+                               vector3h* Normals,
+                               vector3* TexCoords,
+                               float* Depths,
+                               float InvArea,
+                               uint32_t MeshIndex,
+                               texture* Texture);
+
+typedef void shade_gbuffer(render_thread_context* Thread,
+                           game_offscreen_buffer* Buffer,
+                           gbuffer_tile* Tile,
+                           material* Materials,
+                           int32_t MinX, int32_t MinY,
+                           int32_t MaxX, int32_t MaxY);
+
+// NOTE: The raster kernels of one instruction set tier, see sablujo_raster.cpp
+struct raster_kernels
+{
+    raster_tier Tier;
+    const char* Name;
+    int32_t BlockShapeSizes[BlockShape_Count][2];
+    rasterize_triangle* RasterizeTriangle;
+    rasterize_triangle_coarse* RasterizeTriangleCoarse;
+    // NOTE: Null when the tier has no fixed point shading, ignores the block shape. Only shades
+    // a single unshadowed light, see CanShadeFixed16
+    rasterize_triangle* RasterizeTriangleFixed16;
+    rasterize_triangle_shaded* RasterizeTriangleShaded;
+    light_vertices* LightVertices;
+    pack_halves* PackHalves;
+    rasterize_visibility* RasterizeVisibility;
+    rasterize_depth* RasterizeDepth;
+    shade_visibility* ShadeVisibility;
+    shade_checkerboard* ShadeCheckerboard;
+    rasterize_gbuffer* RasterizeGBuffer;
+    shade_gbuffer* ShadeGBuffer;
+};
+
+namespace lane16 { void GetRasterKernels(raster_kernels* Kernels); }
+namespace lane8 { void GetRasterKernels(raster_kernels* Kernels); }
+namespace lane4 { void GetRasterKernels(raster_kernels* Kernels); }
+namespace lane1 { void GetRasterKernels(raster_kernels* Kernels); }
+
+struct render_frame
+{
+    // NOTE: The vertex stage projects to the whole image, Buffer is the part of it being rendered
+    int32_t ImageWidth;
+    int32_t ImageHeight;
+    game_offscreen_buffer* Buffer;
+    camera* Camera;
+    raster_kernels* Kernels;
+    block_shape_thresholds* BlockShapeThresholds;
+    bool IsCalibratingBlockShapes;
+    render_mode RenderMode;
+    
+    // Vertex stage outputs, 3 per triangle, the attributes in half precision
+    uint32_t TrianglesCapacity;
+    uint32_t TrianglesCount;
+    vector2i* ScreenPositions;
+    vector3h* Positions;
+    vector3h* Normals;
+    // NOTE: Only written for the vertex lit meshes, left null outside of the forward mode
+    vector3h* Colors;
+    // NOTE: Only written for the textured meshes. U / z, V / z and 1 / z, they interpolate
+    // linearly on screen, in full precision since half would be off by whole texels.
+    vector3* TexCoords;
+    // NOTE: Left null in the forward mode
+    float* Depths;
+    raster_triangle* Triangles;
+    
+    // First triangle of each mesh pushed, visibility ids are relative to it
+    uint32_t MeshesCount;
+    uint32_t MeshFirstTriangles[MAX_FRAME_MESH_COUNT];
+    // NOTE: Copied when the mesh is pushed, the uniforms of its draw
+    material Materials[MAX_FRAME_MESH_COUNT];
+    
+    // NOTE: Jobs cull the lights against their frustum with the view space centers. The
+    // vertex lit meshes are not lit per job, they take every light.
+    scene_lights* Lights;
+    float* LightViewX;
+    float* LightViewY;
+    float* LightViewZ;
+    light_list AllLights;
+    sh_probe AmbientProbe;
+    // NOTE: Null without shadows, see RenderShadowMap
+    shadow_map* Shadow;
+    uint64_t ShadowCycles;
+    uint64_t ShadowFragmentsCount;
+    
+    // NOTE: One shading_rate per screen tile of the whole image, null shades every pixel.
+    // With a history the rates are picked again from each job once it is rendered.
+    uint8_t* ShadingRates;
+    int32_t ShadingRateCountX;
+    shading_rate_history* ShadingRateHistory;
+    
+    // Raster tiles covering Buffer
+    triangle_bins Tiles;
+    // NOTE: One tile per raster tile in the deferred mode, lit once all of them are written
+    gbuffer_tile* GBuffer;
+    bool IsLightingPass;
+    
+    // NOTE: Without a history the checkerboard mode shades every pixel
+    bool IsCheckerboardHalf;
+    uint32_t CheckerboardParity;
+    
+    uint32_t JobsCount;
+    render_job* Jobs;
+    // Job indices grouped by worker, each group sorted most expensive first
+    uint32_t* WorkerJobs;
+    
+    uint32_t WorkerCount;
+    // Cache domains remapped to 0..DomainsCount-1
+    uint32_t DomainsCount;
+    uint32_t WorkerDomains[MAX_RENDER_THREAD_COUNT];
+    uint32_t DomainWorkersCount[MAX_RENDER_THREAD_COUNT];
+    uint64_t RenderCycles;
+    render_worker_queue WorkerQueues[MAX_RENDER_THREAD_COUNT];
+    render_thread_context ThreadContexts[MAX_RENDER_THREAD_COUNT];
+};
+
+// NOTE: Workers take the map tiles in order until there are none left
+struct shadow_pass
+{
+    render_frame* Frame;
+    shadow_map* Map;
+    triangle_bins Bins;
+    raster_triangle* Triangles;
+    vector2i* ScreenPositions;
+    float* Depths;
+    uint32_t volatile NextTile;
+    uint64_t WorkerCycles[MAX_RENDER_THREAD_COUNT];
+    uint64_t WorkerFragments[MAX_RENDER_THREAD_COUNT];
+};
+
+void InitializeBlockShapeThresholds(block_shape_thresholds* Thresholds);
+// NOTE: The thresholds of the last calibration on this tier, the defaults without one
+void LoadBlockShapeThresholds(game_memory* Memory, block_shape_thresholds* Thresholds);
+
+// NOTE: Without AllowCalibration the frame renders with the current block shape thresholds
+// and does not count down the calibration
+render_frame* BeginRenderFrame(memory_arena* Arena, game_memory* Memory, game_state* GameState,
+                               camera* Camera, int32_t ImageWidth, int32_t ImageHeight, uint32_t IndicesCount,
+                               bool AllowCalibration);
+// NOTE: The arena is only used as scratch, it can be the one the frame was begun with
+void PushMesh(memory_arena* Arena, render_frame* Frame, game_state* GameState, mesh* Mesh);
+// NOTE: Reorders the meshes into the order they should be pushed, by shader, material and
+// depth front to back, or back to front in the forward mode which has no depth test
+void SortMeshDraws(memory_arena* Arena, render_frame* Frame, game_state* GameState, mesh** Meshes, uint32_t Count);
+// NOTE: Rates cover the image in SHADING_RATE_TILE_SIZE tiles, they must outlive the frame.
+// Replaces the rates of the Auto mode.
+void SetShadingRateImage(render_frame* Frame, uint8_t* Rates, int32_t TileCountX, int32_t TileCountY);
+// NOTE: Renders the shadow map of the key light from the casters, which don't have to be
+// pushed. It goes before the meshes are pushed so the vertex lit ones are shadowed too.
+void RenderShadowMap(memory_arena* Arena, game_memory* Memory, render_frame* Frame,
+                     mesh** Casters, uint32_t CastersCount, bool IsFiltered);
+triangle_bins* BinFrameTriangles(memory_arena* Arena, render_frame* Frame, int32_t TileSize);
+// NOTE: Renders the part of the image covered by Buffer, TriangleIndices can restrict the
+// triangles considered, null renders all of them. Can be called several times per frame.
+void RenderFrame(memory_arena* Arena, game_memory* Memory, game_state* GameState, render_frame* Frame,
+                 game_offscreen_buffer* Buffer, uint32_t* TriangleIndices, uint32_t TrianglesCount);
+void EndRenderFrame(game_memory* Memory, game_state* GameState, render_frame* Frame);
+
+// NOTE: Number of texels of a whole mip chain, see texture
+uint32_t GetTextureTexelCount(uint32_t LogSize);
+uint32_t* GetTextureTexel(texture* Texture, uint32_t Level, uint32_t X, uint32_t Y);
+// NOTE: Fills every level from level 0, averaging in linear space
+void BuildTextureMips(texture* Texture);
+uint32_t GetCompressedTextureSize(texture_format Format, uint32_t LogSize);
+// NOTE: Encodes every level of an RGBA8 texture, Blocks holds GetCompressedTextureSize bytes
+void CompressTexture(texture* Source, texture_format Format, uint8_t* Blocks, texture* Dest);
+
+#define SABLUJO_RENDER_H
+#endif
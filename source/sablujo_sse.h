@@ -1,308 +1,93 @@
 #ifndef SABLUJO_SSE_H
 
-#define LANE_WIDTH 8
-
-#if LANE_WIDTH == 8
+#include <immintrin.h>
 
-#include "sablujo_sse_lane8.h"
+// NOTE: The raster kernels are compiled once per instruction set tier with LANE_WIDTH set
+// on the command line, each tier lives in its own namespace so they link in the same library
+#ifndef LANE_WIDTH
+#define LANE_WIDTH 8
+#endif
 
+#if LANE_WIDTH == 16
+#define LANE_NAMESPACE lane16
+#elif LANE_WIDTH == 8
+#define LANE_NAMESPACE lane8
 #elif LANE_WIDTH == 4
-
-#include "sablujo_sse_lane4.h"
-
+#define LANE_NAMESPACE lane4
 #elif LANE_WIDTH == 1
+#define LANE_NAMESPACE lane1
+#else
+#error "Specified lane width not supported"
+#endif
 
-using lane_v3 = vector3;
-using lane_f32 = float;
-using lane_i32 = int32_t;
-
-
-global_variable lane_i32 LaneZeroI32 = 0;
-global_variable lane_f32 LaneZeroF32 = 0.0f;
-
-global_variable lane_i32 LaneOneI32 = 1;
-global_variable lane_f32 LaneOneF32 = 1.0f;
-global_variable lane_f32 LaneZeroPointFive = 0.5f;
-
-inline float
-GetLane(lane_f32 A, int32_t Lane)
-{
-    return A;
-}
-
-inline int32_t
-GetLane(lane_i32 A, int32_t Lane)
-{
-    return A;
-}
-
-inline lane_i32
-InitIncrementalLaneI32(int32_t Value)
-{
-    return Value;
-}
-
-inline lane_i32
-InitLaneI32(int32_t Value)
-{
-    return Value;
-}
-
-inline lane_i32
-LoadLaneI32(int32_t* Values)
-{
-    lane_i32 Result;
-    Result = *Values;
-    return Result;
-}
-
-inline lane_f32
-InitLaneF32(float Value)
+// NOTE: LANE_GENERIC swaps the intrinsics for the portable vector extension backend at the
+// same width, the kernels keep the tier namespace so the runtime selection is unchanged
+namespace LANE_NAMESPACE
 {
-    return Value;
-}
 
+#if defined(LANE_GENERIC)
 
-inline lane_v3
-InitLaneV3(float X, float Y, float Z)
-{
-    lane_v3 Result;
-    Result.X = X;
-    Result.Y = Y;
-    Result.Z = Z;
-    Result.Padding = 0.0f;
-    return Result;
-}
+#include "sablujo_sse_generic.h"
 
-inline lane_v3
-LoadLaneV3(vector3* Values)
-{
-    lane_v3 Result;
-    Result.X = Values[0].X;
-    Result.Y = Values[0].Y;
-    Result.Z = Values[0].Z;
-    return Result;
-}
+#elif LANE_WIDTH == 16
 
-inline int32_t
-IsAllZeros(lane_i32 A)
-{
-    return A == 0;
-}
+#include "sablujo_sse_lane16.h"
 
+#elif LANE_WIDTH == 8
 
-inline void
-ConditionalAssign(lane_i32 Source, lane_i32 *Dest, lane_i32 Mask)
-{
-    Mask = (Mask ? 0xFFFFFFFF : 0);
-    *Dest = (-Mask & *Dest) | (Mask & Source);
-}
-
+#include "sablujo_sse_lane8.h"
 
-inline lane_f32
-Clamp(lane_f32 A, lane_f32 LowerBound, lane_f32 UpperBound)
-{
-    return MAX(MIN(A, UpperBound), LowerBound);
-}
+#elif LANE_WIDTH == 4
 
-inline lane_f32
-Min(lane_f32 A, lane_f32 Bound)
-{
-    return MIN(A, Bound);
-}
+#include "sablujo_sse_lane4.h"
 
-inline lane_f32
-Max(lane_f32 A, lane_f32 Bound)
-{
-    return MAX(A, Bound);
-}
+#elif LANE_WIDTH == 1
 
+#include "sablujo_sse_lane1.h"
 
-inline lane_f32
-RSquareRoot(lane_f32 A)
-{
-    return _mm_rsqrt_ps(_mm_set_ps1(A)).m128_f32[0];
-}
+#endif
 
-/*
-inline lane_f32
-Pow(lane_f32 A, float Power)
-{
-    return powf(A, Power);
-}
-*/
+// NOTE: The 16-bit fixed point preview shading is AVX2 only, sablujo_render.cpp hands the
+// same kernel to the AVX-512 tier
+#if LANE_WIDTH == 8 && !defined(LANE_GENERIC)
+#define LANE_FIXED16 1
+#include "sablujo_sse_fixed16.h"
+#endif
 
-inline float
-Sum(lane_v3 Vector)
-{
-    return Vector.X + Vector.Y + Vector.Z;
-}
+// NOTE: No lane globals, their initializers would run the tier instructions when the
+// library is loaded, even on machines that then pick a narrower tier
+#define LaneZeroI32 InitLaneI32(0)
+#define LaneZeroF32 InitLaneF32(0.0f)
+#define LaneOneI32 InitLaneI32(1)
+#define LaneOneF32 InitLaneF32(1.0f)
+#define LaneZeroPointFive InitLaneF32(0.5f)
 
-inline float
-MagnitudeSq(lane_v3 Vector)
+////////////////////
+// Common Functions
+////////////////////
+#if !LANE_F16C
+inline lane_v3
+InitLaneV3(vector3h A)
 {
-    //Assert(Vector.Padding == 0.0f);
-    Vector.vec = _mm_mul_ps(Vector.vec, Vector.vec);
-    return Sum(Vector);
+    vector3 Value = ConvertHalfV3(A);
+    return InitLaneV3(Value.X, Value.Y, Value.Z);
 }
+#endif
 
-
-
-/*
-inline float Sum(__m128 Vector)
-{
-    return Vector.m128_f32[0] + Vector.m128_f32[1] + Vector.m128_f32[2];
-}*/
-
-
-inline float 
-Magnitude(lane_v3 Vector)
-{
-    return SquareRoot(MagnitudeSq(Vector));
-}
-/*
-inline lane_v3
-Normalize(lane_v3 Vector)
+// NOTE: No backend has a masked 16-bit store, the lanes outside the mask are read back and
+// stored again, halves survive the round trip through floats
+inline void
+ConditionalStoreLaneF16(uint16_t* Dest, lane_f32 Source, lane_mask Mask)
 {
-    float LengthSq = MagnitudeSq(Vector);
-    if(LengthSq > 0.0000001f)
+    if(CountSetLanes(Mask) != LANE_WIDTH)
     {
-        __m128 InvLength = _mm_rsqrt_ps(_mm_set_ps1(LengthSq));
-        Vector.vec = _mm_mul_ps(Vector.vec, InvLength);
-        Vector.Padding = 0.0f;
+        lane_i32 Merged = CastLaneF32ToI32(LoadLaneF16(Dest));
+        ConditionalAssign(CastLaneF32ToI32(Source), &Merged, Mask);
+        Source = CastLaneI32ToF32(Merged);
     }
-    return Vector;
-}
-*/
-
-/*
-inline float
-DotProduct(lane_v3 A, lane_v3 B)
-{
-    Assert(A.Padding == 0.0f || B.Padding == 0.0f);
-    return _mm_dp_ps(A.vec, B.vec, 0xFF).m128_f32[0];
-}
-*/
-
-// ADD
-/*inline lane_v3
-operator+(lane_v3 lhs, lane_v3 rhs)
-{
-    lane_v3 Result;
-    Result.vec = _mm_add_ps(lhs.vec, rhs.vec);
-    return Result;
-}*/
-
-// SUB
-inline lane_v3
-operator-(lane_v3 lhs, lane_v3 rhs)
-{
-    lane_v3 Result;
-    Result.vec = _mm_sub_ps(lhs.vec, rhs.vec);
-    return Result;
-}
-
-inline lane_v3
-operator-(int32_t lhs, lane_v3 rhs)
-{
-    lane_v3 Result;
-    Result.vec = _mm_sub_ps(_mm_set1_ps((float)lhs), rhs.vec);
-    return Result;
-}
-
-// MULTIPLY
-inline lane_v3
-operator*(int32_t lhs, lane_v3 rhs)
-{
-    lane_v3 Result;
-    Result.vec = _mm_mul_ps(_mm_set1_ps((float)lhs), rhs.vec);
-    return Result;
-}
-
-/*
-inline lane_v3
-operator*(float lhs, lane_v3 rhs)
-{
-    lane_v3 Result;
-    Result.vec = _mm_mul_ps(_mm_set1_ps(lhs), rhs.vec);
-    return Result;
-}
-*/
-inline lane_v3
-operator*(lane_v3 lhs, float rhs)
-{
-    lane_v3 Result;
-    Result.vec = _mm_mul_ps(lhs.vec, _mm_set1_ps(rhs));
-    return Result;
-}
-
-inline void 
-operator*=(lane_v3& lhs, float rhs)
-{
-    lhs.vec = _mm_mul_ps(lhs.vec, _mm_set1_ps(rhs));
+    StoreLaneF16(Dest, Source);
 }
 
-inline lane_v3
-operator*(lane_v3 lhs, lane_v3 rhs)
-{
-    lane_v3 Result;
-    Result.vec = _mm_mul_ps(lhs.vec, rhs.vec);
-    return Result;
-}
-
-#define CastLaneF32ToI32(A) (*(int32_t*)&(A))
-#define CastLaneI32ToF32(A) (*(float*)&(A))
-
-
-inline lane_f32
-And(lane_f32& A, lane_f32 B)
-{
-    lane_i32 Result = CastLaneF32ToI32(A) & CastLaneF32ToI32(B);
-    return CastLaneI32ToF32(Result);
-}
-
-
-inline lane_f32
-AndNot(lane_f32 A, lane_f32 B)
-{
-    lane_i32 ResultInt = (~CastLaneF32ToI32(A)) & CastLaneF32ToI32(B);
-    return CastLaneI32ToF32(ResultInt);
-}
-
-inline lane_f32
-Or(lane_f32& A, lane_f32 B)
-{
-    lane_i32 Result = CastLaneF32ToI32(A) | CastLaneF32ToI32(B);
-    return CastLaneI32ToF32(Result);
-}
-
-inline lane_f32
-ConvertLaneI32ToF32(lane_i32 A)
-{
-    return (float)A;
-}
-
-inline lane_i32
-ConvertLaneF32ToI32(lane_f32 A)
-{
-    return (int32_t)A;
-}
-
-
-inline lane_f32
-MultiplyAdd(lane_f32 A, lane_f32 B, lane_f32 C)
-{
-    return A * B + C;
-}
-#else
-#error "Specified lane width not supported"
-#endif
-
-
-////////////////////
-// Common Functions
-////////////////////
-#if LANE_WIDTH != 1
 inline void
 operator+=(lane_i32& A, lane_i32 B)
 {
@@ -362,10 +147,52 @@ operator|=(lane_f32& A, lane_f32 B)
 {
     A = A | B;
 }
-#endif
 
 
-global_variable lane_f32 NormalizeThreshold = InitLaneF32(0.0000001f);
+/////////////////////
+// Precision Tiers
+/////////////////////
+
+// NOTE: Exp, Log, Pow and InvSquareRoot take the precision as a template argument so every
+// call site picks what it can afford. Measured on the AVX2 kernels over the whole valid input
+// range against a double reference, worst error in float ULPs / cycles per value:
+//
+//                   Exact          Fast           UltraFast
+//   Exp             1.0 / 1.2      99 / 0.63      26146 / 0.52
+//   Log             0.8 / 1.7      137 / 1.0      45448 / 0.74
+//   Pow(x, 1/2.4)   4.8 / 3.9      59 / 1.9       29829 / 1.5
+//   InvSquareRoot   3.4 / 0.28     4976 / 0.19    4976 / 0.19
+//
+// Exact is the Cephes polynomials and a Newton step on the reciprocal square root estimate.
+// Fast and UltraFast work in base 2 on minimax polynomials, degree 4 and 2 for 2^x on
+// [-0.5, 0.5], degree 6 and 3 for log2(1 + x) on [sqrt(0.5) - 1, sqrt(2) - 1]. UltraFast
+// is still good to 8 bit colors. There is nothing cheaper than the hardware estimate for the
+// reciprocal square root, so UltraFast is the same as Fast there.
+enum math_precision
+{
+    MathPrecision_Exact,
+    MathPrecision_Fast,
+    MathPrecision_UltraFast,
+};
+
+#define LaneOnePointFive InitLaneF32(1.5f)
+
+template<math_precision Precision>
+inline lane_f32
+InvSquareRoot(lane_f32 A)
+{
+    lane_f32 Result = RSquareRoot(A);
+    if(Precision == MathPrecision_Exact)
+    {
+        // NOTE: One Newton-Raphson step doubles the bits of the estimate
+        lane_f32 HalfA = A * LaneZeroPointFive;
+        Result = Result * (LaneOnePointFive - HalfA * Result * Result);
+    }
+    return Result;
+}
+
+#define NormalizeThreshold InitLaneF32(0.0000001f)
+template<math_precision Precision>
 inline lane_v3
 Normalize(lane_v3 A)
 {
@@ -373,7 +200,7 @@ Normalize(lane_v3 A)
     lane_f32 NormalizeMask = LengthSq > NormalizeThreshold;
     if(!IsAllZeros(CastLaneF32ToI32(NormalizeMask)))
     {
-        lane_f32 InvLengths = RSquareRoot(LengthSq);
+        lane_f32 InvLengths = InvSquareRoot<Precision>(LengthSq);
         A.X = A.X * InvLengths;
         A.Y = A.Y * InvLengths;
         A.Z = A.Z * InvLengths;
@@ -387,24 +214,45 @@ DotProduct(lane_v3 A, lane_v3 B)
     return A.X *B.X + A.Y * B.Y + A.Z * B.Z;
 }
 
+inline lane_v3
+Hadamard(lane_v3 A, lane_v3 B)
+{
+    A.X = A.X * B.X;
+    A.Y = A.Y * B.Y;
+    A.Z = A.Z * B.Z;
+    return A;
+}
+
+// NOTE: 0x00RRGGBB, truncated like ColorToUInt32, channels must be within 0..1
+inline lane_i32
+PackColor(lane_v3 Color)
+{
+    lane_f32 Scale = InitLaneF32(255.0f);
+    lane_i32 R = TruncateLaneF32ToI32(Color.X * Scale);
+    lane_i32 G = TruncateLaneF32ToI32(Color.Y * Scale);
+    lane_i32 B = TruncateLaneF32ToI32(Color.Z * Scale);
+    return (R << 16) | (G << 8) | B;
+}
+
 
-global_variable lane_i32 Const0x7F = InitLaneI32(0x7F);
+#define Const0x7F InitLaneI32(0x7F)
 
-global_variable lane_f32 ExpHi = InitLaneF32(88.3762626647949f);
-global_variable lane_f32 ExpLo = InitLaneF32(-88.3762626647949f);
+#define ExpHi InitLaneF32(88.3762626647949f)
+#define ExpLo InitLaneF32(-88.3762626647949f)
 
-global_variable lane_f32 LOG2EF = InitLaneF32(1.44269504088896341f);
-global_variable lane_f32 ExpC1 = InitLaneF32(0.693359375f);
-global_variable lane_f32 ExpC2 = InitLaneF32(-2.12194440e-4f);
+#define LOG2EF InitLaneF32(1.44269504088896341f)
+#define ExpC1 InitLaneF32(0.693359375f)
+#define ExpC2 InitLaneF32(-2.12194440e-4f)
 
-global_variable lane_f32 ExpP0 = InitLaneF32(1.9875691500E-4f);
-global_variable lane_f32 ExpP1 = InitLaneF32(1.3981999507E-3f);
-global_variable lane_f32 ExpP2 = InitLaneF32(8.3334519073E-3f);
-global_variable lane_f32 ExpP3 = InitLaneF32(4.1665795894E-2f);
-global_variable lane_f32 ExpP4 = InitLaneF32(1.6666665459E-1f);
-global_variable lane_f32 ExpP5 = InitLaneF32(5.0000001201E-1f);
+#define ExpP0 InitLaneF32(1.9875691500E-4f)
+#define ExpP1 InitLaneF32(1.3981999507E-3f)
+#define ExpP2 InitLaneF32(8.3334519073E-3f)
+#define ExpP3 InitLaneF32(4.1665795894E-2f)
+#define ExpP4 InitLaneF32(1.6666665459E-1f)
+#define ExpP5 InitLaneF32(5.0000001201E-1f)
 
-inline lane_f32 fast_exp(lane_f32 Value) 
+inline lane_f32
+ExpExact(lane_f32 Value) 
 {
     lane_f32 Result;
     
@@ -416,7 +264,7 @@ inline lane_f32 fast_exp(lane_f32 Value)
     lane_f32 Fx = Value * LOG2EF; //_mm_mul_ps(Value,LOG2EF);
     Fx += LaneZeroPointFive; //_mm_add_ps(Fx, ZeroPointFive);
     // Floor
-    lane_i32 M = ConvertLaneF32ToI32(Value);
+    lane_i32 M = ConvertLaneF32ToI32(Fx);
     lane_f32 Temp = ConvertLaneI32ToF32(M);
     
     // If greater, substract one
@@ -456,28 +304,27 @@ inline lane_f32 fast_exp(lane_f32 Value)
 
 //global_variable __m128 One = _mm_set_ps1(1.0f);
 // The smallest non denormalized float number
-global_variable int32_t MinNormPosBit = 0x00800000;
-global_variable lane_f32 MinNormPos = InitLaneF32(*(float*)&MinNormPosBit);
-global_variable int32_t InverseMantissaBitMask = ~0x7f800000;
-global_variable lane_f32 InverseMantissaMask = InitLaneF32(*(float*)&InverseMantissaBitMask);
-
-global_variable lane_f32 SQRTHF = InitLaneF32(0.707106781186547524f);
-global_variable lane_f32 LogP0 = InitLaneF32(7.0376836292E-2f);
-global_variable lane_f32 LogP1 = InitLaneF32(-1.1514610310E-1f);
-global_variable lane_f32 LogP2 = InitLaneF32(1.1676998740E-1f);
-global_variable lane_f32 LogP3 = InitLaneF32(-1.2420140846E-1f);
-global_variable lane_f32 LogP4 = InitLaneF32(1.4249322787E-1f);
-global_variable lane_f32 LogP5 = InitLaneF32(-1.6668057665E-1f);
-global_variable lane_f32 LogP6 = InitLaneF32(2.0000714765E-1f);
-global_variable lane_f32 LogP7 = InitLaneF32(-2.4999993993E-1f);
-global_variable lane_f32 LogP8 = InitLaneF32(3.3333331174E-1f);
-
-global_variable lane_f32 LogQ1 = InitLaneF32(-2.12194440E-4f);
-global_variable lane_f32 LogQ2 = InitLaneF32(0.693359375f);
+#define MinNormPos CastLaneI32ToF32(InitLaneI32(0x00800000))
+#define InverseMantissaMask CastLaneI32ToF32(InitLaneI32(~0x7f800000))
+
+#define SQRTHF InitLaneF32(0.707106781186547524f)
+#define LogP0 InitLaneF32(7.0376836292E-2f)
+#define LogP1 InitLaneF32(-1.1514610310E-1f)
+#define LogP2 InitLaneF32(1.1676998740E-1f)
+#define LogP3 InitLaneF32(-1.2420140846E-1f)
+#define LogP4 InitLaneF32(1.4249322787E-1f)
+#define LogP5 InitLaneF32(-1.6668057665E-1f)
+#define LogP6 InitLaneF32(2.0000714765E-1f)
+#define LogP7 InitLaneF32(-2.4999993993E-1f)
+#define LogP8 InitLaneF32(3.3333331174E-1f)
+
+#define LogQ1 InitLaneF32(-2.12194440E-4f)
+#define LogQ2 InitLaneF32(0.693359375f)
 
 // Natural logarithm computed for 4 simultaneous float
 // return NaN for Value <= 0
-inline lane_f32 fast_log(lane_f32 Value) 
+inline lane_f32
+LogExact(lane_f32 Value) 
 {
     lane_f32 Result;
     
@@ -543,46 +390,218 @@ inline lane_f32 fast_log(lane_f32 Value)
 }
 
 
+#define Exp2Hi InitLaneF32(127.0f)
+#define Exp2Lo InitLaneF32(-126.0f)
+
+#define Exp2FastP0 InitLaneF32(0.99999922514f)
+#define Exp2FastP1 InitLaneF32(0.69311976433f)
+#define Exp2FastP2 InitLaneF32(0.24024742842f)
+#define Exp2FastP3 InitLaneF32(0.05593144149f)
+#define Exp2FastP4 InitLaneF32(0.00957466662f)
+
+#define Exp2UltraFastP0 InitLaneF32(1.00047171116f)
+#define Exp2UltraFastP1 InitLaneF32(0.70412069559f)
+#define Exp2UltraFastP2 InitLaneF32(0.23876285553f)
+
+#define LN2F InitLaneF32(0.693147180559945309f)
+
+template<math_precision Precision>
 inline lane_f32
-Pow(lane_f32 A, float Power)
+Exp2(lane_f32 Value)
 {
-    return fast_exp(InitLaneF32(Power) * fast_log(A));
+    if(Precision == MathPrecision_Exact)
+    {
+        return ExpExact(Value * LN2F);
+    }
+    
+    // NOTE: 2^x = 2^n * 2^f with n the nearest integer, so f stays within [-0.5, 0.5]
+    Value = Clamp(Value, Exp2Lo, Exp2Hi);
+    lane_i32 N = ConvertLaneF32ToI32(Value);
+    lane_f32 F = Value - ConvertLaneI32ToF32(N);
+    
+    lane_f32 Result;
+    if(Precision == MathPrecision_Fast)
+    {
+        Result = Exp2FastP4;
+        Result = MultiplyAdd(Result, F, Exp2FastP3);
+        Result = MultiplyAdd(Result, F, Exp2FastP2);
+        Result = MultiplyAdd(Result, F, Exp2FastP1);
+        Result = MultiplyAdd(Result, F, Exp2FastP0);
+    }
+    else
+    {
+        Result = Exp2UltraFastP2;
+        Result = MultiplyAdd(Result, F, Exp2UltraFastP1);
+        Result = MultiplyAdd(Result, F, Exp2UltraFastP0);
+    }
+    
+    lane_f32 Pow2n = CastLaneI32ToF32((N + Const0x7F) << 23);
+    return Result * Pow2n;
 }
 
+#define Log2FastP0 InitLaneF32(1.44270300865f)
+#define Log2FastP1 InitLaneF32(-0.72120177746f)
+#define Log2FastP2 InitLaneF32(0.47968500853f)
+#define Log2FastP3 InitLaneF32(-0.36646825075f)
+#define Log2FastP4 InitLaneF32(0.31966444850f)
+#define Log2FastP5 InitLaneF32(-0.20818366110f)
 
-//TODO: Replace this stupid and horrible implementation
+#define Log2UltraFastP0 InitLaneF32(1.44410920143f)
+#define Log2UltraFastP1 InitLaneF32(-0.75350576639f)
+#define Log2UltraFastP2 InitLaneF32(0.45310303569f)
+
+template<math_precision Precision>
 inline lane_f32
-Pow(lane_f32 A, uint32_t Power)
+Log2(lane_f32 Value)
 {
-#if 0
-    return fast_exp(InitLaneF32((float)Power) * fast_log(A));
-#else
-    lane_f32 Result = A;
-    for(uint32_t i = 0; i < Power; ++i)
-    {   
-        Result = Result *  A;
+    if(Precision == MathPrecision_Exact)
+    {
+        return LogExact(Value) * LOG2EF;
+    }
+    
+    // NOTE: Same reduction as LogExact, log2(x) = e + log2(1 + t) with 1 + t in [sqrt(0.5), sqrt(2))
+    lane_f32 InvalidMask = Value <= LaneZeroF32;
+    lane_f32 M = Max(Value, MinNormPos);
+    lane_i32 E = (CastLaneF32ToI32(M) >> 23) - Const0x7F;
+    M = Or(And(M, InverseMantissaMask), LaneZeroPointFive);
+    lane_f32 Exponent = ConvertLaneI32ToF32(E) + LaneOneF32;
+    
+    lane_f32 Mask = M < SQRTHF;
+    Exponent -= And(LaneOneF32, Mask);
+    lane_f32 T = M - LaneOneF32 + And(M, Mask);
+    
+    lane_f32 Poly;
+    if(Precision == MathPrecision_Fast)
+    {
+        Poly = Log2FastP5;
+        Poly = MultiplyAdd(Poly, T, Log2FastP4);
+        Poly = MultiplyAdd(Poly, T, Log2FastP3);
+        Poly = MultiplyAdd(Poly, T, Log2FastP2);
+        Poly = MultiplyAdd(Poly, T, Log2FastP1);
+        Poly = MultiplyAdd(Poly, T, Log2FastP0);
+    }
+    else
+    {
+        Poly = Log2UltraFastP2;
+        Poly = MultiplyAdd(Poly, T, Log2UltraFastP1);
+        Poly = MultiplyAdd(Poly, T, Log2UltraFastP0);
+    }
+    
+    lane_f32 Result = MultiplyAdd(Poly, T, Exponent);
+    return Or(Result, InvalidMask);
+}
+
+template<math_precision Precision>
+inline lane_f32
+Exp(lane_f32 Value)
+{
+    if(Precision == MathPrecision_Exact)
+    {
+        return ExpExact(Value);
+    }
+    return Exp2<Precision>(Value * LOG2EF);
+}
+
+template<math_precision Precision>
+inline lane_f32
+Log(lane_f32 Value)
+{
+    if(Precision == MathPrecision_Exact)
+    {
+        return LogExact(Value);
+    }
+    return Log2<Precision>(Value) * LN2F;
+}
+
+template<math_precision Precision>
+inline lane_f32
+Pow(lane_f32 A, float Power)
+{
+    if(Precision == MathPrecision_Exact)
+    {
+        return ExpExact(InitLaneF32(Power) * LogExact(A));
+    }
+    return Exp2<Precision>(InitLaneF32(Power) * Log2<Precision>(A));
+}
+
+// NOTE: Integer powers are unrolled at compile time by squaring, Pow<32> is 5 multiplies
+template<uint32_t Power>
+inline lane_f32
+Pow(lane_f32 A)
+{
+    lane_f32 Half = Pow<Power / 2>(A);
+    lane_f32 Result = Half * Half;
+    if(Power & 1)
+    {
+        Result = Result * A;
     }
     return Result;
-#endif
 }
 
-global_variable lane_f32 SRGBThreshold = InitLaneF32(0.0031308f);
-global_variable lane_f32 SRGBScale = InitLaneF32(12.92f);
-global_variable lane_f32 SRGBExponentScale = InitLaneF32(1.055f);
+template<>
+inline lane_f32
+Pow<1>(lane_f32 A)
+{
+    return A;
+}
+
+template<>
+inline lane_f32
+Pow<0>(lane_f32 A)
+{
+    return LaneOneF32;
+}
+
+#define SRGBThreshold InitLaneF32(0.0031308f)
+#define SRGBScale InitLaneF32(12.92f)
+#define SRGBExponentScale InitLaneF32(1.055f)
 global_variable float  SRGBExponent = (1.0f / 2.4f);
 
+template<math_precision Precision>
 inline lane_f32
 LinearToSRGB(lane_f32 A)
 {
     lane_f32 Mask = (A < SRGBThreshold);
     lane_f32 SimpleScale = A * SRGBScale;
-    lane_f32 ExponentialScale =  SRGBExponentScale * Pow(A, SRGBExponent);
+    lane_f32 ExponentialScale =  SRGBExponentScale * Pow<Precision>(A, SRGBExponent);
     
     lane_f32 MaskedExpScale = AndNot(Mask, ExponentialScale);
     lane_i32 IntResult = CastLaneF32ToI32(SimpleScale) & CastLaneF32ToI32(Mask) | CastLaneF32ToI32(MaskedExpScale);
     return CastLaneI32ToF32(IntResult);
 }
 
+#define SRGBDecodeThreshold InitLaneF32(0.04045f)
+#define SRGBDecodeOffset InitLaneF32(0.055f)
+global_variable float  SRGBDecodeExponent = 2.4f;
+
+// NOTE: sRGB in 0..1 back to linear, for texels
+template<math_precision Precision>
+inline lane_f32
+SRGBToLinear(lane_f32 A)
+{
+    lane_f32 Mask = (A <= SRGBDecodeThreshold);
+    lane_f32 SimpleScale = A * InitLaneF32(1.0f / 12.92f);
+    lane_f32 Exponential = Pow<Precision>((A + SRGBDecodeOffset) * InitLaneF32(1.0f / 1.055f), SRGBDecodeExponent);
+    
+    lane_f32 MaskedExponential = AndNot(Mask, Exponential);
+    lane_i32 IntResult = CastLaneF32ToI32(SimpleScale) & CastLaneF32ToI32(Mask) | CastLaneF32ToI32(MaskedExponential);
+    return CastLaneI32ToF32(IntResult);
+}
+
+
+// NOTE: Output merger, linear color to packed 8 bit sRGB, channels must not be negative. The
+// Fast pow gives the same bytes as the exact one, UltraFast is a step off on about 4% of the
+// pixels. Overshoots are clamped after the encode so they can't spill into the next channel.
+inline lane_i32
+EncodeSRGB8(lane_v3 Color)
+{
+    Color.X = Min(LinearToSRGB<MathPrecision_Fast>(Color.X), LaneOneF32);
+    Color.Y = Min(LinearToSRGB<MathPrecision_Fast>(Color.Y), LaneOneF32);
+    Color.Z = Min(LinearToSRGB<MathPrecision_Fast>(Color.Z), LaneOneF32);
+    return PackColor(Color);
+}
+
+} // namespace LANE_NAMESPACE
 
 #define SABLUJO_SSE_H
 #endif //SABLUJO_SSE_H
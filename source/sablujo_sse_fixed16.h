@@ -0,0 +1,182 @@
+#ifndef SABLUJO_SSE_FIXED16_H
+
+// NOTE: 16 lanes of signed 16-bit fixed point in one AVX2 register, for the preview shading.
+// Values in [0, 1) are Q15, vectors and anything that can reach 1 or go negative are Q14.
+struct lane_i16
+{
+    __m256i V;
+};
+
+#define Q14_ONE (1 << 14)
+#define Q15_MAX INT16_MAX
+
+inline lane_i16
+InitLaneI16(int16_t Value)
+{
+    lane_i16 Result;
+    Result.V = _mm256_set1_epi16(Value);
+    return Result;
+}
+
+// NOTE: Saturates to 16 bits, element order is Low[0..3], High[0..3], Low[4..7], High[4..7]
+// since the pack works within each 128-bit half, UnpackLaneI16 undoes it
+inline lane_i16
+PackLaneI32ToI16(lane_i32 Low, lane_i32 High)
+{
+    lane_i16 Result;
+    Result.V = _mm256_packs_epi32(Low, High);
+    return Result;
+}
+
+// NOTE: Pairs A and B into the 32-bit lanes B << 16 | A, splitting them back in the two
+// inputs of PackLaneI32ToI16
+inline void
+UnpackLaneI16(lane_i16 A, lane_i16 B, lane_i32* Low, lane_i32* High)
+{
+    *Low = _mm256_unpacklo_epi16(A.V, B.V);
+    *High = _mm256_unpackhi_epi16(A.V, B.V);
+}
+
+inline lane_i16
+operator+(lane_i16 A, lane_i16 B)
+{
+    lane_i16 Result;
+    Result.V = _mm256_adds_epi16(A.V, B.V);
+    return Result;
+}
+
+inline lane_i16
+operator-(lane_i16 A, lane_i16 B)
+{
+    lane_i16 Result;
+    Result.V = _mm256_subs_epi16(A.V, B.V);
+    return Result;
+}
+
+inline lane_i16
+operator*(lane_i16 A, int16_t B)
+{
+    lane_i16 Result;
+    Result.V = _mm256_mullo_epi16(A.V, _mm256_set1_epi16(B));
+    return Result;
+}
+
+inline lane_i16
+operator|(lane_i16 A, lane_i16 B)
+{
+    lane_i16 Result;
+    Result.V = _mm256_or_si256(A.V, B.V);
+    return Result;
+}
+
+inline lane_i16
+operator<<(lane_i16 A, int32_t B)
+{
+    lane_i16 Result;
+    Result.V = _mm256_slli_epi16(A.V, B);
+    return Result;
+}
+
+inline lane_i16
+operator>>(lane_i16 A, int32_t B)
+{
+    lane_i16 Result;
+    Result.V = _mm256_srli_epi16(A.V, B);
+    return Result;
+}
+
+// NOTE: Rounded A * B / 2^15, a Q15 factor keeps the format of the other one, two Q14
+// operands give a Q13 result
+inline lane_i16
+MultiplyFixed(lane_i16 A, lane_i16 B)
+{
+    lane_i16 Result;
+    Result.V = _mm256_mulhrs_epi16(A.V, B.V);
+    return Result;
+}
+
+inline lane_i16
+Min(lane_i16 A, lane_i16 Bound)
+{
+    lane_i16 Result;
+    Result.V = _mm256_min_epi16(A.V, Bound.V);
+    return Result;
+}
+
+inline lane_i16
+Max(lane_i16 A, lane_i16 Bound)
+{
+    lane_i16 Result;
+    Result.V = _mm256_max_epi16(A.V, Bound.V);
+    return Result;
+}
+
+inline lane_i16
+Clamp(lane_i16 A, lane_i16 LowerBound, lane_i16 UpperBound)
+{
+    return Max(Min(A, UpperBound), LowerBound);
+}
+
+struct lane_v3_i16
+{
+    lane_i16 X;
+    lane_i16 Y;
+    lane_i16 Z;
+};
+
+inline lane_v3_i16
+InitLaneV3I16(int16_t X, int16_t Y, int16_t Z)
+{
+    lane_v3_i16 Result;
+    Result.X = InitLaneI16(X);
+    Result.Y = InitLaneI16(Y);
+    Result.Z = InitLaneI16(Z);
+    return Result;
+}
+
+inline lane_v3_i16
+operator+(lane_v3_i16 A, lane_v3_i16 B)
+{
+    A.X = A.X + B.X;
+    A.Y = A.Y + B.Y;
+    A.Z = A.Z + B.Z;
+    return A;
+}
+
+inline lane_v3_i16
+MultiplyFixed(lane_v3_i16 A, lane_i16 B)
+{
+    A.X = MultiplyFixed(A.X, B);
+    A.Y = MultiplyFixed(A.Y, B);
+    A.Z = MultiplyFixed(A.Z, B);
+    return A;
+}
+
+// NOTE: Q14 vectors, Q13 result
+inline lane_i16
+DotProductFixed(lane_v3_i16 A, lane_v3_i16 B)
+{
+    return MultiplyFixed(A.X, B.X) + MultiplyFixed(A.Y, B.Y) + MultiplyFixed(A.Z, B.Z);
+}
+
+// NOTE: Newton steps from 1 for the reciprocal square root, A * (3 - |A|^2) / 2, applied to
+// A directly. Interpolated unit vectors shrink towards the middle of the triangle, one step
+// left the highlights of the large cube faces far too dark, three converge down to squared
+// lengths of one half.
+#define Q13_THREE InitLaneI16(3 << 13)
+inline lane_v3_i16
+RenormalizeFixed(lane_v3_i16 A)
+{
+    for(int32_t Step = 0; Step < 3; ++Step)
+    {
+        lane_i16 Factor = Q13_THREE - DotProductFixed(A, A);
+        A = MultiplyFixed(A, Factor);
+        A.X = A.X << 1;
+        A.Y = A.Y << 1;
+        A.Z = A.Z << 1;
+    }
+    return A;
+}
+
+#define SABLUJO_SSE_FIXED16_H
+#endif //SABLUJO_SSE_FIXED16_H
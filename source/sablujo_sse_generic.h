@@ -0,0 +1,511 @@
+#ifndef SABLUJO_SSE_GENERIC_H
+
+// NOTE: Portable backend on GCC/Clang vector extensions, selected with LANE_GENERIC at any
+// supported LANE_WIDTH. The compiler lowers the vectors to whatever the target flags allow,
+// splitting lanes wider than the hardware ones, so it is the baseline the intrinsic backends
+// are measured against. Lanes are wrapped in structs so comparisons keep the lane type.
+#if !defined(__GNUC__)
+#error "The generic lane backend needs GCC or Clang vector extensions"
+#endif
+
+typedef float lane_f32_vector __attribute__((vector_size(LANE_WIDTH * sizeof(float))));
+typedef int32_t lane_i32_vector __attribute__((vector_size(LANE_WIDTH * sizeof(int32_t))));
+typedef uint32_t lane_u32_vector __attribute__((vector_size(LANE_WIDTH * sizeof(uint32_t))));
+
+struct lane_f32
+{
+    lane_f32_vector V;
+};
+
+struct lane_i32
+{
+    lane_i32_vector V;
+};
+
+// NOTE: Comparisons set every bit of the lanes that pass
+using lane_mask = lane_i32;
+
+struct lane_v3
+{
+    lane_f32 X;
+    lane_f32 Y;
+    lane_f32 Z;
+};
+
+inline lane_i32
+MakeLaneI32(lane_i32_vector Value)
+{
+    lane_i32 Result;
+    Result.V = Value;
+    return Result;
+}
+
+inline lane_f32
+MakeLaneF32(lane_f32_vector Value)
+{
+    lane_f32 Result;
+    Result.V = Value;
+    return Result;
+}
+
+inline lane_i32
+InitLaneI32(int32_t Value)
+{
+    lane_i32_vector Zero = {};
+    return MakeLaneI32(Zero + Value);
+}
+
+inline lane_i32
+InitIncrementalLaneI32(int32_t BaseValue)
+{
+    lane_i32 Result;
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        Result.V[Lane] = BaseValue + Lane;
+    }
+    return Result;
+}
+
+inline lane_i32
+LoadLaneI32(int32_t* Values)
+{
+    lane_i32 Result;
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        Result.V[Lane] = Values[Lane];
+    }
+    return Result;
+}
+
+inline void
+StoreLaneI32(int32_t* Dest, lane_i32 A)
+{
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        Dest[Lane] = A.V[Lane];
+    }
+}
+
+// NOTE: Lane i of the result is lane Indices[i] of A
+inline lane_i32
+PermuteLanes(lane_i32 A, lane_i32 Indices)
+{
+    lane_i32 Result;
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        Result.V[Lane] = A.V[Indices.V[Lane]];
+    }
+    return Result;
+}
+
+// NOTE: Lane i of the result is Base[Indices[i]]
+inline lane_i32
+GatherLaneI32(int32_t* Base, lane_i32 Indices)
+{
+    lane_i32 Result;
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        Result.V[Lane] = Base[Indices.V[Lane]];
+    }
+    return Result;
+}
+
+inline int32_t
+IsAllZeros(lane_i32 A)
+{
+    int32_t Bits = 0;
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        Bits |= A.V[Lane];
+    }
+    return Bits == 0;
+}
+
+inline int32_t
+CountSetLanes(lane_mask A)
+{
+    int32_t Result = 0;
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        Result += A.V[Lane] != 0;
+    }
+    return Result;
+}
+
+inline lane_i32
+operator+(lane_i32 A, lane_i32 B)
+{
+    return MakeLaneI32(A.V + B.V);
+}
+
+inline lane_i32
+operator-(lane_i32 A, lane_i32 B)
+{
+    return MakeLaneI32(A.V - B.V);
+}
+
+inline lane_i32
+operator*(lane_i32 A, lane_i32 B)
+{
+    return MakeLaneI32(A.V * B.V);
+}
+
+inline lane_i32
+operator*(lane_i32 A, int32_t B)
+{
+    return MakeLaneI32(A.V * B);
+}
+
+inline lane_i32
+operator*(int32_t A, lane_i32 B)
+{
+    return B * A;
+}
+
+inline lane_mask
+operator<(lane_i32 A, lane_i32 B)
+{
+    return MakeLaneI32(A.V < B.V);
+}
+
+inline lane_mask
+operator==(lane_i32 A, lane_i32 B)
+{
+    return MakeLaneI32(A.V == B.V);
+}
+
+inline lane_i32
+operator|(lane_i32 A, lane_i32 B)
+{
+    return MakeLaneI32(A.V | B.V);
+}
+
+inline lane_i32
+operator&(lane_i32 A, lane_i32 B)
+{
+    return MakeLaneI32(A.V & B.V);
+}
+
+inline lane_i32
+AndNot(lane_i32 A, lane_i32 B)
+{
+    return MakeLaneI32(~A.V & B.V);
+}
+
+inline lane_i32
+operator<<(lane_i32 A, int32_t B)
+{
+    return MakeLaneI32((lane_i32_vector)((lane_u32_vector)A.V << B));
+}
+
+// NOTE: Logical shift, like the intrinsic backends
+inline lane_i32
+operator>>(lane_i32 A, int32_t B)
+{
+    return MakeLaneI32((lane_i32_vector)((lane_u32_vector)A.V >> B));
+}
+
+inline void
+ConditionalAssign(lane_i32 Source, lane_i32 *Dest, lane_mask Mask)
+{
+    *Dest = AndNot(Mask, *Dest) | (Mask & Source);
+}
+
+template<int32_t StepX, int32_t StepY>
+inline void
+ConditionalStoreBlock(uint32_t* Base, int32_t PitchInPixels, lane_i32 Source, lane_mask Mask)
+{
+    for(int32_t Y = 0; Y < StepY; ++Y)
+    {
+        for(int32_t X = 0; X < StepX; ++X)
+        {
+            int32_t Lane = Y * StepX + X;
+            if(Mask.V[Lane])
+            {
+                Base[Y * PitchInPixels + X] = (uint32_t)Source.V[Lane];
+            }
+        }
+    }
+}
+
+/////////////
+// Lane F32
+/////////////
+
+inline lane_f32
+InitLaneF32(float Value)
+{
+    lane_f32_vector Zero = {};
+    return MakeLaneF32(Zero + Value);
+}
+
+inline float
+GetLane(lane_f32 A, int32_t Lane)
+{
+    return A.V[Lane];
+}
+
+inline int32_t
+GetLane(lane_i32 A, int32_t Lane)
+{
+    return A.V[Lane];
+}
+
+////////////////////////
+// Casts & Conversions
+////////////////////////
+
+inline lane_f32
+ConvertLaneI32ToF32(lane_i32 A)
+{
+    return MakeLaneF32(__builtin_convertvector(A.V, lane_f32_vector));
+}
+
+// NOTE: Rounds to nearest like the intrinsic backends, not towards zero like a C cast
+inline lane_i32
+ConvertLaneF32ToI32(lane_f32 A)
+{
+    lane_i32 Result;
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        Result.V[Lane] = (int32_t)__builtin_rintf(A.V[Lane]);
+    }
+    return Result;
+}
+
+inline lane_i32
+TruncateLaneF32ToI32(lane_f32 A)
+{
+    return MakeLaneI32(__builtin_convertvector(A.V, lane_i32_vector));
+}
+
+inline lane_i32
+CastLaneF32ToI32(lane_f32 A)
+{
+    return MakeLaneI32((lane_i32_vector)A.V);
+}
+
+inline lane_f32
+CastLaneI32ToF32(lane_i32 A)
+{
+    return MakeLaneF32((lane_f32_vector)A.V);
+}
+
+// NOTE: Portable half conversions, the target flags may not include F16C
+inline lane_f32
+LoadLaneF16(uint16_t* Values)
+{
+    lane_f32 Result;
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        Result.V[Lane] = ConvertHalfToF32(Values[Lane]);
+    }
+    return Result;
+}
+
+inline void
+StoreLaneF16(uint16_t* Dest, lane_f32 A)
+{
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        Dest[Lane] = ConvertF32ToHalf(A.V[Lane]);
+    }
+}
+
+inline vector3
+ConvertHalfV3(vector3h A)
+{
+    vector3 Result;
+    Result.X = ConvertHalfToF32(A.X);
+    Result.Y = ConvertHalfToF32(A.Y);
+    Result.Z = ConvertHalfToF32(A.Z);
+    Result.Padding = 0.0f;
+    return Result;
+}
+
+inline lane_f32
+RSquareRoot(lane_f32 A)
+{
+    lane_f32 Result;
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        Result.V[Lane] = 1.0f / __builtin_sqrtf(A.V[Lane]);
+    }
+    return Result;
+}
+
+inline lane_f32
+Select(lane_mask Mask, lane_f32 A, lane_f32 B)
+{
+    return MakeLaneF32((lane_f32_vector)((Mask.V & (lane_i32_vector)A.V) | (~Mask.V & (lane_i32_vector)B.V)));
+}
+
+inline lane_f32
+Min(lane_f32 A, lane_f32 Bound)
+{
+    return Select(MakeLaneI32(A.V < Bound.V), A, Bound);
+}
+
+inline lane_f32
+Max(lane_f32 A, lane_f32 Bound)
+{
+    return Select(MakeLaneI32(A.V > Bound.V), A, Bound);
+}
+
+inline lane_f32
+Clamp(lane_f32 A, lane_f32 LowerBound, lane_f32 UpperBound)
+{
+    return Max(Min(A, UpperBound), LowerBound);
+}
+
+inline lane_f32
+MultiplyAdd(lane_f32 A, lane_f32 B, lane_f32 C)
+{
+    return MakeLaneF32(A.V * B.V + C.V);
+}
+
+inline lane_f32
+Floor(lane_f32 A)
+{
+    lane_f32 Result;
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        Result.V[Lane] = __builtin_floorf(A.V[Lane]);
+    }
+    return Result;
+}
+
+inline lane_f32
+operator+(lane_f32 A, lane_f32 B)
+{
+    return MakeLaneF32(A.V + B.V);
+}
+
+inline lane_f32
+operator-(lane_f32 A, lane_f32 B)
+{
+    return MakeLaneF32(A.V - B.V);
+}
+
+inline lane_f32
+operator*(lane_f32 A, lane_f32 B)
+{
+    return MakeLaneF32(A.V * B.V);
+}
+
+inline lane_f32
+operator/(lane_f32 A, lane_f32 B)
+{
+    return MakeLaneF32(A.V / B.V);
+}
+
+inline lane_f32
+operator<(lane_f32 A, lane_f32 B)
+{
+    return MakeLaneF32((lane_f32_vector)(A.V < B.V));
+}
+
+inline lane_f32
+operator<=(lane_f32 A, lane_f32 B)
+{
+    return MakeLaneF32((lane_f32_vector)(A.V <= B.V));
+}
+
+inline lane_f32
+operator>(lane_f32 A, lane_f32 B)
+{
+    return MakeLaneF32((lane_f32_vector)(A.V > B.V));
+}
+
+inline lane_f32
+operator&(lane_f32 A, lane_f32 B)
+{
+    return CastLaneI32ToF32(CastLaneF32ToI32(A) & CastLaneF32ToI32(B));
+}
+
+inline lane_f32
+operator|(lane_f32 A, lane_f32 B)
+{
+    return CastLaneI32ToF32(CastLaneF32ToI32(A) | CastLaneF32ToI32(B));
+}
+
+inline lane_f32
+And(lane_f32 A, lane_f32 B)
+{
+    return A & B;
+}
+
+inline lane_f32
+AndNot(lane_f32 A, lane_f32 B)
+{
+    return CastLaneI32ToF32(AndNot(CastLaneF32ToI32(A), CastLaneF32ToI32(B)));
+}
+
+inline lane_f32
+Or(lane_f32 A, lane_f32 B)
+{
+    return A | B;
+}
+
+/////////////
+// Lane V3
+/////////////
+
+inline lane_v3
+InitLaneV3(float X, float Y, float Z)
+{
+    lane_v3 Result;
+    Result.X = InitLaneF32(X);
+    Result.Y = InitLaneF32(Y);
+    Result.Z = InitLaneF32(Z);
+    return Result;
+}
+
+inline lane_v3
+LoadLaneV3(vector3* Values)
+{
+    lane_v3 Result;
+    for(int32_t Lane = 0; Lane < LANE_WIDTH; ++Lane)
+    {
+        Result.X.V[Lane] = Values[Lane].X;
+        Result.Y.V[Lane] = Values[Lane].Y;
+        Result.Z.V[Lane] = Values[Lane].Z;
+    }
+    return Result;
+}
+
+inline lane_f32
+MagnitudeSq(lane_v3 A)
+{
+    return A.X * A.X + A.Y * A.Y + A.Z * A.Z;
+}
+
+inline lane_v3
+operator+(lane_v3 A, lane_v3 B)
+{
+    A.X = A.X + B.X;
+    A.Y = A.Y + B.Y;
+    A.Z = A.Z + B.Z;
+    return A;
+}
+
+inline lane_v3
+operator-(lane_v3 A, lane_v3 B)
+{
+    A.X = A.X - B.X;
+    A.Y = A.Y - B.Y;
+    A.Z = A.Z - B.Z;
+    return A;
+}
+
+inline lane_v3
+operator*(lane_v3 A, lane_f32 B)
+{
+    A.X = A.X * B;
+    A.Y = A.Y * B;
+    A.Z = A.Z * B;
+    return A;
+}
+
+#define SABLUJO_SSE_GENERIC_H
+#endif //SABLUJO_SSE_GENERIC_H
@@ -0,0 +1,403 @@
+#ifndef SABLUJO_SSE_LANE1_H
+
+// NOTE: Scalar fallback for machines without SSE4.1. Lanes are wrapped in structs so they
+// don't mix with plain numbers and masks are all bits set, exactly like the wide backends
+struct lane_f32
+{
+    float V;
+};
+
+struct lane_i32
+{
+    int32_t V;
+};
+
+// NOTE: Comparisons set every bit of the lanes that pass
+using lane_mask = lane_i32;
+
+struct lane_v3
+{
+    lane_f32 X;
+    lane_f32 Y;
+    lane_f32 Z;
+};
+
+inline lane_i32
+InitLaneI32(int32_t Value)
+{
+    lane_i32 Result;
+    Result.V = Value;
+    return Result;
+}
+
+inline lane_i32
+InitIncrementalLaneI32(int32_t BaseValue)
+{
+    return InitLaneI32(BaseValue);
+}
+
+inline lane_i32
+LoadLaneI32(int32_t* Values)
+{
+    return InitLaneI32(Values[0]);
+}
+
+inline void
+StoreLaneI32(int32_t* Dest, lane_i32 A)
+{
+    Dest[0] = A.V;
+}
+
+// NOTE: Lane i of the result is Base[Indices[i]]
+inline lane_i32
+GatherLaneI32(int32_t* Base, lane_i32 Indices)
+{
+    return InitLaneI32(Base[Indices.V]);
+}
+
+inline int32_t
+IsAllZeros(lane_i32 A)
+{
+    return A.V == 0;
+}
+
+inline int32_t
+CountSetLanes(lane_i32 A)
+{
+    return A.V != 0;
+}
+
+inline lane_i32
+operator+(lane_i32 A, lane_i32 B)
+{
+    return InitLaneI32(A.V + B.V);
+}
+
+inline lane_i32
+operator-(lane_i32 A, lane_i32 B)
+{
+    return InitLaneI32(A.V - B.V);
+}
+
+inline lane_i32
+operator*(lane_i32 A, lane_i32 B)
+{
+    return InitLaneI32(A.V * B.V);
+}
+
+inline lane_i32
+operator*(lane_i32 A, int32_t B)
+{
+    return InitLaneI32(A.V * B);
+}
+
+inline lane_i32
+operator*(int32_t A, lane_i32 B)
+{
+    return B * A;
+}
+
+inline lane_i32
+operator<(lane_i32 A, lane_i32 B)
+{
+    return InitLaneI32(A.V < B.V ? -1 : 0);
+}
+
+inline lane_i32
+operator==(lane_i32 A, lane_i32 B)
+{
+    return InitLaneI32(A.V == B.V ? -1 : 0);
+}
+
+inline lane_i32
+operator|(lane_i32 A, lane_i32 B)
+{
+    return InitLaneI32(A.V | B.V);
+}
+
+inline lane_i32
+operator&(lane_i32 A, lane_i32 B)
+{
+    return InitLaneI32(A.V & B.V);
+}
+
+inline lane_i32
+AndNot(lane_i32 A, lane_i32 B)
+{
+    return InitLaneI32(~A.V & B.V);
+}
+
+inline lane_i32
+operator<<(lane_i32 A, int32_t B)
+{
+    return InitLaneI32((int32_t)((uint32_t)A.V << B));
+}
+
+// NOTE: Logical shift, like the wide backends
+inline lane_i32
+operator>>(lane_i32 A, int32_t B)
+{
+    return InitLaneI32((int32_t)((uint32_t)A.V >> B));
+}
+
+inline void
+ConditionalAssign(lane_i32 Source, lane_i32 *Dest, lane_i32 Mask)
+{
+    *Dest = AndNot(Mask, *Dest) | (Mask & Source);
+}
+
+template<int32_t StepX, int32_t StepY>
+inline void
+ConditionalStoreBlock(uint32_t* Base, int32_t PitchInPixels, lane_i32 Source, lane_mask Mask)
+{
+    if(Mask.V)
+    {
+        *Base = (uint32_t)Source.V;
+    }
+}
+
+/////////////
+// Lane F32
+/////////////
+
+inline lane_f32
+InitLaneF32(float Value)
+{
+    lane_f32 Result;
+    Result.V = Value;
+    return Result;
+}
+
+inline float
+GetLane(lane_f32 A, int32_t Lane)
+{
+    return A.V;
+}
+
+inline int32_t
+GetLane(lane_i32 A, int32_t Lane)
+{
+    return A.V;
+}
+
+////////////////////////
+// Casts & Conversions
+////////////////////////
+
+inline lane_f32
+ConvertLaneI32ToF32(lane_i32 A)
+{
+    return InitLaneF32((float)A.V);
+}
+
+// NOTE: Rounds to nearest like the wide backends, not towards zero like a C cast
+inline lane_i32
+ConvertLaneF32ToI32(lane_f32 A)
+{
+    return InitLaneI32(_mm_cvtss_si32(_mm_set_ss(A.V)));
+}
+
+inline lane_i32
+TruncateLaneF32ToI32(lane_f32 A)
+{
+    return InitLaneI32((int32_t)A.V);
+}
+
+inline lane_i32
+CastLaneF32ToI32(lane_f32 A)
+{
+    return InitLaneI32(_mm_cvtsi128_si32(_mm_castps_si128(_mm_set_ss(A.V))));
+}
+
+inline lane_f32
+CastLaneI32ToF32(lane_i32 A)
+{
+    return InitLaneF32(_mm_cvtss_f32(_mm_castsi128_ps(_mm_cvtsi32_si128(A.V))));
+}
+
+inline lane_f32
+LoadLaneF16(uint16_t* Values)
+{
+    return InitLaneF32(ConvertHalfToF32(Values[0]));
+}
+
+inline void
+StoreLaneF16(uint16_t* Dest, lane_f32 A)
+{
+    Dest[0] = ConvertF32ToHalf(A.V);
+}
+
+inline vector3
+ConvertHalfV3(vector3h A)
+{
+    vector3 Result;
+    Result.X = ConvertHalfToF32(A.X);
+    Result.Y = ConvertHalfToF32(A.Y);
+    Result.Z = ConvertHalfToF32(A.Z);
+    Result.Padding = 0.0f;
+    return Result;
+}
+
+inline lane_f32
+RSquareRoot(lane_f32 A)
+{
+    return InitLaneF32(_mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(A.V))));
+}
+
+inline lane_f32
+Min(lane_f32 A, lane_f32 Bound)
+{
+    return InitLaneF32(MIN(A.V, Bound.V));
+}
+
+inline lane_f32
+Max(lane_f32 A, lane_f32 Bound)
+{
+    return InitLaneF32(MAX(A.V, Bound.V));
+}
+
+inline lane_f32
+Clamp(lane_f32 A, lane_f32 LowerBound, lane_f32 UpperBound)
+{
+    return Max(Min(A, UpperBound), LowerBound);
+}
+
+inline lane_f32
+MultiplyAdd(lane_f32 A, lane_f32 B, lane_f32 C)
+{
+    return InitLaneF32(A.V * B.V + C.V);
+}
+
+inline lane_f32
+Floor(lane_f32 A)
+{
+    return InitLaneF32(floorf(A.V));
+}
+
+inline lane_f32
+operator+(lane_f32 A, lane_f32 B)
+{
+    return InitLaneF32(A.V + B.V);
+}
+
+inline lane_f32
+operator-(lane_f32 A, lane_f32 B)
+{
+    return InitLaneF32(A.V - B.V);
+}
+
+inline lane_f32
+operator*(lane_f32 A, lane_f32 B)
+{
+    return InitLaneF32(A.V * B.V);
+}
+
+inline lane_f32
+operator/(lane_f32 A, lane_f32 B)
+{
+    return InitLaneF32(A.V / B.V);
+}
+
+inline lane_f32
+operator<(lane_f32 A, lane_f32 B)
+{
+    return CastLaneI32ToF32(InitLaneI32(A.V < B.V ? -1 : 0));
+}
+
+inline lane_f32
+operator<=(lane_f32 A, lane_f32 B)
+{
+    return CastLaneI32ToF32(InitLaneI32(A.V <= B.V ? -1 : 0));
+}
+
+inline lane_f32
+operator>(lane_f32 A, lane_f32 B)
+{
+    return CastLaneI32ToF32(InitLaneI32(A.V > B.V ? -1 : 0));
+}
+
+inline lane_f32
+operator&(lane_f32 A, lane_f32 B)
+{
+    return CastLaneI32ToF32(CastLaneF32ToI32(A) & CastLaneF32ToI32(B));
+}
+
+inline lane_f32
+operator|(lane_f32 A, lane_f32 B)
+{
+    return CastLaneI32ToF32(CastLaneF32ToI32(A) | CastLaneF32ToI32(B));
+}
+
+inline lane_f32
+And(lane_f32 A, lane_f32 B)
+{
+    return A & B;
+}
+
+inline lane_f32
+AndNot(lane_f32 A, lane_f32 B)
+{
+    return CastLaneI32ToF32(AndNot(CastLaneF32ToI32(A), CastLaneF32ToI32(B)));
+}
+
+inline lane_f32
+Or(lane_f32 A, lane_f32 B)
+{
+    return A | B;
+}
+
+/////////////
+// Lane V3
+/////////////
+
+inline lane_v3
+InitLaneV3(float X, float Y, float Z)
+{
+    lane_v3 Result;
+    Result.X = InitLaneF32(X);
+    Result.Y = InitLaneF32(Y);
+    Result.Z = InitLaneF32(Z);
+    return Result;
+}
+
+inline lane_v3
+LoadLaneV3(vector3* Values)
+{
+    return InitLaneV3(Values[0].X, Values[0].Y, Values[0].Z);
+}
+
+inline lane_f32
+MagnitudeSq(lane_v3 A)
+{
+    return A.X * A.X + A.Y * A.Y + A.Z * A.Z;
+}
+
+inline lane_v3
+operator+(lane_v3 A, lane_v3 B)
+{
+    A.X = A.X + B.X;
+    A.Y = A.Y + B.Y;
+    A.Z = A.Z + B.Z;
+    return A;
+}
+
+inline lane_v3
+operator-(lane_v3 A, lane_v3 B)
+{
+    A.X = A.X - B.X;
+    A.Y = A.Y - B.Y;
+    A.Z = A.Z - B.Z;
+    return A;
+}
+
+inline lane_v3
+operator*(lane_v3 A, lane_f32 B)
+{
+    A.X = A.X * B;
+    A.Y = A.Y * B;
+    A.Z = A.Z * B;
+    return A;
+}
+
+#define SABLUJO_SSE_LANE1_H
+#endif //SABLUJO_SSE_LANE1_H
@@ -0,0 +1,459 @@
+#ifndef SABLUJO_SSE_LANE16_H
+
+// NOTE: Only uses AVX-512F, float bitwise operations go through the integer
+// instructions since the float ones need AVX-512DQ
+using lane_f32 = __m512;
+using lane_i32 = __m512i;
+
+// NOTE: Integer comparisons produce mask registers instead of vectors, float comparisons
+// still expand to vectors since the common maths blends them with bitwise operations
+struct lane_mask
+{
+    __mmask16 Bits;
+};
+
+struct lane_v3
+{
+    lane_f32 X;
+    lane_f32 Y;
+    lane_f32 Z;
+};
+
+inline lane_i32
+InitLaneI32(int32_t Value)
+{
+    return _mm512_set1_epi32(Value);
+}
+
+inline lane_i32
+InitIncrementalLaneI32(int32_t BaseValue)
+{
+    return _mm512_add_epi32(_mm512_set1_epi32(BaseValue),
+                            _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+inline lane_i32
+LoadLaneI32(int32_t* Values)
+{
+    return _mm512_loadu_si512(Values);
+}
+
+inline void
+StoreLaneI32(int32_t* Dest, lane_i32 A)
+{
+    _mm512_storeu_si512(Dest, A);
+}
+
+// NOTE: Lane i of the result is lane Indices[i] of A
+inline lane_i32
+PermuteLanes(lane_i32 A, lane_i32 Indices)
+{
+    return _mm512_permutexvar_epi32(Indices, A);
+}
+
+// NOTE: Lane i of the result is Base[Indices[i]]
+inline lane_i32
+GatherLaneI32(int32_t* Base, lane_i32 Indices)
+{
+    return _mm512_i32gather_epi32(Indices, Base, 4);
+}
+
+inline int32_t
+IsAllZeros(lane_i32 A)
+{
+    return _mm512_test_epi32_mask(A, A) == 0;
+}
+
+inline int32_t
+IsAllZeros(lane_mask A)
+{
+    return A.Bits == 0;
+}
+
+inline int32_t
+CountSetLanes(lane_mask A)
+{
+    return _mm_popcnt_u32(A.Bits);
+}
+
+inline lane_i32
+operator+(lane_i32 A, lane_i32 B)
+{
+    return _mm512_add_epi32(A, B);
+}
+
+inline lane_i32
+operator-(lane_i32 A, lane_i32 B)
+{
+    return _mm512_sub_epi32(A, B);
+}
+
+inline lane_i32
+operator*(lane_i32 A, int32_t B)
+{
+    return _mm512_mullo_epi32(A, InitLaneI32(B));
+}
+
+inline lane_i32
+operator*(int32_t A, lane_i32 B)
+{
+    return B * A;
+}
+
+inline lane_i32
+operator*(lane_i32 A, lane_i32 B)
+{
+    return _mm512_mullo_epi32(A, B);
+}
+
+inline lane_mask
+operator<(lane_i32 A, lane_i32 B)
+{
+    lane_mask Result;
+    Result.Bits = _mm512_cmplt_epi32_mask(A, B);
+    return Result;
+}
+
+inline lane_mask
+operator==(lane_i32 A, lane_i32 B)
+{
+    lane_mask Result;
+    Result.Bits = _mm512_cmpeq_epi32_mask(A, B);
+    return Result;
+}
+
+inline lane_i32
+operator|(lane_i32 A, lane_i32 B)
+{
+    return _mm512_or_si512(A,B);
+}
+
+inline lane_i32
+operator&(lane_i32 A, lane_i32 B)
+{
+    return _mm512_and_si512(A,B);
+}
+
+inline lane_i32
+AndNot(lane_i32 A, lane_i32 B)
+{
+    return _mm512_andnot_si512(A,B);
+}
+
+inline lane_i32
+operator<<(lane_i32 A, int32_t B)
+{
+    return _mm512_slli_epi32(A, B);
+}
+
+inline lane_i32
+operator>>(lane_i32 A, int32_t B)
+{
+    return _mm512_srli_epi32(A, B);
+}
+
+inline void
+ConditionalAssign(lane_i32 Source, lane_i32 *Dest, lane_mask Mask)
+{
+    *Dest = _mm512_mask_mov_epi32(*Dest, Mask.Bits, Source);
+}
+
+// NOTE: One masked store per block row, offset back by the lanes of the rows above so the
+// row's own lanes land on its pixels, much cheaper than a scatter
+template<int32_t StepX, int32_t StepY>
+inline void
+ConditionalStoreBlock(uint32_t* Base, int32_t PitchInPixels, lane_i32 Source, lane_mask Mask)
+{
+    if(StepY > 2)
+    {
+        lane_i32 Lanes = InitIncrementalLaneI32(0);
+        lane_i32 Offsets = _mm512_add_epi32(_mm512_mullo_epi32(_mm512_srli_epi32(Lanes, StepX == 2 ? 1 : 3), InitLaneI32(PitchInPixels)),
+                                            _mm512_and_si512(Lanes, InitLaneI32(StepX - 1)));
+        _mm512_mask_i32scatter_epi32(Base, Mask.Bits, Offsets, Source, 4);
+        return;
+    }
+    for(int32_t Y = 0; Y < StepY; ++Y)
+    {
+        __mmask16 RowBits = (__mmask16)(((1u << StepX) - 1) << (Y * StepX));
+        uint32_t* Row = Base + Y * PitchInPixels - Y * StepX;
+        _mm512_mask_storeu_epi32(Row, Mask.Bits & RowBits, Source);
+    }
+}
+
+/////////////
+// Lane F32
+/////////////
+
+inline lane_f32
+InitLaneF32(float Value)
+{
+    return _mm512_set1_ps(Value);
+}
+
+inline float
+GetLane(lane_f32 A, int32_t Lane)
+{
+    float Lanes[16];
+    _mm512_storeu_ps(Lanes, A);
+    return Lanes[Lane];
+}
+
+inline int32_t
+GetLane(lane_i32 A, int32_t Lane)
+{
+    int32_t Lanes[16];
+    _mm512_storeu_si512(Lanes, A);
+    return Lanes[Lane];
+}
+
+inline lane_f32
+RSquareRoot(lane_f32 A)
+{
+    return _mm512_rsqrt14_ps(A);
+}
+
+inline lane_f32
+Min(lane_f32 A, lane_f32 Bound)
+{
+    return _mm512_min_ps(A, Bound);
+}
+
+inline lane_f32
+Max(lane_f32 A, lane_f32 Bound)
+{
+    return _mm512_max_ps(A, Bound);
+}
+
+inline lane_f32
+Clamp(lane_f32 A, lane_f32 LowerBound, lane_f32 UpperBound)
+{
+    return _mm512_max_ps(_mm512_min_ps(A, UpperBound), LowerBound);
+}
+
+inline lane_f32
+MultiplyAdd(lane_f32 A, lane_f32 B, lane_f32 C)
+{
+    return _mm512_fmadd_ps(A, B, C);
+}
+
+inline lane_f32
+Floor(lane_f32 A)
+{
+    return _mm512_roundscale_ps(A, _MM_FROUND_TO_NEG_INF);
+}
+
+inline lane_f32
+operator+(lane_f32 A, lane_f32 B)
+{
+    return _mm512_add_ps(A,B);
+}
+
+inline lane_f32
+operator-(lane_f32 A, lane_f32 B)
+{
+    return _mm512_sub_ps(A,B);
+}
+
+inline lane_f32
+operator*(lane_f32 A, lane_f32 B)
+{
+    return _mm512_mul_ps(A,B);
+}
+
+inline lane_f32
+operator/(lane_f32 A, lane_f32 B)
+{
+    return _mm512_div_ps(A,B);
+}
+
+inline lane_f32
+ExpandMask(__mmask16 Mask)
+{
+    return _mm512_castsi512_ps(_mm512_maskz_set1_epi32(Mask, -1));
+}
+
+inline lane_f32
+operator<(lane_f32 A, lane_f32 B)
+{
+    return ExpandMask(_mm512_cmp_ps_mask(A,B, _CMP_LT_OQ));
+}
+
+inline lane_f32
+operator<=(lane_f32 A, lane_f32 B)
+{
+    return ExpandMask(_mm512_cmp_ps_mask(A,B, _CMP_LE_OQ));
+}
+
+inline lane_f32
+operator>(lane_f32 A, lane_f32 B)
+{
+    return ExpandMask(_mm512_cmp_ps_mask(A,B, _CMP_GT_OQ));
+}
+
+inline lane_f32
+operator&(lane_f32 A, lane_f32 B)
+{
+    return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(A), _mm512_castps_si512(B)));
+}
+
+inline lane_f32
+operator|(lane_f32 A, lane_f32 B)
+{
+    return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(A), _mm512_castps_si512(B)));
+}
+
+inline lane_f32
+And(lane_f32 A, lane_f32 B)
+{
+    return A & B;
+}
+
+inline lane_f32
+AndNot(lane_f32 A, lane_f32 B)
+{
+    return _mm512_castsi512_ps(_mm512_andnot_si512(_mm512_castps_si512(A), _mm512_castps_si512(B)));
+}
+
+inline lane_f32
+Or(lane_f32 A, lane_f32 B)
+{
+    return A | B;
+}
+
+/////////////
+// Lane V3
+/////////////
+
+inline lane_v3
+InitLaneV3(float X, float Y, float Z)
+{
+    lane_v3 Result;
+    Result.X = _mm512_set1_ps(X);
+    Result.Y = _mm512_set1_ps(Y);
+    Result.Z = _mm512_set1_ps(Z);
+    return Result;
+}
+
+inline lane_v3
+LoadLaneV3(vector3* Values)
+{
+    float X[16];
+    float Y[16];
+    float Z[16];
+    for(int32_t Lane = 0; Lane < 16; ++Lane)
+    {
+        X[Lane] = Values[Lane].X;
+        Y[Lane] = Values[Lane].Y;
+        Z[Lane] = Values[Lane].Z;
+    }
+    
+    lane_v3 Result;
+    Result.X = _mm512_loadu_ps(X);
+    Result.Y = _mm512_loadu_ps(Y);
+    Result.Z = _mm512_loadu_ps(Z);
+    return Result;
+}
+
+inline lane_f32
+MagnitudeSq(lane_v3 A)
+{
+    lane_f32 Result;
+    Result = A.X * A.X + A.Y * A.Y + A.Z * A.Z;
+    return Result;
+}
+
+inline lane_v3
+operator+(lane_v3 A, lane_v3 B)
+{
+    A.X = _mm512_add_ps(A.X, B.X);
+    A.Y = _mm512_add_ps(A.Y, B.Y);
+    A.Z = _mm512_add_ps(A.Z, B.Z);
+    return A;
+}
+
+inline lane_v3
+operator-(lane_v3 A, lane_v3 B)
+{
+    A.X = _mm512_sub_ps(A.X, B.X);
+    A.Y = _mm512_sub_ps(A.Y, B.Y);
+    A.Z = _mm512_sub_ps(A.Z, B.Z);
+    return A;
+}
+
+inline lane_v3
+operator*(lane_v3 A, lane_f32 B)
+{
+    A.X = _mm512_mul_ps(A.X, B);
+    A.Y = _mm512_mul_ps(A.Y, B);
+    A.Z = _mm512_mul_ps(A.Z, B);
+    return A;
+}
+
+////////////////////////
+// Casts & Conversions
+////////////////////////
+
+inline lane_f32
+ConvertLaneI32ToF32(lane_i32 A)
+{
+    return _mm512_cvtepi32_ps(A);
+}
+
+inline lane_i32
+ConvertLaneF32ToI32(lane_f32 A)
+{
+    return _mm512_cvtps_epi32(A);
+}
+
+inline lane_i32
+TruncateLaneF32ToI32(lane_f32 A)
+{
+    return _mm512_cvttps_epi32(A);
+}
+
+inline lane_i32
+CastLaneF32ToI32(lane_f32 A)
+{
+    return _mm512_castps_si512(A);
+}
+
+inline lane_f32
+CastLaneI32ToF32(lane_i32 A)
+{
+    return _mm512_castsi512_ps(A);
+}
+
+#define LANE_F16C 1
+inline lane_f32
+LoadLaneF16(uint16_t* Values)
+{
+    return _mm512_cvtph_ps(_mm256_loadu_si256((__m256i*)Values));
+}
+
+inline void
+StoreLaneF16(uint16_t* Dest, lane_f32 A)
+{
+    _mm256_storeu_si256((__m256i*)Dest, _mm512_cvtps_ph(A, _MM_FROUND_TO_NEAREST_INT));
+}
+
+inline vector3
+ConvertHalfV3(vector3h A)
+{
+    vector3 Result;
+    Result.vec = _mm_cvtph_ps(_mm_loadl_epi64((__m128i*)&A));
+    return Result;
+}
+
+inline lane_v3
+InitLaneV3(vector3h A)
+{
+    __m128 Value = _mm_cvtph_ps(_mm_loadl_epi64((__m128i*)&A));
+    lane_v3 Result;
+    Result.X = _mm512_broadcastss_ps(Value);
+    Result.Y = _mm512_broadcastss_ps(_mm_movehdup_ps(Value));
+    Result.Z = _mm512_broadcastss_ps(_mm_movehl_ps(Value, Value));
+    return Result;
+}
+
+#define SABLUJO_SSE_LANE16_H
+#endif //SABLUJO_SSE_LANE16_H
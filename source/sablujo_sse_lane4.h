@@ -1,9 +1,9 @@
 #ifndef SABLUJO_SSE_LANE4_H
 
-#include <immintrin.h>
-
 using lane_f32 = __m128;
 using lane_i32 = __m128i;
+// NOTE: Comparisons set every bit of the lanes that pass
+using lane_mask = lane_i32;
 
 struct lane_v3
 {
@@ -18,12 +18,6 @@ struct lane_f32
     __m128 Value;
 }
 */
-global_variable lane_i32 LaneZeroI32 = _mm_setzero_si128();
-global_variable lane_f32 LaneZeroF32 = _mm_setzero_ps();
-
-global_variable lane_i32 LaneOneI32 = _mm_set1_epi32(1);
-global_variable lane_f32 LaneOneF32 = _mm_set_ps1(1.0f);
-global_variable lane_f32 LaneZeroPointFive = _mm_set_ps1(0.5f);
 
 inline lane_i32 
 InitLaneI32(int32_t Value)
@@ -43,6 +37,32 @@ LoadLaneI32(int32_t* Values)
     return _mm_setr_epi32(Values[0], Values[1], Values[2], Values[3]);
 }
 
+inline void
+StoreLaneI32(int32_t* Dest, lane_i32 A)
+{
+    _mm_storeu_si128((__m128i*)Dest, A);
+}
+
+// NOTE: Lane i of the result is lane Indices[i] of A. No 32-bit variable permute before AVX2,
+// the lane indices are turned into byte indices for the SSSE3 shuffle.
+inline lane_i32
+PermuteLanes(lane_i32 A, lane_i32 Indices)
+{
+    __m128i ByteIndices = _mm_shuffle_epi8(_mm_slli_epi32(Indices, 2),
+                                           _mm_setr_epi8(0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12));
+    ByteIndices = _mm_add_epi8(ByteIndices, _mm_set1_epi32(0x03020100));
+    return _mm_shuffle_epi8(A, ByteIndices);
+}
+
+// NOTE: Lane i of the result is Base[Indices[i]]. No gathers before AVX2, the indices are
+// extracted and the lanes loaded one by one
+inline lane_i32
+GatherLaneI32(int32_t* Base, lane_i32 Indices)
+{
+    return _mm_setr_epi32(Base[_mm_cvtsi128_si32(Indices)], Base[_mm_extract_epi32(Indices, 1)],
+                          Base[_mm_extract_epi32(Indices, 2)], Base[_mm_extract_epi32(Indices, 3)]);
+}
+
 inline int32_t
 IsAllZeros(lane_i32 A)
 {
@@ -55,6 +75,14 @@ operator-(lane_i32 A, lane_i32 B)
     return _mm_sub_epi32(A, B);
 }
 
+inline int32_t
+CountSetLanes(lane_i32 A)
+{
+    // NOTE: POPCNT is not part of the SSE4.1 baseline
+    int32_t Bits = _mm_movemask_ps(_mm_castsi128_ps(A));
+    return (Bits & 1) + ((Bits >> 1) & 1) + ((Bits >> 2) & 1) + ((Bits >> 3) & 1);
+}
+
 inline lane_i32
 operator+(lane_i32 A, lane_i32 B)
 {
@@ -91,6 +119,12 @@ operator<(lane_i32 A, lane_i32 B)
     return _mm_cmplt_epi32(A, B);
 }
 
+inline lane_i32
+operator==(lane_i32 A, lane_i32 B)
+{
+    return _mm_cmpeq_epi32(A, B);
+}
+
 inline lane_i32
 operator|(lane_i32 A, lane_i32 B)
 {
@@ -125,7 +159,34 @@ AndNot(lane_i32 A, lane_i32 B)
 inline void
 ConditionalAssign(lane_i32 Source, lane_i32 *Dest, lane_i32 Mask)
 {
-    *Dest = AndNot(Mask, *Dest) | Mask & Source;
+    *Dest = AndNot(Mask, *Dest) | (Mask & Source);
+}
+
+// NOTE: SSE4.1 has no masked 32 bit store, full rows are stored whole and the rest lane by lane
+template<int32_t StepX, int32_t StepY>
+inline void
+ConditionalStoreBlock(uint32_t* Base, int32_t PitchInPixels, lane_i32 Source, lane_mask Mask)
+{
+    int32_t Bits = _mm_movemask_ps(_mm_castsi128_ps(Mask));
+    if(StepX == 4 && Bits == 0xF)
+    {
+        _mm_storeu_si128((__m128i*)Base, Source);
+        return;
+    }
+    
+    int32_t SourceLanes[4];
+    _mm_storeu_si128((__m128i*)SourceLanes, Source);
+    for(int32_t Y = 0; Y < StepY; ++Y)
+    {
+        for(int32_t X = 0; X < StepX; ++X)
+        {
+            int32_t Lane = Y * StepX + X;
+            if(Bits & (1 << Lane))
+            {
+                Base[Y * PitchInPixels + X] = (uint32_t)SourceLanes[Lane];
+            }
+        }
+    }
 }
 
 /////////////
@@ -142,13 +203,17 @@ InitLaneF32(float Value)
 inline float
 GetLane(lane_f32 A, int32_t Lane)
 {
-    return A.m128_f32[Lane];
+    float Lanes[4];
+    _mm_storeu_ps(Lanes, A);
+    return Lanes[Lane];
 }
 
 inline int32_t
 GetLane(lane_i32 A, int32_t Lane)
 {
-    return A.m128i_i32[Lane];
+    int32_t Lanes[4];
+    _mm_storeu_si128((__m128i*)Lanes, A);
+    return Lanes[Lane];
 }
 
 
@@ -179,7 +244,14 @@ Clamp(lane_f32 A, lane_f32 LowerBound, lane_f32 UpperBound)
 inline lane_f32
 MultiplyAdd(lane_f32 A, lane_f32 B, lane_f32 C)
 {
-    return _mm_fmadd_ps(A, B, C);
+    // NOTE: No FMA on the SSE4.1 tier
+    return _mm_add_ps(_mm_mul_ps(A, B), C);
+}
+
+inline lane_f32
+Floor(lane_f32 A)
+{
+    return _mm_floor_ps(A);
 }
 
 inline lane_f32
@@ -329,6 +401,12 @@ ConvertLaneI32ToF32(lane_i32 A)
     return _mm_cvtepi32_ps(A);
 }
 
+inline lane_i32
+TruncateLaneF32ToI32(lane_f32 A)
+{
+    return _mm_cvttps_epi32(A);
+}
+
 inline lane_i32
 CastLaneF32ToI32(lane_f32 A)
 {
@@ -341,5 +419,36 @@ CastLaneI32ToF32(lane_i32 A)
     return _mm_castsi128_ps(A);
 }
 
+// NOTE: No F16C below AVX2, the out of line conversions from sablujo_maths.cpp are safe to
+// call since they are only ever built for the baseline instruction set
+inline lane_f32
+LoadLaneF16(uint16_t* Values)
+{
+    return _mm_setr_ps(ConvertHalfToF32(Values[0]), ConvertHalfToF32(Values[1]),
+                       ConvertHalfToF32(Values[2]), ConvertHalfToF32(Values[3]));
+}
+
+inline void
+StoreLaneF16(uint16_t* Dest, lane_f32 A)
+{
+    float Lanes[4];
+    _mm_storeu_ps(Lanes, A);
+    for(int32_t Lane = 0; Lane < 4; ++Lane)
+    {
+        Dest[Lane] = ConvertF32ToHalf(Lanes[Lane]);
+    }
+}
+
+inline vector3
+ConvertHalfV3(vector3h A)
+{
+    vector3 Result;
+    Result.X = ConvertHalfToF32(A.X);
+    Result.Y = ConvertHalfToF32(A.Y);
+    Result.Z = ConvertHalfToF32(A.Z);
+    Result.Padding = 0.0f;
+    return Result;
+}
+
 #define SABLUJO_SSE_LANE4_H
 #endif //SABLUJO_SSE_LANE4_H
@@ -1,9 +1,9 @@
 #ifndef SABLUJO_SSE_LANE8_H
 
-#include <immintrin.h>
-
 using lane_f32 = __m256;
 using lane_i32 = __m256i;
+// NOTE: Comparisons set every bit of the lanes that pass
+using lane_mask = lane_i32;
 
 struct lane_v3
 {
@@ -12,13 +12,6 @@ struct lane_v3
     lane_f32 Z;
 };
 
-global_variable lane_i32 LaneZeroI32 = _mm256_setzero_si256();
-global_variable lane_f32 LaneZeroF32 = _mm256_setzero_ps();
-
-global_variable lane_i32 LaneOneI32 = _mm256_set1_epi32(1);
-global_variable lane_f32 LaneOneF32 = _mm256_set1_ps(1.0f);
-global_variable lane_f32 LaneZeroPointFive = _mm256_set1_ps(0.5f);
-
 inline lane_i32 
 InitLaneI32(int32_t Value)
 {
@@ -38,12 +31,38 @@ LoadLaneI32(int32_t* Values)
                              Values[4], Values[5], Values[6], Values[7]);
 }
 
+inline void
+StoreLaneI32(int32_t* Dest, lane_i32 A)
+{
+    _mm256_storeu_si256((__m256i*)Dest, A);
+}
+
+// NOTE: Lane i of the result is lane Indices[i] of A
+inline lane_i32
+PermuteLanes(lane_i32 A, lane_i32 Indices)
+{
+    return _mm256_permutevar8x32_epi32(A, Indices);
+}
+
+// NOTE: Lane i of the result is Base[Indices[i]]
+inline lane_i32
+GatherLaneI32(int32_t* Base, lane_i32 Indices)
+{
+    return _mm256_i32gather_epi32(Base, Indices, 4);
+}
+
 inline int32_t
 IsAllZeros(lane_i32 A)
 {
     return _mm256_testz_si256(A, A);
 }
 
+inline int32_t
+CountSetLanes(lane_i32 A)
+{
+    return _mm_popcnt_u32(_mm256_movemask_ps(_mm256_castsi256_ps(A)));
+}
+
 inline lane_i32
 operator+(lane_i32 A, lane_i32 B)
 {
@@ -80,6 +99,12 @@ operator<(lane_i32 A, lane_i32 B)
     return _mm256_cmpgt_epi32(B, A);
 }
 
+inline lane_i32
+operator==(lane_i32 A, lane_i32 B)
+{
+    return _mm256_cmpeq_epi32(A, B);
+}
+
 inline lane_i32
 operator|(lane_i32 A, lane_i32 B)
 {
@@ -114,7 +139,23 @@ operator>>(lane_i32 A, int32_t B)
 inline void
 ConditionalAssign(lane_i32 Source, lane_i32 *Dest, lane_i32 Mask)
 {
-    *Dest = AndNot(Mask, *Dest) | Mask & Source;
+    *Dest = AndNot(Mask, *Dest) | (Mask & Source);
+}
+
+// NOTE: Row Y of the block holds lanes Y * StepX onwards, storing the whole vector StepX
+// pixels per row earlier puts them in place. Masked off lanes are neither read nor written.
+template<int32_t StepX, int32_t StepY>
+inline void
+ConditionalStoreBlock(uint32_t* Base, int32_t PitchInPixels, lane_i32 Source, lane_mask Mask)
+{
+    for(int32_t Y = 0; Y < StepY; ++Y)
+    {
+        lane_i32 RowLanes = InitIncrementalLaneI32(-Y * StepX);
+        lane_i32 RowMask = _mm256_and_si256(_mm256_cmpgt_epi32(RowLanes, InitLaneI32(-1)),
+                                            _mm256_cmpgt_epi32(InitLaneI32(StepX), RowLanes));
+        int32_t* Row = (int32_t*)(Base + Y * PitchInPixels - Y * StepX);
+        _mm256_maskstore_epi32(Row, _mm256_and_si256(Mask, RowMask), Source);
+    }
 }
 
 /////////////
@@ -131,13 +172,17 @@ InitLaneF32(float Value)
 inline float
 GetLane(lane_f32 A, int32_t Lane)
 {
-    return A.m256_f32[Lane];
+    float Lanes[8];
+    _mm256_storeu_ps(Lanes, A);
+    return Lanes[Lane];
 }
 
 inline int32_t
 GetLane(lane_i32 A, int32_t Lane)
 {
-    return A.m256i_i32[Lane];
+    int32_t Lanes[8];
+    _mm256_storeu_si256((__m256i*)Lanes, A);
+    return Lanes[Lane];
 }
 
 
@@ -171,6 +216,12 @@ MultiplyAdd(lane_f32 A, lane_f32 B, lane_f32 C)
     return _mm256_fmadd_ps(A, B, C);
 }
 
+inline lane_f32
+Floor(lane_f32 A)
+{
+    return _mm256_floor_ps(A);
+}
+
 /*
 inline lane_f32
 Pow(lane_f32 A, float Power)
@@ -336,6 +387,12 @@ ConvertLaneF32ToI32(lane_f32 A)
 }
 
 
+inline lane_i32
+TruncateLaneF32ToI32(lane_f32 A)
+{
+    return _mm256_cvttps_epi32(A);
+}
+
 inline lane_i32
 CastLaneF32ToI32(lane_f32 A)
 {
@@ -347,6 +404,40 @@ CastLaneI32ToF32(lane_i32 A)
 {
     return _mm256_castsi256_ps(A);
 }
+
+// NOTE: Half precision storage goes through F16C, DetectRasterTier requires it for this tier
+#define LANE_F16C 1
+inline lane_f32
+LoadLaneF16(uint16_t* Values)
+{
+    return _mm256_cvtph_ps(_mm_loadu_si128((__m128i*)Values));
+}
+
+inline void
+StoreLaneF16(uint16_t* Dest, lane_f32 A)
+{
+    _mm_storeu_si128((__m128i*)Dest, _mm256_cvtps_ph(A, _MM_FROUND_TO_NEAREST_INT));
+}
+
+inline vector3
+ConvertHalfV3(vector3h A)
+{
+    vector3 Result;
+    Result.vec = _mm_cvtph_ps(_mm_loadl_epi64((__m128i*)&A));
+    return Result;
+}
+
+// NOTE: Broadcasts from the converted register instead of going back through memory
+inline lane_v3
+InitLaneV3(vector3h A)
+{
+    __m128 Value = _mm_cvtph_ps(_mm_loadl_epi64((__m128i*)&A));
+    lane_v3 Result;
+    Result.X = _mm256_broadcastss_ps(Value);
+    Result.Y = _mm256_broadcastss_ps(_mm_movehdup_ps(Value));
+    Result.Z = _mm256_broadcastss_ps(_mm_movehl_ps(Value, Value));
+    return Result;
+}
 /*
 #define CastToLaneI32(A) (*(__m256i*)&(A))
 #define CastToLaneF32(A) (*(__m256*)&(A))
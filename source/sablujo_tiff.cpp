@@ -0,0 +1,151 @@
+#include "sablujo_tiff.h"
+
+#define TIFF_TYPE_SHORT 3
+#define TIFF_TYPE_LONG 4
+#define TIFF_TYPE_LONG8 16
+
+#define TIFF_ENTRIES_COUNT 11
+// NOTE: Header, then the only directory, then the tile offset and byte count arrays
+#define TIFF_HEADER_SIZE 16
+#define TIFF_DIRECTORY_SIZE (8 + TIFF_ENTRIES_COUNT * 20 + 8)
+#define TIFF_ARRAYS_OFFSET 256
+
+internal uint8_t*
+PutTIFFValue(uint8_t* At, uint64_t Value, uint32_t Size)
+{
+    // NOTE: Little endian, values smaller than their field are left justified
+    for(uint32_t Byte = 0; Byte < Size; ++Byte)
+    {
+        *At++ = (uint8_t)(Value >> (8 * Byte));
+    }
+    return At;
+}
+
+internal uint8_t*
+PutTIFFEntry(uint8_t* At, uint16_t Tag, uint16_t Type, uint64_t Count, uint64_t Value)
+{
+    At = PutTIFFValue(At, Tag, 2);
+    At = PutTIFFValue(At, Type, 2);
+    At = PutTIFFValue(At, Count, 8);
+    At = PutTIFFValue(At, Value, 8);
+    return At;
+}
+
+// NOTE: Streams Value, Value + Step, ... to the file without holding the whole array
+internal void
+WriteTIFFArray(tiff_writer* Writer, uint64_t Offset, uint64_t Count, uint64_t Value, uint64_t Step)
+{
+    uint64_t Block[512];
+    for(uint64_t Written = 0; Written < Count; )
+    {
+        uint64_t BlockCount = MIN(Count - Written, ArrayCount(Block));
+        for(uint64_t Index = 0; Index < BlockCount; ++Index)
+        {
+            Block[Index] = Value;
+            Value += Step;
+        }
+        Writer->Platform->WriteFileAt(&Writer->File, Offset + Written * sizeof(uint64_t), 
+                                      BlockCount * sizeof(uint64_t), Block);
+        Written += BlockCount;
+    }
+}
+
+bool 
+BeginTIFF(tiff_writer* Writer, platform_calls* Platform, memory_arena* Arena,
+          char* FileName, int32_t ImageWidth, int32_t ImageHeight)
+{
+    *Writer = {};
+    Writer->Platform = Platform;
+    Writer->ImageWidth = ImageWidth;
+    Writer->ImageHeight = ImageHeight;
+    Writer->TileCountX = (ImageWidth + TIFF_TILE_SIZE - 1) / TIFF_TILE_SIZE;
+    Writer->TileCountY = (ImageHeight + TIFF_TILE_SIZE - 1) / TIFF_TILE_SIZE;
+    Writer->TileScratch = PushArray(Arena, TIFF_TILE_BYTES, uint8_t);
+    
+    uint64_t TileCount = (uint64_t)Writer->TileCountX * Writer->TileCountY;
+    uint64_t OffsetsOffset = TIFF_ARRAYS_OFFSET;
+    uint64_t ByteCountsOffset = OffsetsOffset + TileCount * sizeof(uint64_t);
+    Writer->FirstTileOffset = ByteCountsOffset + TileCount * sizeof(uint64_t);
+    
+    Writer->File = Platform->OpenFileForWriting(FileName);
+    
+    uint8_t Header[TIFF_HEADER_SIZE + TIFF_DIRECTORY_SIZE];
+    uint8_t* At = Header;
+    *At++ = 'I';
+    *At++ = 'I';
+    At = PutTIFFValue(At, 43, 2);
+    At = PutTIFFValue(At, 8, 2);
+    At = PutTIFFValue(At, 0, 2);
+    At = PutTIFFValue(At, TIFF_HEADER_SIZE, 8);
+    
+    // NOTE: Entries sorted by tag, arrays that fit in 8 bytes must be stored inline
+    At = PutTIFFValue(At, TIFF_ENTRIES_COUNT, 8);
+    At = PutTIFFEntry(At, 256, TIFF_TYPE_LONG, 1, ImageWidth);
+    At = PutTIFFEntry(At, 257, TIFF_TYPE_LONG, 1, ImageHeight);
+    At = PutTIFFEntry(At, 258, TIFF_TYPE_SHORT, 3, 8 | (8 << 16) | ((uint64_t)8 << 32));
+    At = PutTIFFEntry(At, 259, TIFF_TYPE_SHORT, 1, 1);
+    At = PutTIFFEntry(At, 262, TIFF_TYPE_SHORT, 1, 2);
+    At = PutTIFFEntry(At, 277, TIFF_TYPE_SHORT, 1, 3);
+    At = PutTIFFEntry(At, 284, TIFF_TYPE_SHORT, 1, 1);
+    At = PutTIFFEntry(At, 322, TIFF_TYPE_LONG, 1, TIFF_TILE_SIZE);
+    At = PutTIFFEntry(At, 323, TIFF_TYPE_LONG, 1, TIFF_TILE_SIZE);
+    At = PutTIFFEntry(At, 324, TIFF_TYPE_LONG8, TileCount, TileCount == 1 ? Writer->FirstTileOffset : OffsetsOffset);
+    At = PutTIFFEntry(At, 325, TIFF_TYPE_LONG8, TileCount, TileCount == 1 ? TIFF_TILE_BYTES : ByteCountsOffset);
+    At = PutTIFFValue(At, 0, 8);
+    Assert(At == Header + sizeof(Header));
+    
+    Platform->WriteFileAt(&Writer->File, 0, sizeof(Header), Header);
+    WriteTIFFArray(Writer, OffsetsOffset, TileCount, Writer->FirstTileOffset, TIFF_TILE_BYTES);
+    WriteTIFFArray(Writer, ByteCountsOffset, TileCount, TIFF_TILE_BYTES, 0);
+    
+    return Writer->File.NoErrors;
+}
+
+void 
+WriteTIFFTiles(tiff_writer* Writer, game_offscreen_buffer* Buffer)
+{
+    Assert(Buffer->OriginX % TIFF_TILE_SIZE == 0 && Buffer->OriginY % TIFF_TILE_SIZE == 0);
+    Assert(Buffer->Width % TIFF_TILE_SIZE == 0 || Buffer->OriginX + Buffer->Width == Writer->ImageWidth);
+    Assert(Buffer->Height % TIFF_TILE_SIZE == 0 || Buffer->OriginY + Buffer->Height == Writer->ImageHeight);
+    
+    int32_t FirstTileX = Buffer->OriginX / TIFF_TILE_SIZE;
+    int32_t FirstTileY = Buffer->OriginY / TIFF_TILE_SIZE;
+    int32_t EndTileX = (Buffer->OriginX + Buffer->Width + TIFF_TILE_SIZE - 1) / TIFF_TILE_SIZE;
+    int32_t EndTileY = (Buffer->OriginY + Buffer->Height + TIFF_TILE_SIZE - 1) / TIFF_TILE_SIZE;
+    for(int32_t TileY = FirstTileY; TileY < EndTileY; ++TileY)
+    {
+        for(int32_t TileX = FirstTileX; TileX < EndTileX; ++TileX)
+        {
+            int32_t MinX = TileX * TIFF_TILE_SIZE - Buffer->OriginX;
+            int32_t MinY = TileY * TIFF_TILE_SIZE - Buffer->OriginY;
+            int32_t ValidWidth = MIN(TIFF_TILE_SIZE, Buffer->Width - MinX);
+            int32_t ValidHeight = MIN(TIFF_TILE_SIZE, Buffer->Height - MinY);
+            
+            // Swizzle to RGB, the padding outside of the image is black
+            uint8_t* Out = Writer->TileScratch;
+            for(int32_t Y = 0; Y < TIFF_TILE_SIZE; ++Y)
+            {
+                uint32_t* Row = (uint32_t*)((uint8_t*)Buffer->Memory + (MinY + MIN(Y, ValidHeight - 1)) * Buffer->Pitch) + MinX;
+                for(int32_t X = 0; X < TIFF_TILE_SIZE; ++X)
+                {
+                    uint32_t Color = (Y < ValidHeight && X < ValidWidth) ? Row[X] : 0;
+                    *Out++ = (uint8_t)(Color >> 16);
+                    *Out++ = (uint8_t)(Color >> 8);
+                    *Out++ = (uint8_t)Color;
+                }
+            }
+            
+            uint64_t TileIndex = (uint64_t)TileY * Writer->TileCountX + TileX;
+            Writer->Platform->WriteFileAt(&Writer->File, Writer->FirstTileOffset + TileIndex * TIFF_TILE_BYTES,
+                                          TIFF_TILE_BYTES, Writer->TileScratch);
+        }
+    }
+}
+
+bool 
+EndTIFF(tiff_writer* Writer)
+{
+    bool Result = Writer->File.NoErrors;
+    Writer->Platform->CloseFile(&Writer->File);
+    return Result;
+}
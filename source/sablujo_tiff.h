@@ -0,0 +1,30 @@
+#if !defined(SABLUJO_TIFF_H)
+
+#include "sablujo.h"
+
+// NOTE: Uncompressed 8-bit RGB BigTIFF, split in square tiles. Every tile has a fixed place
+// in the file, so they can be written in any order as soon as they are finished.
+#define TIFF_TILE_SIZE 256
+#define TIFF_TILE_BYTES (TIFF_TILE_SIZE * TIFF_TILE_SIZE * 3)
+
+struct tiff_writer
+{
+    platform_calls* Platform;
+    platform_file_handle File;
+    int32_t ImageWidth;
+    int32_t ImageHeight;
+    int32_t TileCountX;
+    int32_t TileCountY;
+    uint64_t FirstTileOffset;
+    uint8_t* TileScratch;
+};
+
+bool BeginTIFF(tiff_writer* Writer, platform_calls* Platform, memory_arena* Arena,
+               char* FileName, int32_t ImageWidth, int32_t ImageHeight);
+// NOTE: Buffer origin must be aligned on TIFF_TILE_SIZE, it writes every tile starting inside
+// the buffer and pads the ones crossing the image edge
+void WriteTIFFTiles(tiff_writer* Writer, game_offscreen_buffer* Buffer);
+bool EndTIFF(tiff_writer* Writer);
+
+#define SABLUJO_TIFF_H
+#endif
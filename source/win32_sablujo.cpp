@@ -40,6 +40,7 @@ Win32LoadGameCode(char *SourceDLLName, char *TempDLLName)
     {
         Result.DLLLastWriteTime = Win32GetLastWriteTime(SourceDLLName);
         Result.UpdateAndRender = (game_update_and_render*)GetProcAddress(Result.GameDLL, "GameUpdateAndRender");
+        Result.RenderOffline = (game_render_offline*)GetProcAddress(Result.GameDLL, "GameRenderOffline");
     }
     return Result;
 }
@@ -52,6 +53,7 @@ Win32UnloadGameCode(win32_game_code* GameCode)
         FreeLibrary(GameCode->GameDLL);
     }
     GameCode->UpdateAndRender = 0;
+    GameCode->RenderOffline = 0;
 }
 
 internal win32_window_dimension
@@ -184,6 +186,605 @@ CatStrings(size_t SourceACount, char *SourceA,
     *Dest++ = 0;
 }
 
+internal platform_file_handle
+Win32OpenFileForReading(char* FileName)
+{
+    platform_file_handle Result = {};
+    HANDLE FileHandle = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    Result.NoErrors = (FileHandle != INVALID_HANDLE_VALUE);
+    Result.Platform = FileHandle;
+    return(Result);
+}
+
+internal platform_file_handle
+Win32OpenFileForWriting(char* FileName)
+{
+    platform_file_handle Result = {};
+    HANDLE FileHandle = CreateFileA(FileName, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    Result.NoErrors = (FileHandle != INVALID_HANDLE_VALUE);
+    Result.Platform = FileHandle;
+    return(Result);
+}
+
+internal void
+Win32WriteFileAt(platform_file_handle* Handle, uint64_t Offset, uint64_t Size, void* Source)
+{
+    uint8_t* At = (uint8_t*)Source;
+    while(Handle->NoErrors && Size)
+    {
+        OVERLAPPED Overlapped = {};
+        Overlapped.Offset = (DWORD)(Offset & 0xFFFFFFFF);
+        Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+        
+        DWORD BytesToWrite = (DWORD)MIN(Size, Megabytes(64));
+        DWORD BytesWritten;
+        if(WriteFile((HANDLE)Handle->Platform, At, BytesToWrite, &BytesWritten, &Overlapped) &&
+           BytesWritten == BytesToWrite)
+        {
+            At += BytesWritten;
+            Offset += BytesWritten;
+            Size -= BytesWritten;
+        }
+        else
+        {
+            Handle->NoErrors = false;
+        }
+    }
+}
+
+internal void
+Win32ReadFileAt(platform_file_handle* Handle, uint64_t Offset, uint64_t Size, void* Dest)
+{
+    uint8_t* At = (uint8_t*)Dest;
+    while(Handle->NoErrors && Size)
+    {
+        OVERLAPPED Overlapped = {};
+        Overlapped.Offset = (DWORD)(Offset & 0xFFFFFFFF);
+        Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+        
+        DWORD BytesToRead = (DWORD)MIN(Size, Megabytes(64));
+        DWORD BytesRead;
+        if(ReadFile((HANDLE)Handle->Platform, At, BytesToRead, &BytesRead, &Overlapped) &&
+           BytesRead == BytesToRead)
+        {
+            At += BytesRead;
+            Offset += BytesRead;
+            Size -= BytesRead;
+        }
+        else
+        {
+            Handle->NoErrors = false;
+        }
+    }
+}
+
+internal void
+Win32CloseFile(platform_file_handle* Handle)
+{
+    if(Handle->Platform != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle((HANDLE)Handle->Platform);
+    }
+}
+
+internal void
+Win32AddEntry(platform_work_queue* Queue, platform_work_queue_callback* Callback, void* Data)
+{
+    // NOTE: Only the main thread adds entries
+    uint32_t NewNextEntryToWrite = (Queue->NextEntryToWrite + 1) % ArrayCount(Queue->Entries);
+    Assert(NewNextEntryToWrite != Queue->NextEntryToRead);
+    platform_work_queue_entry* Entry = Queue->Entries + Queue->NextEntryToWrite;
+    Entry->Callback = Callback;
+    Entry->Data = Data;
+    ++Queue->CompletionGoal;
+    _WriteBarrier();
+    Queue->NextEntryToWrite = NewNextEntryToWrite;
+    ReleaseSemaphore(Queue->SemaphoreHandle, 1, 0);
+}
+
+internal bool
+Win32DoNextWorkQueueEntry(platform_work_queue* Queue, uint32_t ThreadIndex)
+{
+    bool ShouldSleep = false;
+    
+    uint32_t OriginalNextEntryToRead = Queue->NextEntryToRead;
+    uint32_t NewNextEntryToRead = (OriginalNextEntryToRead + 1) % ArrayCount(Queue->Entries);
+    if(OriginalNextEntryToRead != Queue->NextEntryToWrite)
+    {
+        uint32_t Index = InterlockedCompareExchange((LONG volatile*)&Queue->NextEntryToRead,
+                                                   NewNextEntryToRead,
+                                                   OriginalNextEntryToRead);
+        if(Index == OriginalNextEntryToRead)
+        {
+            platform_work_queue_entry Entry = Queue->Entries[Index];
+            Entry.Callback(Queue, ThreadIndex, Entry.Data);
+            InterlockedIncrement((LONG volatile*)&Queue->CompletionCount);
+        }
+    }
+    else
+    {
+        ShouldSleep = true;
+    }
+    
+    return(ShouldSleep);
+}
+
+internal void
+Win32CompleteAllWork(platform_work_queue* Queue)
+{
+    while(Queue->CompletionGoal != Queue->CompletionCount)
+    {
+        Win32DoNextWorkQueueEntry(Queue, 0);
+    }
+    
+    Queue->CompletionGoal = 0;
+    Queue->CompletionCount = 0;
+}
+
+DWORD WINAPI
+ThreadProc(LPVOID lpParameter)
+{
+    win32_thread_startup* Thread = (win32_thread_startup*)lpParameter;
+    platform_work_queue* Queue = Thread->Queue;
+    
+    if(Thread->IsPinned)
+    {
+        SetThreadGroupAffinity(GetCurrentThread(), &Thread->Affinity, 0);
+    }
+    
+    for(;;)
+    {
+        if(Win32DoNextWorkQueueEntry(Queue, Thread->ThreadIndex))
+        {
+            WaitForSingleObjectEx(Queue->SemaphoreHandle, INFINITE, FALSE);
+        }
+    }
+}
+
+internal void
+Win32MakeQueue(platform_work_queue* Queue, uint32_t ThreadCount, win32_thread_startup* Startups)
+{
+    // NOTE: Startups come filled with the pinning of each worker
+    Queue->CompletionGoal = 0;
+    Queue->CompletionCount = 0;
+    
+    Queue->NextEntryToWrite = 0;
+    Queue->NextEntryToRead = 0;
+    
+    uint32_t InitialCount = 0;
+    Queue->SemaphoreHandle = CreateSemaphoreEx(0, InitialCount, MAX(ThreadCount, 1), 0, 0, SEMAPHORE_ALL_ACCESS);
+    
+    for(uint32_t ThreadIndex = 0; ThreadIndex < ThreadCount; ++ThreadIndex)
+    {
+        win32_thread_startup* Startup = Startups + ThreadIndex;
+        Startup->Queue = Queue;
+        // NOTE: Worker indices start at 1, the main thread is 0
+        Startup->ThreadIndex = ThreadIndex + 1;
+        
+        DWORD ThreadID;
+        HANDLE ThreadHandle = CreateThread(0, 0, ThreadProc, Startup, 0, &ThreadID);
+        CloseHandle(ThreadHandle);
+    }
+}
+
+internal bool
+Win32TokenEquals(char* Token, size_t TokenLength, char* String)
+{
+    for(size_t Index = 0; Index < TokenLength; ++Index)
+    {
+        if(String[Index] != Token[Index])
+        {
+            return false;
+        }
+    }
+    return String[TokenLength] == 0;
+}
+
+internal uint32_t
+Win32ParseUInt32(char* Digits, char* End, char** Next)
+{
+    uint32_t Result = 0;
+    char* Digit = Digits;
+    for(; Digit < End && *Digit >= '0' && *Digit <= '9'; ++Digit)
+    {
+        Result = Result * 10 + (*Digit - '0');
+    }
+    *Next = Digit;
+    return(Result);
+}
+
+internal win32_render_options
+Win32ParseRenderOptions(char* CommandLine)
+{
+    win32_render_options Options = {};
+    Options.PinPolicy = Win32Pin_Cores;
+    Options.OfflineWidth = 16384;
+    Options.OfflineHeight = 16384;
+    
+    char* Option = 0;
+    size_t OptionLength = 0;
+    char* Scan = CommandLine;
+    for(;;)
+    {
+        while(*Scan == ' ')
+        {
+            ++Scan;
+        }
+        char* Token = Scan;
+        while(*Scan && *Scan != ' ')
+        {
+            ++Scan;
+        }
+        size_t TokenLength = Scan - Token;
+        if(TokenLength == 0)
+        {
+            break;
+        }
+        
+        char* Next;
+        // NOTE: Flags take no value
+        if(Win32TokenEquals(Token, TokenLength, "-calibrate"))
+        {
+            Options.CalibrateBlockShapes = true;
+            Option = 0;
+        }
+        else if(Option && Win32TokenEquals(Option, OptionLength, "-threads"))
+        {
+            Options.ThreadCount = Win32ParseUInt32(Token, Token + TokenLength, &Next);
+            Option = 0;
+        }
+        else if(Option && Win32TokenEquals(Option, OptionLength, "-offline"))
+        {
+            size_t Length = MIN(TokenLength, sizeof(Options.OfflineFileName) - 1);
+            for(size_t Index = 0; Index < Length; ++Index)
+            {
+                Options.OfflineFileName[Index] = Token[Index];
+            }
+            Options.OfflineFileName[Length] = 0;
+            Option = 0;
+        }
+        else if(Option && Win32TokenEquals(Option, OptionLength, "-size"))
+        {
+            uint32_t Width = Win32ParseUInt32(Token, Token + TokenLength, &Next);
+            if(Next < Token + TokenLength && *Next == 'x')
+            {
+                uint32_t Height = Win32ParseUInt32(Next + 1, Token + TokenLength, &Next);
+                if(Width && Height && Width <= INT32_MAX && Height <= INT32_MAX)
+                {
+                    Options.OfflineWidth = (int32_t)Width;
+                    Options.OfflineHeight = (int32_t)Height;
+                }
+            }
+            Option = 0;
+        }
+        else if(Option && Win32TokenEquals(Option, OptionLength, "-pin"))
+        {
+            if(Win32TokenEquals(Token, TokenLength, "none"))
+            {
+                Options.PinPolicy = Win32Pin_None;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "cores"))
+            {
+                Options.PinPolicy = Win32Pin_Cores;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "smt"))
+            {
+                Options.PinPolicy = Win32Pin_SMT;
+            }
+            Option = 0;
+        }
+        else if(Option && Win32TokenEquals(Option, OptionLength, "-tier"))
+        {
+            if(Win32TokenEquals(Token, TokenLength, "scalar"))
+            {
+                Options.RasterTier = RasterTier_Scalar;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "sse4"))
+            {
+                Options.RasterTier = RasterTier_SSE4;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "avx2"))
+            {
+                Options.RasterTier = RasterTier_AVX2;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "avx512"))
+            {
+                Options.RasterTier = RasterTier_AVX512;
+            }
+            Option = 0;
+        }
+        else if(Option && Win32TokenEquals(Option, OptionLength, "-shading"))
+        {
+            if(Win32TokenEquals(Token, TokenLength, "float"))
+            {
+                Options.ShadingMode = ShadingMode_Float;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "fixed16"))
+            {
+                Options.ShadingMode = ShadingMode_Fixed16;
+            }
+            Option = 0;
+        }
+        else if(Option && Win32TokenEquals(Option, OptionLength, "-lighting"))
+        {
+            if(Win32TokenEquals(Token, TokenLength, "pixel"))
+            {
+                Options.SphereShadingFrequency = ShadingFrequency_Pixel;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "vertex"))
+            {
+                Options.SphereShadingFrequency = ShadingFrequency_Vertex;
+            }
+            Option = 0;
+        }
+        else if(Option && Win32TokenEquals(Option, OptionLength, "-shader"))
+        {
+            if(Win32TokenEquals(Token, TokenLength, "phong"))
+            {
+                Options.SceneShader = Shader_Phong;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "normals"))
+            {
+                Options.SceneShader = Shader_Normals;
+            }
+            Option = 0;
+        }
+        else if(Option && Win32TokenEquals(Option, OptionLength, "-lights"))
+        {
+            Options.SceneLocalLightCount = Win32ParseUInt32(Token, Token + TokenLength, &Next);
+            Option = 0;
+        }
+        else if(Option && Win32TokenEquals(Option, OptionLength, "-textures"))
+        {
+            if(Win32TokenEquals(Token, TokenLength, "on"))
+            {
+                Options.SceneTextures = true;
+                Options.SceneTextureFormat = TextureFormat_RGBA8;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "bc1"))
+            {
+                Options.SceneTextures = true;
+                Options.SceneTextureFormat = TextureFormat_BC1;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "bc4"))
+            {
+                Options.SceneTextures = true;
+                Options.SceneTextureFormat = TextureFormat_BC4;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "bc5"))
+            {
+                Options.SceneTextures = true;
+                Options.SceneTextureFormat = TextureFormat_BC5;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "off"))
+            {
+                Options.SceneTextures = false;
+            }
+            Option = 0;
+        }
+        else if(Option && Win32TokenEquals(Option, OptionLength, "-render"))
+        {
+            if(Win32TokenEquals(Token, TokenLength, "forward"))
+            {
+                Options.RenderMode = RenderMode_Forward;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "visibility"))
+            {
+                Options.RenderMode = RenderMode_VisibilityBuffer;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "deferred"))
+            {
+                Options.RenderMode = RenderMode_Deferred;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "checkerboard"))
+            {
+                Options.RenderMode = RenderMode_Checkerboard;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "prepass"))
+            {
+                Options.RenderMode = RenderMode_DepthPrepass;
+            }
+            Option = 0;
+        }
+        else if(Option && Win32TokenEquals(Option, OptionLength, "-vrs"))
+        {
+            if(Win32TokenEquals(Token, TokenLength, "off"))
+            {
+                Options.ShadingRateMode = ShadingRateMode_Full;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "auto"))
+            {
+                Options.ShadingRateMode = ShadingRateMode_Auto;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "foveated"))
+            {
+                Options.ShadingRateMode = ShadingRateMode_Foveated;
+            }
+            Option = 0;
+        }
+        else if(Option && Win32TokenEquals(Option, OptionLength, "-shadows"))
+        {
+            if(Win32TokenEquals(Token, TokenLength, "off"))
+            {
+                Options.SceneShadows = ShadowMode_Off;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "on"))
+            {
+                Options.SceneShadows = ShadowMode_Hard;
+            }
+            else if(Win32TokenEquals(Token, TokenLength, "pcf"))
+            {
+                Options.SceneShadows = ShadowMode_Filtered;
+            }
+            Option = 0;
+        }
+        else
+        {
+            Option = Token;
+            OptionLength = TokenLength;
+        }
+    }
+    
+    return(Options);
+}
+
+internal bool
+Win32IsBeforeInCacheOrder(win32_logical_processor* A, win32_logical_processor* B)
+{
+    if(A->L3Domain != B->L3Domain)
+    {
+        return A->L3Domain < B->L3Domain;
+    }
+    if(A->L2Domain != B->L2Domain)
+    {
+        return A->L2Domain < B->L2Domain;
+    }
+    if(A->CoreIndex != B->CoreIndex)
+    {
+        return A->CoreIndex < B->CoreIndex;
+    }
+    return A->SiblingIndex < B->SiblingIndex;
+}
+
+internal void
+Win32GetCPUTopology(win32_cpu_topology* Topology)
+{
+    *Topology = {};
+    
+    DWORD Size = 0;
+    GetLogicalProcessorInformationEx(RelationAll, 0, &Size);
+    uint8_t* Buffer = (uint8_t*)VirtualAlloc(0, Size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+    if(!Buffer)
+    {
+        return;
+    }
+    
+    if(GetLogicalProcessorInformationEx(RelationAll, (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)Buffer, &Size))
+    {
+        // NOTE: Cores first, caches are matched against their logical processors afterwards
+        SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* Info;
+        for(uint8_t* At = Buffer; At < Buffer + Size; At += Info->Size)
+        {
+            Info = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)At;
+            if(Info->Relationship != RelationProcessorCore)
+            {
+                continue;
+            }
+            
+            uint32_t SiblingIndex = 0;
+            for(WORD GroupIndex = 0; GroupIndex < Info->Processor.GroupCount; ++GroupIndex)
+            {
+                GROUP_AFFINITY* Group = Info->Processor.GroupMask + GroupIndex;
+                for(uint32_t Bit = 0; Bit < sizeof(KAFFINITY) * 8; ++Bit)
+                {
+                    KAFFINITY Mask = (KAFFINITY)1 << Bit;
+                    if((Group->Mask & Mask) && Topology->LogicalProcessorsCount < WIN32_MAX_LOGICAL_PROCESSORS)
+                    {
+                        win32_logical_processor* Processor = Topology->LogicalProcessors + Topology->LogicalProcessorsCount++;
+                        *Processor = {};
+                        Processor->Affinity.Group = Group->Group;
+                        Processor->Affinity.Mask = Mask;
+                        Processor->CoreIndex = Topology->CoresCount;
+                        Processor->SiblingIndex = SiblingIndex++;
+                    }
+                }
+            }
+            ++Topology->CoresCount;
+        }
+        
+        uint32_t L2Count = 0;
+        uint32_t L3Count = 0;
+        for(uint8_t* At = Buffer; At < Buffer + Size; At += Info->Size)
+        {
+            Info = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)At;
+            if(Info->Relationship != RelationCache ||
+               (Info->Cache.Level != 2 && Info->Cache.Level != 3) ||
+               Info->Cache.Type == CacheInstruction)
+            {
+                continue;
+            }
+            
+            uint32_t Domain = (Info->Cache.Level == 2) ? L2Count++ : L3Count++;
+            for(uint32_t ProcessorIndex = 0; ProcessorIndex < Topology->LogicalProcessorsCount; ++ProcessorIndex)
+            {
+                win32_logical_processor* Processor = Topology->LogicalProcessors + ProcessorIndex;
+                if(Processor->Affinity.Group == Info->Cache.GroupMask.Group &&
+                   (Processor->Affinity.Mask & Info->Cache.GroupMask.Mask))
+                {
+                    if(Info->Cache.Level == 2)
+                    {
+                        Processor->L2Domain = Domain;
+                    }
+                    else
+                    {
+                        Processor->L3Domain = Domain;
+                    }
+                }
+            }
+        }
+        
+        // NOTE: Insertion sort, there are only a few hundred processors at most
+        for(uint32_t Index = 1; Index < Topology->LogicalProcessorsCount; ++Index)
+        {
+            win32_logical_processor Processor = Topology->LogicalProcessors[Index];
+            uint32_t Insert = Index;
+            while(Insert > 0 && Win32IsBeforeInCacheOrder(&Processor, Topology->LogicalProcessors + Insert - 1))
+            {
+                Topology->LogicalProcessors[Insert] = Topology->LogicalProcessors[Insert - 1];
+                --Insert;
+            }
+            Topology->LogicalProcessors[Insert] = Processor;
+        }
+    }
+    
+    VirtualFree(Buffer, 0, MEM_RELEASE);
+}
+
+// NOTE: Fills the pinning of every render thread, the main thread included, and returns how many to run
+internal uint32_t
+Win32PlaceRenderThreads(win32_cpu_topology* Topology, win32_render_options* Options,
+                        win32_thread_startup* Startups, uint32_t* CacheDomains)
+{
+    // Candidates in cache order, so consecutive workers share as much cache as possible
+    win32_logical_processor* Candidates[WIN32_MAX_LOGICAL_PROCESSORS];
+    uint32_t CandidatesCount = 0;
+    for(uint32_t ProcessorIndex = 0; ProcessorIndex < Topology->LogicalProcessorsCount; ++ProcessorIndex)
+    {
+        win32_logical_processor* Processor = Topology->LogicalProcessors + ProcessorIndex;
+        if(Options->PinPolicy != Win32Pin_Cores || Processor->SiblingIndex == 0)
+        {
+            Candidates[CandidatesCount++] = Processor;
+        }
+    }
+    
+    uint32_t ThreadCount = Options->ThreadCount;
+    if(ThreadCount == 0)
+    {
+        SYSTEM_INFO SystemInfo;
+        GetSystemInfo(&SystemInfo);
+        ThreadCount = CandidatesCount ? CandidatesCount : (uint32_t)SystemInfo.dwNumberOfProcessors;
+    }
+    ThreadCount = MAX(1, MIN(ThreadCount, MAX_RENDER_THREAD_COUNT));
+    
+    bool IsPinned = Options->PinPolicy != Win32Pin_None && CandidatesCount > 0;
+    for(uint32_t ThreadIndex = 0; ThreadIndex < ThreadCount; ++ThreadIndex)
+    {
+        win32_thread_startup* Startup = Startups + ThreadIndex;
+        *Startup = {};
+        Startup->IsPinned = IsPinned;
+        CacheDomains[ThreadIndex] = 0;
+        if(IsPinned)
+        {
+            // NOTE: More threads than candidates wrap around, oversubscribing in cache order
+            win32_logical_processor* Processor = Candidates[ThreadIndex % CandidatesCount];
+            Startup->Affinity = Processor->Affinity;
+            CacheDomains[ThreadIndex] = Processor->L3Domain;
+        }
+    }
+    
+    return(ThreadCount);
+}
+
 int32_t CALLBACK 
 WinMain(HINSTANCE Instance,
         HINSTANCE PrevInstance,
@@ -280,11 +881,62 @@ WinMain(HINSTANCE Instance,
             GameMemory.PermanentStorage = VirtualAlloc(BaseAddress, TotalSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
             GameMemory.TransientStorage = (uint8_t*)GameMemory.PermanentStorage + GameMemory.PermanentStorageSize;
             
+            // Init Render Workers
+            win32_render_options RenderOptions = Win32ParseRenderOptions(CommandLine);
+            win32_cpu_topology* Topology = (win32_cpu_topology*)VirtualAlloc(0, sizeof(win32_cpu_topology), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+            Win32GetCPUTopology(Topology);
+            
+            win32_thread_startup RenderStartups[MAX_RENDER_THREAD_COUNT];
+            uint32_t RenderThreadCount = Win32PlaceRenderThreads(Topology, &RenderOptions, RenderStartups, 
+                                                                 GameMemory.RenderThreadCacheDomains);
+            VirtualFree(Topology, 0, MEM_RELEASE);
+            
+            // NOTE: The main thread renders as worker 0
+            if(RenderStartups[0].IsPinned)
+            {
+                SetThreadGroupAffinity(GetCurrentThread(), &RenderStartups[0].Affinity, 0);
+            }
+            platform_work_queue RenderQueue = {};
+            Win32MakeQueue(&RenderQueue, RenderThreadCount - 1, RenderStartups + 1);
+            GameMemory.RenderQueue = &RenderQueue;
+            GameMemory.RenderThreadCount = RenderThreadCount;
+            GameMemory.ForcedRasterTier = RenderOptions.RasterTier;
+            GameMemory.SceneShadingMode = RenderOptions.ShadingMode;
+            GameMemory.SphereShadingFrequency = RenderOptions.SphereShadingFrequency;
+            GameMemory.SceneShader = RenderOptions.SceneShader;
+            GameMemory.SceneLocalLightCount = RenderOptions.SceneLocalLightCount;
+            GameMemory.SceneTextures = RenderOptions.SceneTextures;
+            GameMemory.SceneTextureFormat = RenderOptions.SceneTextureFormat;
+            GameMemory.RenderMode = RenderOptions.RenderMode;
+            GameMemory.ShadingRateMode = RenderOptions.ShadingRateMode;
+            GameMemory.SceneShadows = RenderOptions.SceneShadows;
+            GameMemory.CalibrateBlockShapes = RenderOptions.CalibrateBlockShapes;
+            GameMemory.Platform.AddEntry = &Win32AddEntry;
+            GameMemory.Platform.CompleteAllWork = &Win32CompleteAllWork;
+            GameMemory.Platform.OpenFileForReading = &Win32OpenFileForReading;
+            GameMemory.Platform.OpenFileForWriting = &Win32OpenFileForWriting;
+            GameMemory.Platform.ReadFileAt = &Win32ReadFileAt;
+            GameMemory.Platform.WriteFileAt = &Win32WriteFileAt;
+            GameMemory.Platform.CloseFile = &Win32CloseFile;
+            
             //Init Game
             win32_game_code Game = Win32LoadGameCode(SourceGameCodeDLLFullPath, TempGameCodeDLLFullPath);
             
             // Setup Game Loop
             IsRunning = true;
+            if(RenderOptions.OfflineFileName[0])
+            {
+                // NOTE: Offline renders write a single image file and quit
+                if(!Game.RenderOffline ||
+                   !Game.RenderOffline(&GameMemory, RenderOptions.OfflineWidth, RenderOptions.OfflineHeight, 
+                                       RenderOptions.OfflineFileName))
+                {
+                    char ErrorMessage [MAX_PATH + 64];
+                    sprintf_s(ErrorMessage, "Fatal: Offline render to %s failed\n", RenderOptions.OfflineFileName);
+                    OutputDebugStringA(ErrorMessage);
+                }
+                IsRunning = false;
+            }
             LARGE_INTEGER LastCounter;
             QueryPerformanceCounter(&LastCounter);
             uint64_t LastCycleCount = __rdtsc();
@@ -27,11 +27,98 @@ struct win32_window_dimension
     int32_t Height;
 };
 
+struct platform_work_queue_entry
+{
+    platform_work_queue_callback* Callback;
+    void* Data;
+};
+
+struct platform_work_queue
+{
+    uint32_t volatile CompletionGoal;
+    uint32_t volatile CompletionCount;
+    
+    uint32_t volatile NextEntryToWrite;
+    uint32_t volatile NextEntryToRead;
+    HANDLE SemaphoreHandle;
+    
+    platform_work_queue_entry Entries[256];
+};
+
+struct win32_thread_startup
+{
+    platform_work_queue* Queue;
+    // NOTE: 0 is the main thread, it helps with the work in CompleteAllWork
+    uint32_t ThreadIndex;
+    bool IsPinned;
+    GROUP_AFFINITY Affinity;
+};
+
+enum win32_pin_policy
+{
+    // Let the scheduler move the threads around
+    Win32Pin_None,
+    // One worker per physical core, SMT siblings are left alone
+    Win32Pin_Cores,
+    // One worker per logical processor, siblings get consecutive workers
+    Win32Pin_SMT,
+};
+
+// NOTE: Set on the command line with -threads N and -pin none|cores|smt,
+// -offline FILE renders a single -size WIDTHxHEIGHT image to FILE and quits,
+// -tier scalar|sse4|avx2|avx512 caps the raster kernels instruction set for benchmarking,
+// -shading float|fixed16 picks the shading of the scene, -lighting pixel|vertex how often the
+// sphere is lit, -shader phong|normals the shader of the scene, -lights N how many local
+// lights circle it, -textures on|off|bc1|bc4|bc5 whether the sphere is textured and in
+// which format and -shadows off|on|pcf whether the key light casts hard or filtered shadows
+struct win32_render_options
+{
+    // 0 picks one thread per processor allowed by the pin policy
+    uint32_t ThreadCount;
+    win32_pin_policy PinPolicy;
+    raster_tier RasterTier;
+    shading_mode ShadingMode;
+    shading_frequency SphereShadingFrequency;
+    shader_type SceneShader;
+    uint32_t SceneLocalLightCount;
+    bool SceneTextures;
+    texture_format SceneTextureFormat;
+    render_mode RenderMode;
+    shading_rate_mode ShadingRateMode;
+    shadow_mode SceneShadows;
+    bool CalibrateBlockShapes;
+    
+    char OfflineFileName[MAX_PATH];
+    int32_t OfflineWidth;
+    int32_t OfflineHeight;
+};
+
+#define WIN32_MAX_LOGICAL_PROCESSORS 256
+
+struct win32_logical_processor
+{
+    GROUP_AFFINITY Affinity;
+    uint32_t CoreIndex;
+    // Position among the SMT siblings of its core
+    uint32_t SiblingIndex;
+    uint32_t L2Domain;
+    uint32_t L3Domain;
+};
+
+struct win32_cpu_topology
+{
+    uint32_t CoresCount;
+    uint32_t LogicalProcessorsCount;
+    // Sorted by L3, then L2, then core, so neighbours share the most cache
+    win32_logical_processor LogicalProcessors[WIN32_MAX_LOGICAL_PROCESSORS];
+};
+
 struct win32_game_code
 {
     HMODULE GameDLL;
     FILETIME DLLLastWriteTime;
     game_update_and_render* UpdateAndRender;
+    game_render_offline* RenderOffline;
 };
 
 